@@ -0,0 +1,105 @@
+#include <common/convert.h>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace mesh2py::bench {
+using namespace mesh2py::common;
+
+struct Vec2d { double x, y; };
+struct Vec3d { double x, y, z; };
+struct Vec4d { double x, y, z, w; };
+
+// The per-component loops the FBX importer used before the SIMD kernels
+void LegacyConvertVec2(float* dst, const Vec2d* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i * 2 + 0] = static_cast<float>(src[i].x);
+        dst[i * 2 + 1] = static_cast<float>(src[i].y);
+    }
+}
+
+void LegacyConvertVec3(float* dst, const Vec3d* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i * 3 + 0] = static_cast<float>(src[i].x);
+        dst[i * 3 + 1] = static_cast<float>(src[i].y);
+        dst[i * 3 + 2] = static_cast<float>(src[i].z);
+    }
+}
+
+void LegacyConvertVec4(float* dst, const Vec4d* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i * 4 + 0] = static_cast<float>(src[i].x);
+        dst[i * 4 + 1] = static_cast<float>(src[i].y);
+        dst[i * 4 + 2] = static_cast<float>(src[i].z);
+        dst[i * 4 + 3] = static_cast<float>(src[i].w);
+    }
+}
+
+std::vector<double> MakeInput(size_t count) {
+    std::vector<double> src(count);
+    for (size_t i = 0; i < count; i++) {
+        src[i] = double(i) * 0.001 - 12.5;
+    }
+    return src;
+}
+
+// Bytes read plus bytes written per converted component
+constexpr int64_t kBytesPerComponent = sizeof(double) + sizeof(float);
+
+template <size_t N, class VecT, void (*Convert)(float*, const VecT*, size_t)>
+void BM_Legacy(benchmark::State& state) {
+    size_t count = state.range(0);
+    std::vector<double> src = MakeInput(count * N);
+    std::vector<float> dst(count * N);
+    for (auto _ : state) {
+        Convert(dst.data(), reinterpret_cast<const VecT*>(src.data()), count);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * int64_t(count * N) * kBytesPerComponent);
+}
+
+template <size_t N, SimdLevel kLevel>
+void BM_Kernel(benchmark::State& state) {
+    ConvertDoubleToFloatFn kernel = GetConvertDoubleToFloatKernel(kLevel);
+    if (!kernel) {
+        state.SkipWithError("kernel not supported on this CPU");
+        return;
+    }
+    size_t count = state.range(0);
+    std::vector<double> src = MakeInput(count * N);
+    std::vector<float> dst(count * N);
+    for (auto _ : state) {
+        kernel(dst.data(), src.data(), count * N);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * int64_t(count * N) * kBytesPerComponent);
+}
+
+// Vector counts from L1 resident up to well past the last level cache
+#define MESH2PY_CONVERT_RANGE RangeMultiplier(16)->Range(1 << 10, 1 << 22)
+
+BENCHMARK(BM_Legacy<2, Vec2d, LegacyConvertVec2>)->Name("Vec2/legacy")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Legacy<3, Vec3d, LegacyConvertVec3>)->Name("Vec3/legacy")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Legacy<4, Vec4d, LegacyConvertVec4>)->Name("Vec4/legacy")->MESH2PY_CONVERT_RANGE;
+
+BENCHMARK(BM_Kernel<2, SimdLevel::Scalar>)->Name("Vec2/scalar")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Kernel<2, SimdLevel::SSE2>)->Name("Vec2/sse2")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Kernel<2, SimdLevel::AVX2>)->Name("Vec2/avx2")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Kernel<2, SimdLevel::AVX512>)->Name("Vec2/avx512")->MESH2PY_CONVERT_RANGE;
+
+BENCHMARK(BM_Kernel<3, SimdLevel::Scalar>)->Name("Vec3/scalar")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Kernel<3, SimdLevel::SSE2>)->Name("Vec3/sse2")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Kernel<3, SimdLevel::AVX2>)->Name("Vec3/avx2")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Kernel<3, SimdLevel::AVX512>)->Name("Vec3/avx512")->MESH2PY_CONVERT_RANGE;
+
+BENCHMARK(BM_Kernel<4, SimdLevel::Scalar>)->Name("Vec4/scalar")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Kernel<4, SimdLevel::SSE2>)->Name("Vec4/sse2")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Kernel<4, SimdLevel::AVX2>)->Name("Vec4/avx2")->MESH2PY_CONVERT_RANGE;
+BENCHMARK(BM_Kernel<4, SimdLevel::AVX512>)->Name("Vec4/avx512")->MESH2PY_CONVERT_RANGE;
+
+}
+
+BENCHMARK_MAIN();
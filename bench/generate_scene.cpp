@@ -0,0 +1,50 @@
+#include "synthetic_scene.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Writes a synthetic FBX scene, the input of import_benchmark and python_roundtrip.py:
+//   generate_scene out.fbx [--meshes N] [--faces N] [--uvs N] [--colors N] [--depth N]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: %s <out.fbx> [--meshes N] [--faces N] [--uvs N] [--colors N] [--depth N]\n", argv[0]);
+        return 1;
+    }
+
+    mesh2py::bench::SyntheticSceneParams params;
+    struct Option {
+        const char* name;
+        uint32_t* value;
+    };
+    const Option options[] = {
+        { "--meshes", &params.mesh_count },
+        { "--faces", &params.faces_per_mesh },
+        { "--uvs", &params.uv_set_count },
+        { "--colors", &params.color_set_count },
+        { "--depth", &params.hierarchy_depth },
+    };
+    for (int i = 2; i < argc; i += 2) {
+        const Option* option = nullptr;
+        for (const Option& candidate : options) {
+            if (strcmp(argv[i], candidate.name) == 0) {
+                option = &candidate;
+            }
+        }
+        if (!option || i + 1 >= argc) {
+            printf("unknown or incomplete option %s\n", argv[i]);
+            return 1;
+        }
+        *option->value = (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+    }
+
+    std::string error;
+    if (!mesh2py::bench::WriteSyntheticFbx(params, argv[1], &error)) {
+        printf("Error %s\n", error.c_str());
+        return 1;
+    }
+    printf("%s: %u meshes, %llu faces\n", argv[1], params.mesh_count,
+        (unsigned long long)mesh2py::bench::GetSyntheticFaceCount(params));
+    return 0;
+}
@@ -0,0 +1,329 @@
+#include "synthetic_scene.h"
+
+#include <common/data_buffer.h>
+#include <common/import_stats.h>
+#include <fbx2py/fbx_importer.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace mesh2py::bench {
+using namespace mesh2py::common;
+using namespace mesh2py::fbx;
+
+// High water mark of the process resident set in bytes. Process wide and never decreases, so
+// it reports the largest configuration run so far; run one filter per process to compare.
+int64_t GetPeakRss() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters = {};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return (int64_t)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return (int64_t)usage.ru_maxrss;
+#else
+    return (int64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// Arguments: mesh count, faces per mesh, UV sets, color sets, hierarchy depth, worker threads
+// (0 uses every hardware thread)
+SyntheticSceneParams GetParams(const benchmark::State& state) {
+    SyntheticSceneParams params;
+    params.mesh_count = (uint32_t)state.range(0);
+    params.faces_per_mesh = (uint32_t)state.range(1);
+    params.uv_set_count = (uint32_t)state.range(2);
+    params.color_set_count = (uint32_t)state.range(3);
+    params.hierarchy_depth = (uint32_t)state.range(4);
+    return params;
+}
+
+using ParamsKey = std::tuple<uint32_t, uint32_t, uint32_t, uint32_t, uint32_t>;
+
+ParamsKey GetKey(const SyntheticSceneParams& params) {
+    return { params.mesh_count, params.faces_per_mesh, params.uv_set_count, params.color_set_count,
+        params.hierarchy_depth };
+}
+
+// A generated document and the ufbx scene parsed from it, kept for the whole run so the stage
+// benchmarks only time the stage
+struct CachedScene {
+    std::string document;
+    ufbx_scene* scene = nullptr;
+    std::string path;
+
+    ~CachedScene() {
+        ufbx_free_scene(scene);
+        if (!path.empty()) {
+            std::remove(path.c_str());
+        }
+    }
+};
+
+CachedScene* GetScene(const SyntheticSceneParams& params, std::string* error) {
+    static std::map<ParamsKey, std::unique_ptr<CachedScene>> cache;
+    std::unique_ptr<CachedScene>& cached = cache[GetKey(params)];
+    if (cached) {
+        return cached.get();
+    }
+
+    auto entry = std::make_unique<CachedScene>();
+    entry->document = GenerateSyntheticFbx(params);
+    ufbx_load_opts load_opts = {};
+    ufbx_error fbx_error = {};
+    entry->scene = ufbx_load_memory(entry->document.data(), entry->document.size(), &load_opts, &fbx_error);
+    if (!entry->scene) {
+        *error = std::string(fbx_error.description.data, fbx_error.description.length);
+        return nullptr;
+    }
+    cached = std::move(entry);
+    return cached.get();
+}
+
+// Written on first use, ImportFbx reads from disk
+const char* GetScenePath(CachedScene& cached, const SyntheticSceneParams& params, std::string* error) {
+    if (cached.path.empty()) {
+        char name[128];
+        snprintf(name, sizeof(name), "mesh2py_bench_%u_%u_%u_%u_%u.fbx", params.mesh_count, params.faces_per_mesh,
+            params.uv_set_count, params.color_set_count, params.hierarchy_depth);
+        std::string path = (std::filesystem::temp_directory_path() / name).string();
+        if (!WriteSyntheticFbx(params, path.c_str(), error)) {
+            return nullptr;
+        }
+        cached.path = std::move(path);
+    }
+    return cached.path.c_str();
+}
+
+uint32_t GetThreadCount(const benchmark::State& state) {
+    return (uint32_t)state.range(5);
+}
+
+void ResetContext(FbxContext& context, const ufbx_scene* scene, uint32_t num_threads) {
+    context = FbxContext();
+    context.scene = scene;
+    context.options.num_threads = num_threads;
+}
+
+// Faces per second, bytes of the data blob per second and the peak RSS after the run
+void SetCounters(benchmark::State& state, const SyntheticSceneParams& params, size_t data_size) {
+    state.counters["faces"] = benchmark::Counter(
+        (double)GetSyntheticFaceCount(params) * (double)state.iterations(), benchmark::Counter::kIsRate);
+    state.SetBytesProcessed(state.iterations() * (int64_t)data_size);
+    state.counters["peak_rss"] = benchmark::Counter((double)GetPeakRss(), benchmark::Counter::kDefaults,
+        benchmark::Counter::kIs1024);
+}
+
+void BM_AllocateSceneData(benchmark::State& state) {
+    SyntheticSceneParams params = GetParams(state);
+    std::string error;
+    CachedScene* cached = GetScene(params, &error);
+    if (!cached) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    FbxContext context;
+    size_t data_size = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        ResetContext(context, cached->scene, GetThreadCount(state));
+        state.ResumeTiming();
+        if (!AllocateSceneData(context)) {
+            state.SkipWithError(context.error.c_str());
+            return;
+        }
+        benchmark::DoNotOptimize(context.storage.data.data());
+        data_size = context.storage.data.size();
+    }
+    SetCounters(state, params, data_size);
+}
+
+void BM_ImportMeshes(benchmark::State& state) {
+    SyntheticSceneParams params = GetParams(state);
+    std::string error;
+    CachedScene* cached = GetScene(params, &error);
+    if (!cached) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    FbxContext context;
+    ResetContext(context, cached->scene, GetThreadCount(state));
+    if (!AllocateSceneData(context)) {
+        state.SkipWithError(context.error.c_str());
+        return;
+    }
+    // Every pass rewrites the same blob, the first one also pays for faulting its pages in
+    ImportMeshes(context);
+    for (auto _ : state) {
+        ImportMeshes(context);
+        benchmark::DoNotOptimize(context.storage.data.data());
+        benchmark::ClobberMemory();
+    }
+    SetCounters(state, params, context.storage.data.size());
+}
+
+void BM_ImportNodes(benchmark::State& state) {
+    SyntheticSceneParams params = GetParams(state);
+    std::string error;
+    CachedScene* cached = GetScene(params, &error);
+    if (!cached) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    FbxContext context;
+    ResetContext(context, cached->scene, GetThreadCount(state));
+    if (!AllocateSceneData(context)) {
+        state.SkipWithError(context.error.c_str());
+        return;
+    }
+    ImportMeshes(context);
+    for (auto _ : state) {
+        ImportNodes(context);
+        benchmark::DoNotOptimize(context.storage.nodes.data());
+        benchmark::ClobberMemory();
+    }
+    state.counters["nodes"] = benchmark::Counter(
+        (double)context.storage.nodes.size() * (double)state.iterations(), benchmark::Counter::kIsRate);
+}
+
+// Parse, import and post import from a file, what import_fbx costs without the binding. The
+// stats variant measures the cost of collecting ImportStats with trace events.
+template <bool kStats>
+void BM_ImportFbx(benchmark::State& state) {
+    SyntheticSceneParams params = GetParams(state);
+    std::string error;
+    CachedScene* cached = GetScene(params, &error);
+    const char* path = cached ? GetScenePath(*cached, params, &error) : nullptr;
+    if (!path) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    ImportOptions options;
+    options.num_threads = GetThreadCount(state);
+    size_t data_size = 0;
+    ImportStats stats;
+    for (auto _ : state) {
+        if constexpr (kStats) {
+            stats = ImportStats();
+            stats.record_trace = true;
+            options.stats = &stats;
+        }
+        SceneStorage storage;
+        if (!ImportFbx(path, options, storage, &error)) {
+            state.SkipWithError(error.c_str());
+            return;
+        }
+        benchmark::DoNotOptimize(storage.data.data());
+        data_size = storage.data.size();
+    }
+    SetCounters(state, params, data_size);
+}
+
+// ImportFbx with the data blob in a caller owned arena reused by every iteration, so the
+// pages are faulted in once instead of on every import
+void BM_ImportFbxArena(benchmark::State& state) {
+    SyntheticSceneParams params = GetParams(state);
+    std::string error;
+    CachedScene* cached = GetScene(params, &error);
+    const char* path = cached ? GetScenePath(*cached, params, &error) : nullptr;
+    if (!path) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    ImportOptions options;
+    options.num_threads = GetThreadCount(state);
+    SceneStorage sized;
+    if (!ImportFbx(path, options, sized, &error)) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+    // Room for the blob and the alignment of its start
+    std::vector<uint8_t> arena_memory(sized.data.size() + 64);
+    for (auto _ : state) {
+        options.allocator = std::make_shared<ArenaStorageAllocator>(arena_memory.data(), arena_memory.size());
+        SceneStorage storage;
+        if (!ImportFbx(path, options, storage, &error)) {
+            state.SkipWithError(error.c_str());
+            return;
+        }
+        benchmark::DoNotOptimize(storage.data.data());
+    }
+    SetCounters(state, params, sized.data.size());
+}
+
+// ImportFbx from the document in memory, the file benchmark minus the disk round trip
+void BM_ImportFbxMemory(benchmark::State& state) {
+    SyntheticSceneParams params = GetParams(state);
+    std::string error;
+    CachedScene* cached = GetScene(params, &error);
+    if (!cached) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    ImportOptions options;
+    options.num_threads = GetThreadCount(state);
+    size_t data_size = 0;
+    for (auto _ : state) {
+        SceneStorage storage;
+        if (!ImportFbxFromMemory(cached->document.data(), cached->document.size(), options, storage, &error)) {
+            state.SkipWithError(error.c_str());
+            return;
+        }
+        benchmark::DoNotOptimize(storage.data.data());
+        data_size = storage.data.size();
+    }
+    SetCounters(state, params, data_size);
+}
+
+// Scales one dimension at a time around the default scene on one thread, then a large scene on
+// every hardware thread
+void SceneArguments(benchmark::internal::Benchmark* b) {
+    b->ArgNames({ "meshes", "faces", "uvs", "colors", "depth", "threads" });
+    for (int64_t meshes : { 1, 16, 256 }) {
+        b->Args({ meshes, 1024, 1, 0, 1, 1 });
+    }
+    for (int64_t faces : { 64, 16384, 262144 }) {
+        b->Args({ 16, faces, 1, 0, 1, 1 });
+    }
+    b->Args({ 16, 1024, 4, 0, 1, 1 });
+    b->Args({ 16, 1024, 1, 2, 1, 1 });
+    b->Args({ 256, 64, 1, 0, 16, 1 });
+    b->Args({ 256, 64, 1, 0, 256, 1 });
+    b->Args({ 256, 1024, 1, 0, 1, 0 });
+    b->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK(BM_AllocateSceneData)->Apply(SceneArguments);
+BENCHMARK(BM_ImportMeshes)->Apply(SceneArguments);
+BENCHMARK(BM_ImportNodes)->Apply(SceneArguments);
+BENCHMARK(BM_ImportFbx<false>)->Name("BM_ImportFbx")->Apply(SceneArguments);
+BENCHMARK(BM_ImportFbx<true>)->Name("BM_ImportFbx/stats")->Apply(SceneArguments);
+BENCHMARK(BM_ImportFbxArena)->Apply(SceneArguments);
+BENCHMARK(BM_ImportFbxMemory)->Apply(SceneArguments);
+
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,86 @@
+"""Times import_fbx through the Python binding, including reading the results back as numpy.
+
+    python bench/python_roundtrip.py scene.fbx [--repeat N] [--num-threads N] [--trace out.json] [--buffer]
+
+Generate the input with the generate_scene executable so numbers stay comparable between
+releases. Reports faces/s, MB/s of the data blob and the peak RSS of the process, then the
+per phase ImportStats of one more import, whose Chrome trace --trace writes. --buffer reads the
+file once and times import_fbx_buffer on the bytes instead.
+"""
+
+import argparse
+import sys
+import time
+
+import numpy as np
+
+import mesh2py
+
+
+def peak_rss_bytes():
+    if sys.platform == "win32":
+        return 0
+    import resource
+
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # Kilobytes on Linux, bytes on macOS
+    return peak if sys.platform == "darwin" else peak * 1024
+
+
+def round_trip(source, num_threads, stats=None):
+    if isinstance(source, bytes):
+        storage = mesh2py.import_fbx_buffer(source, num_threads=num_threads, stats=stats)
+    else:
+        storage = mesh2py.import_fbx(source, num_threads=num_threads, stats=stats)
+    # Touch every view the way a consumer would, so lazily created arrays are part of the cost
+    data = np.asarray(storage.data)
+    checksum = int(data[::4096].sum())
+    checksum += int(np.asarray(storage.mesh_face_counts).sum())
+    checksum += int(np.asarray(storage.node_parents).size)
+    checksum += int(np.asarray(storage.node_transforms).size)
+    faces = int(np.asarray(storage.mesh_face_counts).sum())
+    return faces, data.nbytes, checksum
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("path")
+    parser.add_argument("--repeat", type=int, default=10)
+    parser.add_argument("--num-threads", type=int, default=1)
+    parser.add_argument("--trace", help="write the Chrome trace of the stats import here")
+    parser.add_argument("--buffer", action="store_true", help="import from the file bytes in memory")
+    args = parser.parse_args()
+
+    source = args.path
+    if args.buffer:
+        with open(args.path, "rb") as f:
+            source = f.read()
+
+    round_trip(source, args.num_threads)
+    times = []
+    for _ in range(args.repeat):
+        start = time.perf_counter()
+        faces, size, _ = round_trip(source, args.num_threads)
+        times.append(time.perf_counter() - start)
+
+    best = min(times)
+    median = sorted(times)[len(times) // 2]
+    print(f"{args.path}: {faces} faces, {size / 2**20:.2f} MB")
+    print(f"best {best * 1e3:.2f} ms, median {median * 1e3:.2f} ms")
+    print(f"{faces / best / 1e6:.2f} Mfaces/s, {size / best / 2**20:.1f} MB/s")
+    print(f"peak rss {peak_rss_bytes() / 2**20:.1f} MB")
+
+    stats = mesh2py.ImportStats()
+    stats.record_trace = args.trace is not None
+    round_trip(source, args.num_threads, stats)
+    cpu = stats.phase_cpu_seconds
+    for phase, wall in stats.phase_wall_seconds.items():
+        if wall > 0:
+            print(f"  {phase:<12} wall {wall * 1e3:8.2f} ms  cpu {cpu[phase] * 1e3:8.2f} ms")
+    print(f"  thread utilization {stats.thread_utilization:.2f} over {stats.max_workers} workers")
+    if args.trace:
+        stats.write_chrome_trace(args.trace)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,248 @@
+#include "synthetic_scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace mesh2py::bench {
+
+namespace {
+
+constexpr uint64_t kGeometryIdBase = 1000000000ull;
+constexpr uint64_t kModelIdBase = 2000000000ull;
+
+// Deterministic value in [0, 1) for an integer key, stands in for a seeded random generator
+float HashUnit(uint32_t a, uint32_t b, uint32_t c) {
+    uint64_t h = a * 0x9e3779b97f4a7c15ull ^ (b + 0x632be59bd9b4e019ull) * 0xc2b2ae3d27d4eb4full ^ c * 0x165667b19e3779f9ull;
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 32;
+    return (float)(h >> 40) / (float)(1u << 24);
+}
+
+class FbxWriter {
+public:
+    explicit FbxWriter(std::string& out) : m_out(out) {}
+
+    void Line(const char* text) {
+        m_out.append(m_indent, '\t');
+        m_out += text;
+        m_out += '\n';
+    }
+
+    void Open(const std::string& header) {
+        Line((header + " {").c_str());
+        ++m_indent;
+    }
+
+    void Close() {
+        --m_indent;
+        Line("}");
+    }
+
+    // "Name: *count { a: v,v,... }" with the values written by `fn(i)`
+    template <class Fn>
+    void Array(const char* name, size_t count, Fn&& fn) {
+        Open(std::string(name) + ": *" + std::to_string(count));
+        m_out.append(m_indent, '\t');
+        m_out += "a: ";
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) {
+                m_out += ',';
+            }
+            fn(i);
+        }
+        m_out += '\n';
+        Close();
+    }
+
+    void Number(float value) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.6g", value);
+        m_out += text;
+    }
+
+    void Number(int64_t value) {
+        m_out += std::to_string(value);
+    }
+
+private:
+    std::string& m_out;
+    size_t m_indent = 0;
+};
+
+// Quads of a grid `columns` wide facing +y, vertex (x, z) at index z * (columns + 1) + x
+struct Grid {
+    uint32_t columns;
+    uint32_t rows;
+
+    explicit Grid(uint32_t face_count) {
+        columns = std::max(1u, (uint32_t)std::ceil(std::sqrt((double)face_count)));
+        rows = std::max(1u, (face_count + columns - 1) / columns);
+    }
+
+    uint32_t GetVertexCount() const { return (columns + 1) * (rows + 1); }
+
+    uint32_t GetCorner(uint32_t face, uint32_t corner) const {
+        static const uint32_t dx[4] = { 0, 0, 1, 1 };
+        static const uint32_t dz[4] = { 0, 1, 1, 0 };
+        uint32_t x = face % columns + dx[corner];
+        uint32_t z = face / columns + dz[corner];
+        return z * (columns + 1) + x;
+    }
+};
+
+void WriteLayerElement(FbxWriter& writer, const char* element, uint32_t set, const char* name, const char* values,
+    const char* indices, uint32_t width, const Grid& grid, uint32_t face_count, uint32_t mesh) {
+    writer.Open(std::string(element) + ": " + std::to_string(set));
+    writer.Line("Version: 101");
+    writer.Line((std::string("Name: \"") + name + std::to_string(set) + "\"").c_str());
+    writer.Line("MappingInformationType: \"ByPolygonVertex\"");
+    writer.Line("ReferenceInformationType: \"IndexToDirect\"");
+    writer.Array(values, (size_t)grid.GetVertexCount() * width, [&](size_t i) {
+        uint32_t vertex = (uint32_t)(i / width);
+        uint32_t component = (uint32_t)(i % width);
+        if (width == 2) {
+            float extent = component == 0 ? (float)grid.columns : (float)grid.rows;
+            float coordinate = component == 0 ? (float)(vertex % (grid.columns + 1)) : (float)(vertex / (grid.columns + 1));
+            writer.Number(coordinate / extent + 0.125f * set);
+        } else {
+            writer.Number(component == 3 ? 1.0f : HashUnit(mesh, vertex, 4 * set + component));
+        }
+    });
+    writer.Array(indices, (size_t)face_count * 4, [&](size_t i) {
+        writer.Number((int64_t)grid.GetCorner((uint32_t)(i / 4), (uint32_t)(i % 4)));
+    });
+    writer.Close();
+}
+
+void WriteGeometry(FbxWriter& writer, const SyntheticSceneParams& params, uint32_t mesh) {
+    Grid grid(params.faces_per_mesh);
+    uint32_t face_count = params.faces_per_mesh;
+    writer.Open("Geometry: " + std::to_string(kGeometryIdBase + mesh) + ", \"Geometry::mesh_" +
+        std::to_string(mesh) + "\", \"Mesh\"");
+    writer.Array("Vertices", (size_t)grid.GetVertexCount() * 3, [&](size_t i) {
+        uint32_t vertex = (uint32_t)(i / 3);
+        uint32_t x = vertex % (grid.columns + 1);
+        uint32_t z = vertex / (grid.columns + 1);
+        switch (i % 3) {
+        case 0: writer.Number((float)x); break;
+        case 1: writer.Number(HashUnit(mesh, x, z) * 0.25f); break;
+        default: writer.Number((float)z); break;
+        }
+    });
+    // The last corner of every polygon is stored as ~index
+    writer.Array("PolygonVertexIndex", (size_t)face_count * 4, [&](size_t i) {
+        int64_t corner = grid.GetCorner((uint32_t)(i / 4), (uint32_t)(i % 4));
+        writer.Number(i % 4 == 3 ? ~corner : corner);
+    });
+    writer.Line("GeometryVersion: 124");
+
+    writer.Open("LayerElementNormal: 0");
+    writer.Line("Version: 101");
+    writer.Line("Name: \"\"");
+    writer.Line("MappingInformationType: \"ByPolygonVertex\"");
+    writer.Line("ReferenceInformationType: \"Direct\"");
+    writer.Array("Normals", (size_t)face_count * 12, [&](size_t i) {
+        writer.Number(i % 3 == 1 ? 1.0f : 0.0f);
+    });
+    writer.Close();
+    for (uint32_t set = 0; set < params.uv_set_count; ++set) {
+        WriteLayerElement(writer, "LayerElementUV", set, "uv", "UV", "UVIndex", 2, grid, face_count, mesh);
+    }
+    for (uint32_t set = 0; set < params.color_set_count; ++set) {
+        WriteLayerElement(writer, "LayerElementColor", set, "color", "Colors", "ColorIndex", 4, grid, face_count, mesh);
+    }
+
+    // Layer n references the nth element of every kind
+    uint32_t layer_count = std::max(1u, std::max(params.uv_set_count, params.color_set_count));
+    for (uint32_t layer = 0; layer < layer_count; ++layer) {
+        writer.Open("Layer: " + std::to_string(layer));
+        writer.Line("Version: 100");
+        auto reference = [&](const char* type) {
+            writer.Open("LayerElement: ");
+            writer.Line((std::string("Type: \"") + type + "\"").c_str());
+            writer.Line(("TypedIndex: " + std::to_string(layer)).c_str());
+            writer.Close();
+        };
+        if (layer == 0) {
+            reference("LayerElementNormal");
+        }
+        if (layer < params.uv_set_count) {
+            reference("LayerElementUV");
+        }
+        if (layer < params.color_set_count) {
+            reference("LayerElementColor");
+        }
+        writer.Close();
+    }
+    writer.Close();
+}
+
+}
+
+std::string GenerateSyntheticFbx(const SyntheticSceneParams& params) {
+    std::string out;
+    FbxWriter writer(out);
+    uint32_t depth = std::max(1u, params.hierarchy_depth);
+
+    writer.Line("; FBX 7.4.0 project file");
+    writer.Open("FBXHeaderExtension: ");
+    writer.Line("FBXHeaderVersion: 1003");
+    writer.Line("FBXVersion: 7400");
+    writer.Line("Creator: \"mesh2py synthetic scene\"");
+    writer.Close();
+    writer.Open("GlobalSettings: ");
+    writer.Line("Version: 1000");
+    writer.Close();
+
+    writer.Open("Objects: ");
+    for (uint32_t mesh = 0; mesh < params.mesh_count; ++mesh) {
+        WriteGeometry(writer, params, mesh);
+    }
+    // Chain heads are spread along x, every chain link is offset from its parent along z
+    Grid grid(params.faces_per_mesh);
+    for (uint32_t mesh = 0; mesh < params.mesh_count; ++mesh) {
+        bool head = mesh % depth == 0;
+        writer.Open("Model: " + std::to_string(kModelIdBase + mesh) + ", \"Model::node_" + std::to_string(mesh) +
+            "\", \"Mesh\"");
+        writer.Line("Version: 232");
+        writer.Open("Properties70: ");
+        char translation[128];
+        snprintf(translation, sizeof(translation), "P: \"Lcl Translation\", \"Lcl Translation\", \"\", \"A\",%u,0,%u",
+            head ? (mesh / depth) * (grid.columns + 1) : 0u, head ? 0u : grid.rows + 1);
+        writer.Line(translation);
+        writer.Close();
+        writer.Close();
+    }
+    writer.Close();
+
+    writer.Open("Connections: ");
+    for (uint32_t mesh = 0; mesh < params.mesh_count; ++mesh) {
+        uint64_t model = kModelIdBase + mesh;
+        uint64_t parent = mesh % depth == 0 ? 0 : model - 1;
+        writer.Line(("C: \"OO\"," + std::to_string(kGeometryIdBase + mesh) + "," + std::to_string(model)).c_str());
+        writer.Line(("C: \"OO\"," + std::to_string(model) + "," + std::to_string(parent)).c_str());
+    }
+    writer.Close();
+    return out;
+}
+
+bool WriteSyntheticFbx(const SyntheticSceneParams& params, const char* path, std::string* error) {
+    std::string document = GenerateSyntheticFbx(params);
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        if (error) {
+            *error = std::string("cannot open ") + path + " for writing";
+        }
+        return false;
+    }
+    bool written = fwrite(document.data(), 1, document.size(), file) == document.size();
+    written = fclose(file) == 0 && written;
+    if (!written && error) {
+        *error = std::string("failed to write ") + path;
+    }
+    return written;
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <inttypes.h>
+#include <string>
+
+namespace mesh2py::bench {
+
+// Shape of a generated scene. The same parameters always produce the same bytes.
+struct SyntheticSceneParams {
+    uint32_t mesh_count = 16;
+    // Quads per mesh, laid out as a height field grid
+    uint32_t faces_per_mesh = 1024;
+    // Per corner UV and RGBA color layers of every mesh
+    uint32_t uv_set_count = 1;
+    uint32_t color_set_count = 0;
+    // Length of the parent chains the mesh nodes are grouped into, 1 puts every node under the root
+    uint32_t hierarchy_depth = 1;
+};
+
+// ASCII FBX 7.4 document with one geometry and one model node per mesh, per corner normals
+// and the requested UV and color layers
+std::string GenerateSyntheticFbx(const SyntheticSceneParams& params);
+
+// Writes GenerateSyntheticFbx to `path`. Returns false and stores the reason in `error` (when
+// not null) on failure.
+bool WriteSyntheticFbx(const SyntheticSceneParams& params, const char* path, std::string* error);
+
+// Total faces of a generated scene
+inline uint64_t GetSyntheticFaceCount(const SyntheticSceneParams& params) {
+    return (uint64_t)params.mesh_count * params.faces_per_mesh;
+}
+
+}
@@ -0,0 +1,13 @@
+if(TARGET benchmark::benchmark)
+    return()
+endif()
+
+message(STATUS "Fetching google benchmark")
+include(CPM)
+CPMAddPackage(
+    NAME benchmark
+    GIT_REPOSITORY https://github.com/google/benchmark.git
+    GIT_TAG v1.8.3
+    OPTIONS "BENCHMARK_ENABLE_TESTING OFF" "BENCHMARK_ENABLE_INSTALL OFF" "BENCHMARK_ENABLE_GTEST_TESTS OFF"
+)
+set(benchmark_FOUND TRUE)
@@ -62,7 +62,6 @@ function(compile_config TARGET)
         target_compile_options(${TARGET} PRIVATE
             -Wall
             $<$<BOOL:${BUILD_STRICT_MODE}>:-Werror>
-            -msse3
             -Wno-deprecated
             -Wno-deprecated-declarations
             -Wno-unused-local-typedefs
@@ -1,22 +1,779 @@
 #include <nanobind/nanobind.h>
+#include <nanobind/stl/pair.h>
 #include <nanobind/stl/string.h>
+#include <nanobind/stl/unique_ptr.h>
 #include <nanobind/stl/vector.h>
 #include <nanobind/ndarray.h>
 
 #include <fbx2py/fbx_importer.h>
+#include <gltf2py/gltf_importer.h>
+#include <common/batch_import.h>
+#include <common/blendshapes.h>
+#include <common/build_meshlets.h>
+#include <common/deduplicate.h>
+#include <common/generate_lods.h>
+#include <common/import_stats.h>
+#include <common/optimize_meshes.h>
+#include <common/quantize_attributes.h>
+#include <common/scene_bvh.h>
+#include <common/scene_cache.h>
 #include <common/scene_data.h>
+#include <common/thread_pool.h>
+#include <common/unify_vertices.h>
+#include <common/world_transforms.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <memory>
 
 namespace nb = nanobind;
 using namespace mesh2py::common;
 
+// .gltf and .glb files go to the glTF importer, everything else to the FBX importer
+static bool ImportSceneFile(const char *path, const ImportOptions &options, SceneStorage &storage, std::string *error) {
+    std::string extension = path;
+    size_t dot = extension.find_last_of('.');
+    extension = dot == std::string::npos ? std::string() : extension.substr(dot);
+    for (char &c : extension)
+        c = (char)tolower((unsigned char)c);
+    if (extension == ".gltf" || extension == ".glb")
+        return ImportGltf(path, options, storage, error);
+    return ImportFbx(path, options, storage, error);
+}
+
+using ColumnView = nb::ndarray<nb::numpy, nb::device::cpu>;
+
+// Returns a strided array over one field of every record in `records`, optionally `width`
+// elements wide, without copying. The tables are read only from Python, so it stays valid as
+// long as `owner` lives.
+template <class T, class Record>
+ColumnView MakeColumn(std::vector<Record> &records, size_t field_offset, size_t width, nb::handle owner) {
+    static_assert(sizeof(Record) % sizeof(T) == 0);
+    T *data = (T *)((uint8_t *)records.data() + field_offset);
+    size_t shape[2] = { records.size(), width };
+    int64_t strides[2] = { int64_t(sizeof(Record) / sizeof(T)), 1 };
+    return ColumnView(records.empty() ? nullptr : data, width > 1 ? 2 : 1, shape, owner, strides, nb::dtype<T>());
+}
+
+// Getter for a column property of one of the SceneStorage record tables
+template <class T, class Record>
+auto Column(std::vector<Record> SceneStorage::*table, size_t field_offset, size_t width = 1) {
+    return [table, field_offset, width](SceneStorage &self) {
+        return MakeColumn<T>(self.*table, field_offset, width, nb::find(&self));
+    };
+}
+
+using FacesView = nb::ndarray<uint32_t, nb::shape<-1, 2>, nb::device::cpu, nb::c_contig, nb::numpy>;
+using IndicesView = nb::ndarray<uint32_t, nb::shape<-1>, nb::device::cpu, nb::c_contig, nb::numpy>;
+using ValuesView = nb::ndarray<float, nb::shape<-1, -1>, nb::device::cpu, nb::c_contig, nb::numpy>;
+using MeshletTrianglesView = nb::ndarray<uint8_t, nb::shape<-1, 3>, nb::device::cpu, nb::c_contig, nb::numpy>;
+// Index or value array in the dtype of its encoding
+using EncodedView = nb::ndarray<nb::numpy, nb::device::cpu, nb::c_contig>;
+static_assert(sizeof(Face) == 2 * sizeof(uint32_t));
+
+// Typed views alias the storage data and hold a reference to `owner`
+static MeshInfo& GetMeshInfo(SceneStorage &storage, uint32_t mesh_index) {
+    if (mesh_index >= storage.mesh_infos.size())
+        throw nb::index_error("mesh index out of range");
+    return storage.mesh_infos[mesh_index];
+}
+
+static AttributeInfo& GetAttribInfo(SceneStorage &storage, uint32_t attrib_index) {
+    if (attrib_index >= storage.attrib_infos.size())
+        throw nb::index_error("attribute index out of range");
+    return storage.attrib_infos[attrib_index];
+}
+
+static FacesView MakeFacesView(SceneStorage &storage, MeshInfo &mesh_info, nb::handle owner) {
+    FaceView view = GetFaceView(storage, mesh_info);
+    return FacesView(view.faces.data(), { view.faces.size(), 2 }, owner);
+}
+
+static EncodedView MakeIndicesView(SceneStorage &storage, DataOffset offset, uint32_t count, IndexEncoding encoding,
+    nb::handle owner) {
+    size_t shape[1] = { count };
+    nb::dlpack::dtype dtype = encoding == IndexEncoding::Uint16 ? nb::dtype<uint16_t>() : nb::dtype<uint32_t>();
+    return EncodedView(storage.data.data() + offset, 1, shape, owner, nullptr, dtype);
+}
+
+static EncodedView MakeIndicesView(SceneStorage &storage, AttributeInfo &attrib_info, nb::handle owner) {
+    return MakeIndicesView(storage, attrib_info.index_offset, attrib_info.index_count, attrib_info.index_encoding, owner);
+}
+
+static nb::dlpack::dtype GetValueDtype(ValueEncoding encoding) {
+    switch (encoding) {
+    case ValueEncoding::Float16:
+        return { (uint8_t)nb::dlpack::dtype_code::Float, 16, 1 };
+    case ValueEncoding::Snorm16:
+    case ValueEncoding::Octahedral16:
+        return nb::dtype<int16_t>();
+    case ValueEncoding::Unorm8:
+        return nb::dtype<uint8_t>();
+    case ValueEncoding::Uint16:
+        return nb::dtype<uint16_t>();
+    default:
+        return nb::dtype<float>();
+    }
+}
+
+static EncodedView MakeValuesView(SceneStorage &storage, AttributeInfo &attrib_info, nb::handle owner) {
+    size_t shape[2] = { attrib_info.value_count, GetEncodedWidth(attrib_info) };
+    return EncodedView(storage.data.data() + attrib_info.value_offset, 2, shape, owner, nullptr,
+        GetValueDtype(attrib_info.value_encoding));
+}
+
+// Mesh whose attribute range holds `attrib_index`
+static MeshInfo& GetAttribMesh(SceneStorage &storage, uint32_t attrib_index) {
+    for (MeshInfo &mesh_info : storage.mesh_infos) {
+        if (attrib_index - mesh_info.attrib_info_start_index < mesh_info.attribute_info_count)
+            return mesh_info;
+    }
+    throw nb::index_error("attribute index out of range");
+}
+
+static BlendshapeInfo& GetBlendshapeInfo(SceneStorage &storage, uint32_t shape_index) {
+    if (shape_index >= storage.blendshape_infos.size())
+        throw nb::index_error("blend shape index out of range");
+    return storage.blendshape_infos[shape_index];
+}
+
+// First attribute of `type` in a mesh, nullptr when it has none
+static AttributeInfo* FindAttribute(SceneStorage &storage, const MeshInfo &mesh_info, VertexAttribType type) {
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        AttributeInfo &attrib_info = storage.attrib_infos[mesh_info.attrib_info_start_index + a];
+        if (attrib_info.attrib_type == type)
+            return &attrib_info;
+    }
+    return nullptr;
+}
+
+using WeightsArg = nb::ndarray<const float, nb::shape<-1>, nb::device::cpu, nb::c_contig>;
+using PointsArg = nb::ndarray<const float, nb::shape<-1, 3>, nb::device::cpu, nb::c_contig>;
+
+// Matching row counts of two (N, 3) query arrays
+static size_t GetQueryCount(const PointsArg &a, const PointsArg &b, const char *message) {
+    if (a.shape(0) != b.shape(0))
+        throw nb::value_error(message);
+    return a.shape(0);
+}
+
+// LOD levels given from Python as (index_ratio, target_error) tuples
+using LodArgs = std::vector<std::pair<float, float>>;
+
+static std::vector<LodLevel> ToLodLevels(const LodArgs &lods) {
+    std::vector<LodLevel> levels;
+    for (const auto &[index_ratio, target_error] : lods)
+        levels.push_back({ index_ratio, target_error });
+    return levels;
+}
+
+// Read only view of an object supporting the buffer protocol (bytes, bytearray, memoryview,
+// NumPy arrays, mmap) without copying it. Contiguous buffers only. The exporter stays locked,
+// a bytearray cannot be resized, until the view is released, which needs the GIL.
+class BufferView {
+public:
+    explicit BufferView(nb::handle object) {
+        if (PyObject_GetBuffer(object.ptr(), &m_view, PyBUF_SIMPLE) != 0)
+            throw nb::python_error();
+    }
+    ~BufferView() { PyBuffer_Release(&m_view); }
+
+    BufferView(const BufferView&) = delete;
+    BufferView& operator=(const BufferView&) = delete;
+
+    const void *data() const { return m_view.buf; }
+    size_t size() const { return (size_t)m_view.len; }
+
+private:
+    Py_buffer m_view;
+};
+
+// Workers behind the *_async functions. Created on first use and drained at interpreter
+// exit, only touched with the GIL held.
+static std::unique_ptr<ThreadPool> g_async_pool;
+
+static ThreadPool& GetAsyncPool() {
+    if (!g_async_pool)
+        g_async_pool = std::make_unique<ThreadPool>(0);
+    return *g_async_pool;
+}
+
+// Python handle of an import running on the async pool. Wraps a concurrent.futures.Future so
+// it can be polled from plain threads and awaited from asyncio.
+struct ImportFuture {
+    nb::object future;
+};
+
+// Runs `import(storage, error)` on the async pool without the GIL and resolves the future with
+// the storage, or with a RuntimeError carrying the import error. `keep_alive`, e.g. the
+// ImportStats the import writes to, is held until the future is resolved.
+template <class ImportFn>
+ImportFuture SubmitImport(ImportFn import, nb::object keep_alive = nb::object()) {
+    nb::object future = nb::module_::import_("concurrent.futures").attr("Future")();
+    auto pending = std::make_shared<nb::object>(future);
+    auto owned = std::make_shared<nb::object>(std::move(keep_alive));
+    GetAsyncPool().Submit([pending, owned, import]() {
+        {
+            nb::gil_scoped_acquire acquire;
+            bool running = false;
+            try {
+                running = nb::cast<bool>(pending->attr("set_running_or_notify_cancel")());
+            } catch (nb::python_error &e) {
+                e.discard_as_unraisable("mesh2py async import");
+            }
+            if (!running) {
+                *pending = nb::object();
+                *owned = nb::object();
+                return;
+            }
+        }
+
+        // An exception from the import fails the future instead of ending the pool worker
+        ImportResult result;
+        try {
+            result.success = import(result.storage, &result.error);
+        } catch (const std::exception &e) {
+            result.storage = SceneStorage();
+            result.error = e.what();
+            result.success = false;
+        } catch (...) {
+            result.storage = SceneStorage();
+            result.error = "unknown exception during import";
+            result.success = false;
+        }
+
+        nb::gil_scoped_acquire acquire;
+        try {
+            if (result.success)
+                pending->attr("set_result")(nb::cast(std::move(result.storage)));
+            else
+                pending->attr("set_exception")(nb::module_::import_("builtins").attr("RuntimeError")(result.error));
+        } catch (nb::python_error &e) {
+            e.discard_as_unraisable("mesh2py async import");
+        }
+        *pending = nb::object();
+        *owned = nb::object();
+    });
+    return ImportFuture{ future };
+}
+
 NB_MODULE(NB_MODULE_NAME, m) {
     m.doc() = "mesh importer module";
+    m.attr("DATA_OFFSET_BITS") = 8 * sizeof(DataOffset);
     
     // Expose the main import function
-    m.def("import_fbx", &ImportFbx,
-          nb::arg("path"),
-          "Import FBX file and return scene data");
+    m.def("import_fbx",
+          [](const char* path, uint32_t num_threads, bool huge_pages, bool optimize, const LodArgs& lods,
+              bool meshlets, bool quantize, uint32_t joint_influences, bool dedup, ImportStats* stats) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              options.optimize_meshes = optimize;
+              options.lod_levels = ToLodLevels(lods);
+              options.build_meshlets = meshlets;
+              options.quantize_attributes = quantize;
+              options.max_joint_influences = joint_influences;
+              options.deduplicate = dedup;
+              options.stats = stats;
+              if (huge_pages)
+                  options.allocator = GetHugePageStorageAllocator();
+              SceneStorage storage;
+              std::string error;
+              if (!ImportFbx(path, options, storage, &error))
+                  throw std::runtime_error(error);
+              return storage;
+          },
+          nb::arg("path"), nb::arg("num_threads") = 1, nb::arg("huge_pages") = false, nb::arg("optimize") = false,
+          nb::arg("lods") = LodArgs(), nb::arg("meshlets") = false, nb::arg("quantize") = false,
+          nb::arg("joint_influences") = 4, nb::arg("dedup") = false, nb::arg("stats").none() = nb::none(),
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Import FBX file and return scene data. num_threads=0 uses every hardware thread, "
+          "huge_pages backs the data blob with transparent huge pages where supported, optimize "
+          "runs the meshoptimizer stage of optimize_meshes on the result, lods is a list of "
+          "(index_ratio, target_error) levels for generate_lods and implies optimize, meshlets runs "
+          "build_meshlets with its defaults and implies optimize, quantize stores the result with "
+          "the compact encodings of quantize_attributes, joint_influences is the number of skin "
+          "joints kept per vertex in the Joints and Weights attributes, 0 skips the skins, dedup "
+          "runs deduplicate on the result, stats is an ImportStats the timings and counts of the "
+          "import are added to. Raises RuntimeError when the import fails");
+
+    m.def("import_many",
+          [](const std::vector<std::string>& paths, uint32_t num_threads, bool huge_pages, bool optimize,
+              const LodArgs& lods, bool meshlets, bool quantize, uint32_t joint_influences, bool dedup,
+              ImportStats* stats) {
+              ImportOptions options;
+              options.optimize_meshes = optimize;
+              options.lod_levels = ToLodLevels(lods);
+              options.build_meshlets = meshlets;
+              options.quantize_attributes = quantize;
+              options.max_joint_influences = joint_influences;
+              options.deduplicate = dedup;
+              options.stats = stats;
+              if (huge_pages)
+                  options.allocator = GetHugePageStorageAllocator();
+              return ImportMany(paths, num_threads, options, ImportSceneFile);
+          },
+          nb::arg("paths"), nb::arg("num_threads") = 0, nb::arg("huge_pages") = false, nb::arg("optimize") = false,
+          nb::arg("lods") = LodArgs(), nb::arg("meshlets") = false, nb::arg("quantize") = false,
+          nb::arg("joint_influences") = 4, nb::arg("dedup") = false, nb::arg("stats").none() = nb::none(),
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Import many FBX or glTF files in parallel without holding the GIL. Returns one ImportResult per "
+          "path in input order, failures are reported in ImportResult.error. With stats every result "
+          "carries the ImportStats of its file and stats receives the merged stats of the batch");
     
+    m.def("import_gltf",
+          [](const char* path, uint32_t num_threads, bool huge_pages, bool optimize, const LodArgs& lods,
+              bool meshlets, bool quantize, bool dedup, ImportStats* stats) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              options.optimize_meshes = optimize;
+              options.lod_levels = ToLodLevels(lods);
+              options.build_meshlets = meshlets;
+              options.quantize_attributes = quantize;
+              options.deduplicate = dedup;
+              options.stats = stats;
+              if (huge_pages)
+                  options.allocator = GetHugePageStorageAllocator();
+              SceneStorage storage;
+              std::string error;
+              if (!ImportGltf(path, options, storage, &error))
+                  throw std::runtime_error(error);
+              return storage;
+          },
+          nb::arg("path"), nb::arg("num_threads") = 1, nb::arg("huge_pages") = false, nb::arg("optimize") = false,
+          nb::arg("lods") = LodArgs(), nb::arg("meshlets") = false, nb::arg("quantize") = false,
+          nb::arg("dedup") = false, nb::arg("stats").none() = nb::none(),
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Import a .gltf or .glb file into the same SceneStorage layout as import_fbx. Every "
+          "primitive becomes one mesh and its attributes share one index array");
+
+    m.def("import_fbx_buffer",
+          [](nb::handle buffer, uint32_t num_threads, bool huge_pages, bool optimize, const LodArgs& lods,
+              bool meshlets, bool quantize, uint32_t joint_influences, bool dedup, ImportStats* stats) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              options.optimize_meshes = optimize;
+              options.lod_levels = ToLodLevels(lods);
+              options.build_meshlets = meshlets;
+              options.quantize_attributes = quantize;
+              options.max_joint_influences = joint_influences;
+              options.deduplicate = dedup;
+              options.stats = stats;
+              if (huge_pages)
+                  options.allocator = GetHugePageStorageAllocator();
+              BufferView view(buffer);
+              SceneStorage storage;
+              std::string error;
+              bool imported = false;
+              {
+                  nb::gil_scoped_release release;
+                  imported = ImportFbxFromMemory(view.data(), view.size(), options, storage, &error);
+              }
+              if (!imported)
+                  throw std::runtime_error(error);
+              return storage;
+          },
+          nb::arg("buffer"), nb::arg("num_threads") = 1, nb::arg("huge_pages") = false, nb::arg("optimize") = false,
+          nb::arg("lods") = LodArgs(), nb::arg("meshlets") = false, nb::arg("quantize") = false,
+          nb::arg("joint_influences") = 4, nb::arg("dedup") = false, nb::arg("stats").none() = nb::none(),
+          "Import an FBX file from any contiguous bytes-like object (bytes, memoryview, NumPy array, "
+          "mmap) without copying it or touching disk. Takes the same options as import_fbx and "
+          "raises RuntimeError on failure");
+
+    m.def("import_gltf_buffer",
+          [](nb::handle buffer, const std::string& base_dir, uint32_t num_threads, bool huge_pages, bool optimize,
+              const LodArgs& lods, bool meshlets, bool quantize, bool dedup, ImportStats* stats) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              options.optimize_meshes = optimize;
+              options.lod_levels = ToLodLevels(lods);
+              options.build_meshlets = meshlets;
+              options.quantize_attributes = quantize;
+              options.deduplicate = dedup;
+              options.stats = stats;
+              if (huge_pages)
+                  options.allocator = GetHugePageStorageAllocator();
+              BufferView view(buffer);
+              SceneStorage storage;
+              std::string error;
+              bool imported = false;
+              {
+                  nb::gil_scoped_release release;
+                  imported = ImportGltfFromMemory(view.data(), view.size(), base_dir.c_str(), options, storage, &error);
+              }
+              if (!imported)
+                  throw std::runtime_error(error);
+              return storage;
+          },
+          nb::arg("buffer"), nb::arg("base_dir") = "", nb::arg("num_threads") = 1, nb::arg("huge_pages") = false,
+          nb::arg("optimize") = false, nb::arg("lods") = LodArgs(), nb::arg("meshlets") = false,
+          nb::arg("quantize") = false, nb::arg("dedup") = false, nb::arg("stats").none() = nb::none(),
+          "Import .gltf text or a .glb file from any contiguous bytes-like object without copying it "
+          "or touching disk. The GLB binary chunk is read in place, external buffer URIs resolve "
+          "against base_dir");
+
+    m.def("import_glb_mapped",
+          [](const char* path, uint32_t num_threads, ImportStats* stats) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              options.stats = stats;
+              SceneStorage storage;
+              std::string error;
+              if (!ImportGlbMapped(path, options, storage, &error))
+                  throw std::runtime_error(error);
+              return storage;
+          },
+          nb::arg("path"), nb::arg("num_threads") = 1, nb::arg("stats").none() = nb::none(),
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Import a .glb file keeping it memory mapped. Indices and float attributes already in "
+          "the stored layout are viewed in place in the file pages, which processes mapping the "
+          "same file share. Views are copy on write");
+
+    m.def("import_fbx_async",
+          [](std::string path, uint32_t num_threads, bool huge_pages, bool optimize, const LodArgs& lods,
+              bool meshlets, bool quantize, uint32_t joint_influences, bool dedup, nb::handle stats) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              options.optimize_meshes = optimize;
+              options.lod_levels = ToLodLevels(lods);
+              options.build_meshlets = meshlets;
+              options.quantize_attributes = quantize;
+              options.max_joint_influences = joint_influences;
+              options.deduplicate = dedup;
+              options.stats = stats.is_none() ? nullptr : nb::cast<ImportStats*>(stats);
+              if (huge_pages)
+                  options.allocator = GetHugePageStorageAllocator();
+              return SubmitImport([path, options](SceneStorage& storage, std::string* error) {
+                  return ImportFbx(path.c_str(), options, storage, error);
+              }, nb::borrow(stats));
+          },
+          nb::arg("path"), nb::arg("num_threads") = 1, nb::arg("huge_pages") = false, nb::arg("optimize") = false,
+          nb::arg("lods") = LodArgs(), nb::arg("meshlets") = false, nb::arg("quantize") = false,
+          nb::arg("joint_influences") = 4, nb::arg("dedup") = false, nb::arg("stats").none() = nb::none(),
+          "Start importing an FBX file on a native worker pool and return an ImportFuture. "
+          "Takes the same options as import_fbx, stats is filled once the future is done. "
+          "The import runs without the GIL");
+
+    nb::class_<ImportFuture>(m, "ImportFuture")
+        .def_prop_ro("future", [](ImportFuture &self) { return self.future; },
+            "The underlying concurrent.futures.Future, e.g. for concurrent.futures.as_completed")
+        .def("done", [](ImportFuture &self) { return self.future.attr("done")(); })
+        .def("cancel", [](ImportFuture &self) { return self.future.attr("cancel")(); },
+            "Cancel the import if it has not started yet")
+        .def("result", [](ImportFuture &self, nb::object timeout) { return self.future.attr("result")(timeout); },
+            nb::arg("timeout") = nb::none(),
+            "Wait for the SceneStorage, raises RuntimeError if the import failed")
+        .def("exception", [](ImportFuture &self, nb::object timeout) { return self.future.attr("exception")(timeout); },
+            nb::arg("timeout") = nb::none())
+        .def("add_done_callback", [](ImportFuture &self, nb::object fn) { self.future.attr("add_done_callback")(fn); },
+            nb::arg("fn"), "fn receives the underlying concurrent.futures.Future")
+        .def("__await__", [](ImportFuture &self) {
+            return nb::module_::import_("asyncio").attr("wrap_future")(self.future).attr("__await__")();
+        });
+
+    // Let pending imports finish before the interpreter goes away
+    nb::module_::import_("atexit").attr("register")(nb::cpp_function([]() {
+        std::unique_ptr<ThreadPool> pool = std::move(g_async_pool);
+        nb::gil_scoped_release release;
+        pool.reset();
+    }));
+
+    using mesh2py::fbx::LazyFbxScene;
+    m.def("open_fbx_lazy",
+          [](const char* path, uint32_t num_threads) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              std::string error;
+              std::unique_ptr<LazyFbxScene> scene;
+              {
+                  nb::gil_scoped_release release;
+                  scene = LazyFbxScene::Open(path, options, &error);
+              }
+              if (!scene)
+                  throw std::runtime_error(error);
+              return scene;
+          },
+          nb::arg("path"), nb::arg("num_threads") = 1,
+          "Open an FBX file with the node, mesh and attribute tables filled and convert the "
+          "mesh data only when it is first accessed");
+
+    // Loads the mesh before handing out views of its data
+    nb::class_<LazyFbxScene>(m, "LazyScene")
+        .def_prop_ro("storage", &LazyFbxScene::storage, nb::rv_policy::reference_internal,
+            "Scene tables. The face and attribute data of meshes not loaded yet are zero")
+        .def("load_mesh",
+            [](LazyFbxScene &self, uint32_t mesh_index) {
+                GetMeshInfo(self.storage(), mesh_index);
+                self.LoadMesh(mesh_index);
+            },
+            nb::arg("mesh_index"), nb::call_guard<nb::gil_scoped_release>())
+        .def("is_mesh_loaded",
+            [](LazyFbxScene &self, uint32_t mesh_index) {
+                GetMeshInfo(self.storage(), mesh_index);
+                return self.IsMeshLoaded(mesh_index);
+            },
+            nb::arg("mesh_index"))
+        .def("load_all_meshes", &LazyFbxScene::LoadAllMeshes, nb::call_guard<nb::gil_scoped_release>())
+        .def("faces",
+            [](LazyFbxScene &self, uint32_t mesh_index) {
+                MeshInfo& mesh_info = GetMeshInfo(self.storage(), mesh_index);
+                {
+                    nb::gil_scoped_release release;
+                    self.LoadMesh(mesh_index);
+                }
+                return MakeFacesView(self.storage(), mesh_info, nb::find(&self));
+            },
+            nb::arg("mesh_index"))
+        .def("attribute",
+            [](LazyFbxScene &self, uint32_t attrib_index) {
+                AttributeInfo& attrib_info = GetAttribInfo(self.storage(), attrib_index);
+                {
+                    nb::gil_scoped_release release;
+                    self.LoadMesh(self.GetAttributeMesh(attrib_index));
+                }
+                nb::object owner = nb::find(&self);
+                return nb::make_tuple(MakeIndicesView(self.storage(), attrib_info, owner),
+                                      MakeValuesView(self.storage(), attrib_info, owner));
+            },
+            nb::arg("attrib_index"),
+            "(indices, values) arrays of an attribute, loading its mesh first");
+
+    m.def("save_scene_storage",
+          [](const SceneStorage& storage, const char* path) {
+              std::string error;
+              if (!SaveSceneStorage(storage, path, &error))
+                  throw std::runtime_error(error);
+          },
+          nb::arg("storage"), nb::arg("path"),
+          "Write scene data to a binary cache file that map_scene_storage can reload");
+
+    m.def("map_scene_storage",
+          [](const char* path) {
+              SceneStorage storage;
+              std::string error;
+              if (!MapSceneStorage(path, storage, &error))
+                  throw std::runtime_error(error);
+              return storage;
+          },
+          nb::arg("path"),
+          "Map a scene cache file. The data and its array views stay in the shared, copy on write mapping");
+
+    m.def("build_unified_vertices",
+          [](const SceneStorage& storage, uint32_t num_threads) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              SceneStorage unified;
+              std::string error;
+              if (!BuildUnifiedVertices(storage, options, unified, &error))
+                  throw std::runtime_error(error);
+              return unified;
+          },
+          nb::arg("storage"), nb::arg("num_threads") = 1,
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Weld corners with identical attribute indices into unique vertices. Returns a new "
+          "SceneStorage where all attributes of a mesh share one uint32 index array and hold one "
+          "value per vertex, ready for a single index buffer over parallel vertex streams");
+
+    m.def("optimize_meshes",
+          [](const SceneStorage& storage, uint32_t num_threads) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              SceneStorage optimized;
+              std::string error;
+              if (!OptimizeMeshes(storage, options, optimized, &error))
+                  throw std::runtime_error(error);
+              return optimized;
+          },
+          nb::arg("storage"), nb::arg("num_threads") = 1,
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Unify and fan triangulate every mesh, then reorder it for the vertex cache, overdraw and "
+          "vertex fetch with meshoptimizer. Faces become triangles sharing one index array");
+
+    m.def("generate_lods",
+          [](const SceneStorage& storage, const LodArgs& lods, uint32_t num_threads) {
+              SceneStorage result = storage;
+              std::string error;
+              if (!GenerateLods(result, ToLodLevels(lods), num_threads, &error))
+                  throw std::runtime_error(error);
+              return result;
+          },
+          nb::arg("storage"), nb::arg("lods"), nb::arg("num_threads") = 1,
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Return a copy of an optimized storage with a LOD chain per triangle mesh. lods is a list "
+          "of (index_ratio, target_error) levels, each simplified from the previous one. A mesh "
+          "stops at the first level that does not get smaller, see lod_infos and lod_indices");
+
+    m.def("build_meshlets",
+          [](const SceneStorage& storage, uint32_t num_threads, uint32_t max_vertices, uint32_t max_triangles,
+              float cone_weight) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              options.meshlet_max_vertices = max_vertices;
+              options.meshlet_max_triangles = max_triangles;
+              options.meshlet_cone_weight = cone_weight;
+              SceneStorage result = storage;
+              std::string error;
+              if (!BuildMeshlets(result, options, &error))
+                  throw std::runtime_error(error);
+              return result;
+          },
+          nb::arg("storage"), nb::arg("num_threads") = 1, nb::arg("max_vertices") = 64,
+          nb::arg("max_triangles") = 124, nb::arg("cone_weight") = 0.25f,
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Return a copy of an optimized storage with every triangle mesh split into meshlets "
+          "with a bounding sphere and a backface cone each, see meshlet_infos, meshlet_vertices "
+          "and meshlet_triangles");
+
+    m.def("quantize_attributes",
+          [](const SceneStorage& storage, uint32_t num_threads, ValueEncoding position_encoding) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              options.position_encoding = position_encoding;
+              SceneStorage quantized;
+              std::string error;
+              if (!QuantizeAttributes(storage, options, quantized, &error))
+                  throw std::runtime_error(error);
+              return quantized;
+          },
+          nb::arg("storage"), nb::arg("num_threads") = 1, nb::arg("position_encoding") = ValueEncoding::Snorm16,
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Return a compact copy of a float32 storage: Float16 or Snorm16 positions normalized to "
+          "the mesh bounds, octahedral normals and tangents, Unorm8 colors, Float16 texture "
+          "coordinates and uint16 index arrays where they fit. Views keep the encoded dtype, "
+          "decoded_indices and decoded_values return float32 copies");
+
+    m.def("deduplicate",
+          [](const SceneStorage& storage, uint32_t num_threads) {
+              ImportOptions options;
+              options.num_threads = num_threads;
+              SceneStorage deduplicated;
+              std::string error;
+              if (!DeduplicateScene(storage, options, deduplicated, &error))
+                  throw std::runtime_error(error);
+              return deduplicated;
+          },
+          nb::arg("storage"), nb::arg("num_threads") = 1,
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Return a copy of a storage with every identical payload stored once, found by content "
+          "hash and confirmed byte for byte. Meshes that end up identical share one mesh_info and "
+          "their nodes point at it");
+
+    m.def("build_bvh",
+          [](const SceneStorage& storage, uint32_t num_threads) {
+              SceneBvh bvh;
+              std::string error;
+              if (!BuildSceneBvh(storage, num_threads, bvh, &error))
+                  throw std::runtime_error(error);
+              return bvh;
+          },
+          nb::arg("storage"), nb::arg("num_threads") = 1,
+          nb::call_guard<nb::gil_scoped_release>(),
+          "Build a SceneBvh over the world bounds of the nodes of a storage that have a mesh, "
+          "binned SAH splits with the subtrees built in parallel");
+
+    using BoundsView = nb::ndarray<float, nb::shape<-1, 2, 3>, nb::device::cpu, nb::c_contig, nb::numpy>;
+    nb::class_<SceneBvh>(m, "SceneBvh")
+        .def_prop_ro("node_bounds",
+            [](SceneBvh &self) {
+                return BoundsView((float *)self.node_bounds.data(), { self.node_bounds.size(), 2, 3 }, nb::find(&self));
+            },
+            "(N, 2, 3) float32 world (min, max) of every scene node, min above max for nodes "
+            "without a mesh")
+        .def_prop_ro("bvh_node_count", [](SceneBvh &self) { return self.nodes.size(); })
+        .def("query_boxes",
+            [](SceneBvh &self, PointsArg mins, PointsArg maxs, uint32_t num_threads) {
+                size_t count = GetQueryCount(mins, maxs, "mins and maxs need the same number of rows");
+                std::vector<std::vector<uint32_t>> hits(count);
+                {
+                    nb::gil_scoped_release release;
+                    ParallelFor(count, num_threads, [&](size_t q) {
+                        Aabb box;
+                        memcpy(box.min, mins.data() + 3 * q, sizeof(box.min));
+                        memcpy(box.max, maxs.data() + 3 * q, sizeof(box.max));
+                        QueryBox(self, box, hits[q]);
+                    });
+                }
+                int64_t *offsets = new int64_t[count + 1];
+                nb::capsule offset_owner(offsets, [](void *p) noexcept { delete[] (int64_t *)p; });
+                offsets[0] = 0;
+                for (size_t q = 0; q < count; ++q)
+                    offsets[q + 1] = offsets[q] + (int64_t)hits[q].size();
+                uint32_t *nodes = new uint32_t[offsets[count] > 0 ? offsets[count] : 1];
+                nb::capsule node_owner(nodes, [](void *p) noexcept { delete[] (uint32_t *)p; });
+                for (size_t q = 0; q < count; ++q)
+                    std::copy(hits[q].begin(), hits[q].end(), nodes + offsets[q]);
+                return nb::make_tuple(
+                    nb::ndarray<nb::numpy, int64_t, nb::shape<-1>>(offsets, { count + 1 }, offset_owner),
+                    nb::ndarray<nb::numpy, uint32_t, nb::shape<-1>>(nodes, { (size_t)offsets[count] }, node_owner));
+            },
+            nb::arg("mins"), nb::arg("maxs"), nb::arg("num_threads") = 1,
+            "Scene nodes overlapping each (min, max) box of two (Q, 3) float32 arrays, as (offsets, "
+            "nodes): the hits of box q are nodes[offsets[q]:offsets[q + 1]]")
+        .def("query_rays",
+            [](SceneBvh &self, PointsArg origins, PointsArg directions, float max_distance, uint32_t num_threads) {
+                size_t count = GetQueryCount(origins, directions, "origins and directions need the same number of rows");
+                int64_t *nodes = new int64_t[count > 0 ? count : 1];
+                nb::capsule node_owner(nodes, [](void *p) noexcept { delete[] (int64_t *)p; });
+                float *distances = new float[count > 0 ? count : 1];
+                nb::capsule distance_owner(distances, [](void *p) noexcept { delete[] (float *)p; });
+                {
+                    nb::gil_scoped_release release;
+                    ParallelFor(count, num_threads, [&](size_t q) {
+                        uint32_t node = QueryRay(self, origins.data() + 3 * q, directions.data() + 3 * q,
+                            max_distance, &distances[q]);
+                        nodes[q] = node == UINT32_MAX ? -1 : (int64_t)node;
+                    });
+                }
+                return nb::make_tuple(nb::ndarray<nb::numpy, int64_t, nb::shape<-1>>(nodes, { count }, node_owner),
+                    nb::ndarray<nb::numpy, float, nb::shape<-1>>(distances, { count }, distance_owner));
+            },
+            nb::arg("origins"), nb::arg("directions"), nb::arg("max_distance") = INFINITY,
+            nb::arg("num_threads") = 1,
+            "First scene node whose bounds each ray enters, as (nodes, distances): -1 and inf for "
+            "a miss, distance 0 when the origin is inside. Distances are in units of the direction "
+            "length")
+        .def("query_nearest",
+            [](SceneBvh &self, PointsArg points, uint32_t k, uint32_t num_threads) {
+                size_t count = points.shape(0);
+                size_t total = count * k;
+                int64_t *nodes = new int64_t[total > 0 ? total : 1];
+                nb::capsule node_owner(nodes, [](void *p) noexcept { delete[] (int64_t *)p; });
+                float *distances = new float[total > 0 ? total : 1];
+                nb::capsule distance_owner(distances, [](void *p) noexcept { delete[] (float *)p; });
+                {
+                    nb::gil_scoped_release release;
+                    ParallelFor(count, num_threads, [&](size_t q) {
+                        std::vector<uint32_t> found(k);
+                        uint32_t found_count = QueryNearest(self, points.data() + 3 * q, k, found.data(), distances + q * k);
+                        for (uint32_t i = 0; i < k; ++i) {
+                            nodes[q * k + i] = i < found_count ? (int64_t)found[i] : -1;
+                            if (i >= found_count)
+                                distances[q * k + i] = INFINITY;
+                        }
+                    });
+                }
+                return nb::make_tuple(nb::ndarray<nb::numpy, int64_t, nb::shape<-1, -1>>(nodes, { count, k }, node_owner),
+                    nb::ndarray<nb::numpy, float, nb::shape<-1, -1>>(distances, { count, k }, distance_owner));
+            },
+            nb::arg("points"), nb::arg("k") = 1, nb::arg("num_threads") = 1,
+            "The k scene nodes whose bounds are closest to each point of a (Q, 3) float32 array, "
+            "nearest first, as (nodes, distances) of shape (Q, k) padded with -1 and inf");
+
+    nb::enum_<ValueEncoding>(m, "ValueEncoding")
+        .value("Float32", ValueEncoding::Float32)
+        .value("Float16", ValueEncoding::Float16)
+        .value("Snorm16", ValueEncoding::Snorm16)
+        .value("Octahedral16", ValueEncoding::Octahedral16)
+        .value("Unorm8", ValueEncoding::Unorm8)
+        .value("Uint16", ValueEncoding::Uint16);
+
+    nb::enum_<IndexEncoding>(m, "IndexEncoding")
+        .value("Uint32", IndexEncoding::Uint32)
+        .value("Uint16", IndexEncoding::Uint16);
+
     // Expose VertexAttribType enum
     nb::enum_<VertexAttribType>(m, "VertexAttribType")
         .value("Position", VertexAttribType::Position)
@@ -54,7 +811,17 @@ NB_MODULE(NB_MODULE_NAME, m) {
         .def_rw("face_offset", &MeshInfo::face_offset)
         .def_rw("face_count", &MeshInfo::face_count)
         .def_rw("attrib_info_start_index", &MeshInfo::attrib_info_start_index)
-        .def_rw("attribute_info_count", &MeshInfo::attribute_info_count);
+        .def_rw("attribute_info_count", &MeshInfo::attribute_info_count)
+        .def_rw("lod_info_start_index", &MeshInfo::lod_info_start_index)
+        .def_rw("lod_info_count", &MeshInfo::lod_info_count)
+        .def_rw("meshlet_start_index", &MeshInfo::meshlet_start_index)
+        .def_rw("meshlet_count", &MeshInfo::meshlet_count)
+        .def_rw("joint_info_start_index", &MeshInfo::joint_info_start_index)
+        .def_rw("joint_info_count", &MeshInfo::joint_info_count)
+        .def_rw("blendshape_start_index", &MeshInfo::blendshape_start_index)
+        .def_rw("blendshape_count", &MeshInfo::blendshape_count)
+        .def_prop_ro("bounds_min", [](MeshInfo &self) { return nb::make_tuple(self.bounds_min[0], self.bounds_min[1], self.bounds_min[2]); })
+        .def_prop_ro("bounds_max", [](MeshInfo &self) { return nb::make_tuple(self.bounds_max[0], self.bounds_max[1], self.bounds_max[2]); });
     
     // Expose AttributeInfo struct
     nb::class_<AttributeInfo>(m, "AttributeInfo")
@@ -64,7 +831,46 @@ NB_MODULE(NB_MODULE_NAME, m) {
         .def_rw("attrib_type", &AttributeInfo::attrib_type)
         .def_rw("index_count", &AttributeInfo::index_count)
         .def_rw("value_count", &AttributeInfo::value_count)
-        .def_rw("num_value_per_index", &AttributeInfo::num_value_per_index);
+        .def_rw("num_value_per_index", &AttributeInfo::num_value_per_index)
+        .def_rw("value_encoding", &AttributeInfo::value_encoding)
+        .def_rw("index_encoding", &AttributeInfo::index_encoding);
+    
+    // Expose LodInfo struct
+    nb::class_<LodInfo>(m, "LodInfo")
+        .def(nb::init<>())
+        .def_rw("index_offset", &LodInfo::index_offset)
+        .def_rw("index_count", &LodInfo::index_count)
+        .def_rw("error", &LodInfo::error)
+        .def_rw("index_encoding", &LodInfo::index_encoding);
+    
+    // Expose MeshletInfo struct
+    nb::class_<MeshletInfo>(m, "MeshletInfo")
+        .def(nb::init<>())
+        .def_rw("vertex_offset", &MeshletInfo::vertex_offset)
+        .def_rw("triangle_offset", &MeshletInfo::triangle_offset)
+        .def_rw("vertex_count", &MeshletInfo::vertex_count)
+        .def_rw("triangle_count", &MeshletInfo::triangle_count)
+        .def_rw("radius", &MeshletInfo::radius)
+        .def_rw("cone_cutoff", &MeshletInfo::cone_cutoff)
+        .def_rw("vertex_encoding", &MeshletInfo::vertex_encoding);
+    
+    // Expose JointInfo struct
+    nb::class_<JointInfo>(m, "JointInfo")
+        .def(nb::init<>())
+        .def_rw("node_index", &JointInfo::node_index)
+        .def_prop_ro("inverse_bind_matrix",
+            [](JointInfo &self) { return TransformView(self.inverse_bind_matrix); },
+            nb::rv_policy::reference_internal);
+    
+    // Expose BlendshapeInfo struct
+    nb::class_<BlendshapeInfo>(m, "BlendshapeInfo")
+        .def(nb::init<>())
+        .def_rw("vertex_offset", &BlendshapeInfo::vertex_offset)
+        .def_rw("position_offset", &BlendshapeInfo::position_offset)
+        .def_rw("normal_offset", &BlendshapeInfo::normal_offset)
+        .def_rw("vertex_count", &BlendshapeInfo::vertex_count)
+        .def_rw("has_normals", &BlendshapeInfo::has_normals)
+        .def_rw("default_weight", &BlendshapeInfo::default_weight);
     
     // Expose Face struct
     nb::class_<Face>(m, "Face")
@@ -73,17 +879,311 @@ NB_MODULE(NB_MODULE_NAME, m) {
         .def_rw("num_of_indices", &Face::num_of_indices);
     
     using DataView = nb::ndarray<uint8_t, nb::shape<-1>, nb::device::cpu, nb::c_contig, nb::numpy>;
-    // Expose SceneStorage struct
+
+    nb::class_<ImportStats>(m, "ImportStats")
+        .def(nb::init<>())
+        .def_rw("record_trace", &ImportStats::record_trace,
+            "Set before the import to record Chrome trace events of the phases and workers")
+        .def_prop_ro("phase_wall_seconds", [](const ImportStats &self) {
+                nb::dict phases;
+                for (size_t i = 0; i < kImportPhaseCount; ++i)
+                    phases[GetImportPhaseName((ImportPhase)i)] = self.phases[i].wall_seconds;
+                return phases;
+            })
+        .def_prop_ro("phase_cpu_seconds", [](const ImportStats &self) {
+                nb::dict phases;
+                for (size_t i = 0; i < kImportPhaseCount; ++i)
+                    phases[GetImportPhaseName((ImportPhase)i)] = self.phases[i].cpu_seconds;
+                return phases;
+            },
+            "CPU time per phase, of the importing thread and the workers it started")
+        .def_prop_ro("total_wall_seconds", &ImportStats::GetTotalWallSeconds)
+        .def_prop_ro("total_cpu_seconds", &ImportStats::GetTotalCpuSeconds)
+        .def_ro("face_bytes", &ImportStats::face_bytes)
+        .def_prop_ro("attribute_bytes", [](const ImportStats &self) {
+                nb::dict bytes;
+                for (size_t i = 0; i < kAttribTypeCount; ++i)
+                    bytes[GetAttribTypeName(i)] = self.attribute_bytes[i];
+                return bytes;
+            },
+            "Bytes of indices and values written per attribute type")
+        .def_ro("peak_allocated_bytes", &ImportStats::peak_allocated_bytes)
+        .def_ro("node_count", &ImportStats::node_count)
+        .def_ro("mesh_count", &ImportStats::mesh_count)
+        .def_ro("face_count", &ImportStats::face_count)
+        .def_ro("vertex_count", &ImportStats::vertex_count)
+        .def_ro("max_workers", &ImportStats::max_workers)
+        .def_ro("worker_busy_seconds", &ImportStats::worker_busy_seconds)
+        .def_ro("worker_available_seconds", &ImportStats::worker_available_seconds)
+        .def_prop_ro("thread_utilization", &ImportStats::GetThreadUtilization,
+            "Busy share of the worker time of the parallel loops, 1 when nothing ran in parallel")
+        .def_prop_ro("trace_event_count", [](const ImportStats &self) { return self.trace_events.size(); })
+        .def("chrome_trace", &FormatChromeTrace, "Recorded trace events as Chrome trace JSON")
+        .def("write_chrome_trace",
+            [](const ImportStats &self, const char *path) {
+                std::string error;
+                if (!WriteChromeTrace(self, path, &error))
+                    throw std::runtime_error(error);
+            },
+            nb::arg("path"));
+
+    nb::class_<ImportResult>(m, "ImportResult")
+        .def_ro("storage", &ImportResult::storage)
+        .def_ro("success", &ImportResult::success)
+        .def_ro("error", &ImportResult::error)
+        .def_ro("stats", &ImportResult::stats)
+        .def("__bool__", [](const ImportResult &self) { return self.success; });
+
+    // Expose SceneStorage struct. The record tables are read only, replacing one would free the
+    // memory the column arrays alias; reading one returns a copy as a list.
     nb::class_<SceneStorage>(m, "SceneStorage")
         .def(nb::init<>())
-        .def_rw("nodes", &SceneStorage::nodes)
-        .def_rw("mesh_infos", &SceneStorage::mesh_infos)
-        .def_rw("attrib_infos", &SceneStorage::attrib_infos)
+        .def_ro("nodes", &SceneStorage::nodes)
+        .def_ro("mesh_infos", &SceneStorage::mesh_infos)
+        .def_ro("attrib_infos", &SceneStorage::attrib_infos)
+        .def_ro("lod_infos", &SceneStorage::lod_infos)
+        .def_ro("meshlet_infos", &SceneStorage::meshlet_infos)
+        .def_ro("joint_infos", &SceneStorage::joint_infos)
+        .def_ro("blendshape_infos", &SceneStorage::blendshape_infos)
         .def_prop_ro(
             "data",
             [](SceneStorage &self) {
                 return DataView(self.data.data(),{ self.data.size() });
             },
             nb::rv_policy::reference_internal
-        );
+        )
+        .def_prop_ro("node_parents", Column<uint32_t>(&SceneStorage::nodes, offsetof(Node, parent)),
+            "(N,) uint32 parent index of every node, aliasing the node table")
+        .def_prop_ro("node_mesh_indices", Column<uint32_t>(&SceneStorage::nodes, offsetof(Node, mesh_index)),
+            "(N,) uint32 mesh index of every node, aliasing the node table")
+        .def_prop_ro("node_transforms", Column<float>(&SceneStorage::nodes, offsetof(Node, transform), 16),
+            "(N, 16) float32 transform of every node, aliasing the node table")
+        .def_prop_ro("mesh_face_offsets", Column<DataOffset>(&SceneStorage::mesh_infos, offsetof(MeshInfo, face_offset)))
+        .def_prop_ro("mesh_face_counts", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, face_count)))
+        .def_prop_ro("mesh_attrib_info_start_indices", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, attrib_info_start_index)))
+        .def_prop_ro("mesh_attribute_info_counts", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, attribute_info_count)))
+        .def_prop_ro("mesh_lod_info_start_indices", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, lod_info_start_index)))
+        .def_prop_ro("mesh_lod_info_counts", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, lod_info_count)))
+        .def_prop_ro("mesh_bounds_min", Column<float>(&SceneStorage::mesh_infos, offsetof(MeshInfo, bounds_min), 3),
+            "(N, 3) float32 position bounds of every mesh, set at import")
+        .def_prop_ro("mesh_bounds_max", Column<float>(&SceneStorage::mesh_infos, offsetof(MeshInfo, bounds_max), 3))
+        .def_prop_ro("lod_index_offsets", Column<DataOffset>(&SceneStorage::lod_infos, offsetof(LodInfo, index_offset)))
+        .def_prop_ro("lod_index_counts", Column<uint32_t>(&SceneStorage::lod_infos, offsetof(LodInfo, index_count)))
+        .def_prop_ro("lod_errors", Column<float>(&SceneStorage::lod_infos, offsetof(LodInfo, error)),
+            "(N,) float32 simplification error of every LOD, relative to the mesh extents")
+        .def_prop_ro("lod_index_encodings", Column<uint8_t>(&SceneStorage::lod_infos, offsetof(LodInfo, index_encoding)),
+            "(N,) uint8 IndexEncoding of every LOD")
+        .def_prop_ro("mesh_meshlet_start_indices", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, meshlet_start_index)))
+        .def_prop_ro("mesh_meshlet_counts", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, meshlet_count)))
+        .def_prop_ro("meshlet_vertex_offsets", Column<DataOffset>(&SceneStorage::meshlet_infos, offsetof(MeshletInfo, vertex_offset)))
+        .def_prop_ro("meshlet_triangle_offsets", Column<DataOffset>(&SceneStorage::meshlet_infos, offsetof(MeshletInfo, triangle_offset)))
+        .def_prop_ro("meshlet_vertex_counts", Column<uint32_t>(&SceneStorage::meshlet_infos, offsetof(MeshletInfo, vertex_count)))
+        .def_prop_ro("meshlet_triangle_counts", Column<uint32_t>(&SceneStorage::meshlet_infos, offsetof(MeshletInfo, triangle_count)))
+        .def_prop_ro("meshlet_centers", Column<float>(&SceneStorage::meshlet_infos, offsetof(MeshletInfo, center), 3),
+            "(N, 3) float32 bounding sphere center of every meshlet")
+        .def_prop_ro("meshlet_radii", Column<float>(&SceneStorage::meshlet_infos, offsetof(MeshletInfo, radius)))
+        .def_prop_ro("meshlet_cone_apexes", Column<float>(&SceneStorage::meshlet_infos, offsetof(MeshletInfo, cone_apex), 3))
+        .def_prop_ro("meshlet_cone_axes", Column<float>(&SceneStorage::meshlet_infos, offsetof(MeshletInfo, cone_axis), 3))
+        .def_prop_ro("meshlet_cone_cutoffs", Column<float>(&SceneStorage::meshlet_infos, offsetof(MeshletInfo, cone_cutoff)),
+            "(N,) float32 cone cutoff, a meshlet faces away when dot(normalize(apex - eye), axis) >= cutoff")
+        .def_prop_ro("meshlet_vertex_encodings", Column<uint8_t>(&SceneStorage::meshlet_infos, offsetof(MeshletInfo, vertex_encoding)),
+            "(N,) uint8 IndexEncoding of the vertices of every meshlet")
+        .def_prop_ro("mesh_joint_info_start_indices", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, joint_info_start_index)))
+        .def_prop_ro("mesh_joint_info_counts", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, joint_info_count)))
+        .def_prop_ro("joint_node_indices", Column<uint32_t>(&SceneStorage::joint_infos, offsetof(JointInfo, node_index)),
+            "(N,) uint32 node index of every skin joint")
+        .def_prop_ro("joint_inverse_bind_matrices", Column<float>(&SceneStorage::joint_infos, offsetof(JointInfo, inverse_bind_matrix), 16),
+            "(N, 16) float32 column major geometry to bone matrix of every skin joint at bind time")
+        .def_prop_ro("mesh_blendshape_start_indices", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, blendshape_start_index)))
+        .def_prop_ro("mesh_blendshape_counts", Column<uint32_t>(&SceneStorage::mesh_infos, offsetof(MeshInfo, blendshape_count)))
+        .def_prop_ro("blendshape_vertex_counts", Column<uint32_t>(&SceneStorage::blendshape_infos, offsetof(BlendshapeInfo, vertex_count)))
+        .def_prop_ro("blendshape_default_weights", Column<float>(&SceneStorage::blendshape_infos, offsetof(BlendshapeInfo, default_weight)),
+            "(N,) float32 channel weight of every blend shape in the source file")
+        .def_prop_ro("attrib_index_offsets", Column<DataOffset>(&SceneStorage::attrib_infos, offsetof(AttributeInfo, index_offset)))
+        .def_prop_ro("attrib_value_offsets", Column<DataOffset>(&SceneStorage::attrib_infos, offsetof(AttributeInfo, value_offset)))
+        .def_prop_ro("attrib_types", Column<uint32_t>(&SceneStorage::attrib_infos, offsetof(AttributeInfo, attrib_type)),
+            "(N,) uint32 VertexAttribType bits of every attribute")
+        .def_prop_ro("attrib_index_counts", Column<uint32_t>(&SceneStorage::attrib_infos, offsetof(AttributeInfo, index_count)))
+        .def_prop_ro("attrib_value_counts", Column<uint32_t>(&SceneStorage::attrib_infos, offsetof(AttributeInfo, value_count)))
+        .def_prop_ro("attrib_num_value_per_index", Column<uint8_t>(&SceneStorage::attrib_infos, offsetof(AttributeInfo, num_value_per_index)))
+        .def_prop_ro("attrib_value_encodings", Column<uint8_t>(&SceneStorage::attrib_infos, offsetof(AttributeInfo, value_encoding)),
+            "(N,) uint8 ValueEncoding of every attribute")
+        .def_prop_ro("attrib_index_encodings", Column<uint8_t>(&SceneStorage::attrib_infos, offsetof(AttributeInfo, index_encoding)),
+            "(N,) uint8 IndexEncoding of every attribute")
+        .def("world_transforms",
+            [](SceneStorage &self, uint32_t num_threads) {
+                size_t node_count = self.nodes.size();
+                float *world = new float[16 * node_count];
+                nb::capsule owner(world, [](void *p) noexcept { delete[] (float *)p; });
+                std::string error;
+                bool computed;
+                {
+                    nb::gil_scoped_release release;
+                    computed = ComputeWorldTransforms(self, num_threads, world, &error);
+                }
+                if (!computed)
+                    throw std::runtime_error(error);
+                // Matrices are column major, the strides put them in (row, column) order
+                size_t shape[3] = { node_count, 4, 4 };
+                int64_t strides[3] = { 16, 1, 4 };
+                return ColumnView(world, 3, shape, owner, strides, nb::dtype<float>());
+            },
+            nb::arg("num_threads") = 1,
+            "(N, 4, 4) float32 world matrix of every node, world[n] @ p maps a column vector from "
+            "node space to world space. Computed natively, parents before children, one batch per "
+            "hierarchy level")
+        .def("faces",
+            [](SceneStorage &self, uint32_t mesh_index) {
+                return MakeFacesView(self, GetMeshInfo(self, mesh_index), nb::find(&self));
+            },
+            nb::arg("mesh_index"),
+            "(face_count, 2) uint32 array of (indices_begin, num_of_indices) aliasing the storage")
+        .def("attribute_indices",
+            [](SceneStorage &self, uint32_t attrib_index) {
+                return MakeIndicesView(self, GetAttribInfo(self, attrib_index), nb::find(&self));
+            },
+            nb::arg("attrib_index"),
+            "(index_count,) uint32 or uint16 array aliasing the storage, see index_encoding")
+        .def("attribute_values",
+            [](SceneStorage &self, uint32_t attrib_index) {
+                return MakeValuesView(self, GetAttribInfo(self, attrib_index), nb::find(&self));
+            },
+            nb::arg("attrib_index"),
+            "(value_count, width) array aliasing the storage in the dtype of its value_encoding, width "
+            "is 2 for Octahedral16 and num_value_per_index otherwise")
+        .def("decoded_indices",
+            [](SceneStorage &self, uint32_t attrib_index) {
+                AttributeInfo& attrib_info = GetAttribInfo(self, attrib_index);
+                uint32_t *indices = new uint32_t[attrib_info.index_count];
+                nb::capsule owner(indices, [](void *p) noexcept { delete[] (uint32_t *)p; });
+                DecodeIndices(self, attrib_info, indices);
+                return IndicesView(indices, { attrib_info.index_count }, owner);
+            },
+            nb::arg("attrib_index"),
+            "(index_count,) uint32 copy of the indices of an attribute in any encoding")
+        .def("decoded_values",
+            [](SceneStorage &self, uint32_t attrib_index) {
+                AttributeInfo& attrib_info = GetAttribInfo(self, attrib_index);
+                MeshInfo& mesh_info = GetAttribMesh(self, attrib_index);
+                float *values = new float[(size_t)attrib_info.value_count * attrib_info.num_value_per_index];
+                nb::capsule owner(values, [](void *p) noexcept { delete[] (float *)p; });
+                DecodeValues(self, mesh_info, attrib_info, values);
+                return ValuesView(values, { attrib_info.value_count, attrib_info.num_value_per_index }, owner);
+            },
+            nb::arg("attrib_index"),
+            "(value_count, num_value_per_index) float32 copy of the values of an attribute, "
+            "dequantized against the mesh bounds")
+        .def("attribute",
+            [](SceneStorage &self, uint32_t attrib_index) {
+                AttributeInfo& attrib_info = GetAttribInfo(self, attrib_index);
+                nb::object owner = nb::find(&self);
+                return nb::make_tuple(MakeIndicesView(self, attrib_info, owner), MakeValuesView(self, attrib_info, owner));
+            },
+            nb::arg("attrib_index"),
+            "(indices, values) arrays of an attribute, both aliasing the storage")
+        .def("lod_indices",
+            [](SceneStorage &self, uint32_t lod_index) {
+                if (lod_index >= self.lod_infos.size())
+                    throw nb::index_error("lod index out of range");
+                const LodInfo& lod_info = self.lod_infos[lod_index];
+                return MakeIndicesView(self, lod_info.index_offset, lod_info.index_count, lod_info.index_encoding,
+                    nb::find(&self));
+            },
+            nb::arg("lod_index"),
+            "(index_count,) uint32 or uint16 triangle list of a LOD aliasing the storage, it indexes the "
+            "vertices of the mesh's attributes, see index_encoding")
+        .def("meshlet_vertices",
+            [](SceneStorage &self, uint32_t meshlet_index) {
+                if (meshlet_index >= self.meshlet_infos.size())
+                    throw nb::index_error("meshlet index out of range");
+                const MeshletInfo& meshlet_info = self.meshlet_infos[meshlet_index];
+                return MakeIndicesView(self, meshlet_info.vertex_offset, meshlet_info.vertex_count,
+                    meshlet_info.vertex_encoding, nb::find(&self));
+            },
+            nb::arg("meshlet_index"),
+            "(vertex_count,) uint32 or uint16 mesh vertices of a meshlet aliasing the storage, see "
+            "vertex_encoding")
+        .def("meshlet_triangles",
+            [](SceneStorage &self, uint32_t meshlet_index) {
+                if (meshlet_index >= self.meshlet_infos.size())
+                    throw nb::index_error("meshlet index out of range");
+                const MeshletInfo& meshlet_info = self.meshlet_infos[meshlet_index];
+                return MeshletTrianglesView(self.data.data() + meshlet_info.triangle_offset, { meshlet_info.triangle_count, 3 },
+                    nb::find(&self));
+            },
+            nb::arg("meshlet_index"),
+            "(triangle_count, 3) uint8 triangles of a meshlet aliasing the storage, they index "
+            "meshlet_vertices")
+        .def("blendshape_vertices",
+            [](SceneStorage &self, uint32_t shape_index) {
+                const BlendshapeInfo& shape = GetBlendshapeInfo(self, shape_index);
+                return IndicesView((uint32_t*)(self.data.data() + shape.vertex_offset), { shape.vertex_count },
+                    nb::find(&self));
+            },
+            nb::arg("shape_index"),
+            "(vertex_count,) uint32 position values a blend shape moves, aliasing the storage")
+        .def("blendshape_deltas",
+            [](SceneStorage &self, uint32_t shape_index) {
+                const BlendshapeInfo& shape = GetBlendshapeInfo(self, shape_index);
+                nb::object owner = nb::find(&self);
+                nb::object positions = nb::cast(ValuesView((float*)(self.data.data() + shape.position_offset),
+                    { shape.vertex_count, 3 }, owner));
+                nb::object normals = shape.has_normals
+                    ? nb::cast(ValuesView((float*)(self.data.data() + shape.normal_offset), { shape.vertex_count, 3 }, owner))
+                    : nb::none();
+                return nb::make_tuple(positions, normals);
+            },
+            nb::arg("shape_index"),
+            "(positions, normals) (vertex_count, 3) float32 deltas of a blend shape aliasing the "
+            "storage, normals is None when the mesh has no normal deltas")
+        .def("evaluate_blendshapes",
+            [](SceneStorage &self, uint32_t mesh_index, WeightsArg weights, bool normals) {
+                MeshInfo& mesh_info = GetMeshInfo(self, mesh_index);
+                if (weights.shape(0) != mesh_info.blendshape_count)
+                    throw nb::value_error("expected one weight per blend shape of the mesh");
+                for (size_t s = 0; s < weights.shape(0); ++s)
+                    if (!std::isfinite(weights.data()[s]))
+                        throw nb::value_error("blend shape weights must be finite");
+                AttributeInfo* position_info = FindAttribute(self, mesh_info, VertexAttribType::Position);
+                if (!position_info || position_info->num_value_per_index != 3)
+                    throw nb::value_error("mesh has no float3 positions");
+                AttributeInfo* normal_info = normals ? FindAttribute(self, mesh_info, VertexAttribType::Normal) : nullptr;
+                // Deduplicated attributes can share an index array without sharing the value count,
+                // the normal deltas index the normals like the positions
+                if (normals && (!normal_info || normal_info->index_offset != position_info->index_offset ||
+                    normal_info->index_count != position_info->index_count ||
+                    normal_info->value_count != position_info->value_count || normal_info->num_value_per_index != 3))
+                    throw nb::value_error("normals need a float3 Normal attribute sharing the position "
+                        "index array and value count, e.g. after optimize_meshes");
+
+                size_t value_count = position_info->value_count;
+                float *positions = new float[3 * value_count];
+                nb::capsule position_owner(positions, [](void *p) noexcept { delete[] (float *)p; });
+                float *normal_values = nullptr;
+                nb::object normal_owner;
+                if (normals) {
+                    normal_values = new float[3 * (size_t)normal_info->value_count];
+                    normal_owner = nb::capsule(normal_values, [](void *p) noexcept { delete[] (float *)p; });
+                }
+                bool evaluated = false;
+                std::string error;
+                {
+                    nb::gil_scoped_release release;
+                    DecodeValues(self, mesh_info, *position_info, positions);
+                    if (normals)
+                        DecodeValues(self, mesh_info, *normal_info, normal_values);
+                    evaluated = EvaluateBlendshapes(self, mesh_info, weights.data(), positions, normal_values, &error);
+                }
+                if (!evaluated)
+                    throw std::runtime_error(error);
+                nb::object result = nb::cast(ValuesView(positions, { value_count, 3 }, position_owner));
+                if (!normals)
+                    return result;
+                return nb::object(nb::make_tuple(result,
+                    ValuesView(normal_values, { normal_info->value_count, 3 }, normal_owner)));
+            },
+            nb::arg("mesh_index"), nb::arg("weights"), nb::arg("normals") = false,
+            "(value_count, 3) float32 positions of a mesh with its blend shapes applied natively "
+            "with SIMD, weights holds one float32 per blend shape of the mesh. With normals=True "
+            "returns (positions, normals), the normal deltas are added without renormalizing");
 }
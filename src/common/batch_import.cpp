@@ -0,0 +1,41 @@
+#include "batch_import.h"
+
+#include "thread_pool.h"
+
+#include <exception>
+
+namespace mesh2py::common {
+
+std::vector<ImportResult> ImportMany(const std::vector<std::string>& paths, uint32_t num_threads,
+    const ImportOptions& options, const ImportFunction& import, const ImportCallback& on_result) {
+    std::vector<ImportResult> results(paths.size());
+    ParallelFor(paths.size(), num_threads, [&](size_t i) {
+        ImportResult& result = results[i];
+        // A throwing import, such as std::bad_alloc growing the data blob, fails only its file
+        try {
+            if (options.stats) {
+                ImportOptions file_options = options;
+                file_options.stats = &result.stats;
+                result.stats.record_trace = options.stats->record_trace;
+                result.success = import(paths[i].c_str(), file_options, result.storage, &result.error);
+            } else {
+                result.success = import(paths[i].c_str(), options, result.storage, &result.error);
+            }
+        } catch (const std::exception& e) {
+            result.storage = SceneStorage();
+            result.error = e.what();
+            result.success = false;
+        }
+        if (on_result) {
+            on_result(i, result);
+        }
+    });
+    if (options.stats) {
+        for (size_t i = 0; i < results.size(); ++i) {
+            MergeImportStats(*options.stats, results[i].stats, (uint32_t)i);
+        }
+    }
+    return results;
+}
+
+}
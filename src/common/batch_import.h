@@ -0,0 +1,38 @@
+#pragma once
+
+#include "import_options.h"
+#include "import_stats.h"
+#include "scene_data.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mesh2py::common {
+
+struct ImportResult {
+    SceneStorage storage;
+    bool success = false;
+    // Reason of the failure when success is false
+    std::string error;
+    // Stats of this file when the batch collects them
+    ImportStats stats;
+};
+
+// Single file importer such as ImportFbx, returns false and fills `error` on failure
+using ImportFunction = std::function<bool(const char* path, const ImportOptions& options,
+    SceneStorage& storage, std::string* error)>;
+
+// Called from a worker thread as soon as the file at `index` has been imported
+using ImportCallback = std::function<void(size_t index, ImportResult& result)>;
+
+// Imports every path with `import` on up to `num_threads` workers (0 uses every hardware
+// thread) and returns the results in input order. Files are scheduled with work stealing, so
+// a few huge assets do not serialize the batch. `options.num_threads` still applies inside each
+// file, keep it at 1 to avoid oversubscribing the machine. When `options.stats` is set every
+// file collects its own ImportResult::stats, with trace events if options.stats->record_trace
+// is, and `options.stats` receives the merged stats of the batch.
+std::vector<ImportResult> ImportMany(const std::vector<std::string>& paths, uint32_t num_threads,
+    const ImportOptions& options, const ImportFunction& import, const ImportCallback& on_result = {});
+
+}
@@ -0,0 +1,187 @@
+#include "blendshapes.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MESH2PY_X86 1
+#include <immintrin.h>
+#endif
+
+namespace mesh2py::common {
+
+namespace {
+
+// Values of the Position attribute, the blend shape vertices index them
+uint32_t GetPositionCount(const SceneStorage& storage, const MeshInfo& mesh_info) {
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        const AttributeInfo& attrib_info = storage.attrib_infos[mesh_info.attrib_info_start_index + a];
+        if (attrib_info.attrib_type == VertexAttribType::Position) {
+            return attrib_info.value_count;
+        }
+    }
+    return 0;
+}
+
+// dst[vertices[i]] += weight * deltas[i] for the float3 deltas of one shape
+#if MESH2PY_X86
+void AddDeltas(float* dst, uint32_t vertex_count, const uint32_t* vertices, const float* deltas, uint32_t count,
+    float weight) {
+    // Four wide loads and stores read one float past the delta and the vertex, the fourth
+    // lane adds zero. The last delta and the last vertex are added one float at a time.
+    const __m128 xyz_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128 scale = _mm_set1_ps(weight);
+    for (uint32_t i = 0; i < count; ++i) {
+        float* vertex = dst + 3 * (size_t)vertices[i];
+        if (i + 1 == count || vertices[i] + 1 == vertex_count) {
+            vertex[0] += weight * deltas[3 * i];
+            vertex[1] += weight * deltas[3 * i + 1];
+            vertex[2] += weight * deltas[3 * i + 2];
+            continue;
+        }
+        __m128 delta = _mm_and_ps(_mm_loadu_ps(deltas + 3 * i), xyz_mask);
+        _mm_storeu_ps(vertex, _mm_add_ps(_mm_loadu_ps(vertex), _mm_mul_ps(delta, scale)));
+    }
+}
+#else
+void AddDeltas(float* dst, uint32_t, const uint32_t* vertices, const float* deltas, uint32_t count, float weight) {
+    for (uint32_t i = 0; i < count; ++i) {
+        float* vertex = dst + 3 * (size_t)vertices[i];
+        vertex[0] += weight * deltas[3 * i];
+        vertex[1] += weight * deltas[3 * i + 1];
+        vertex[2] += weight * deltas[3 * i + 2];
+    }
+}
+#endif
+
+}
+
+void RemapBlendshapes(const SceneStorage& storage, const MeshInfo& mesh_info, std::span<const uint32_t> sources,
+    uint32_t source_count, MeshBlendshapes& shapes) {
+    shapes = {};
+    if (mesh_info.blendshape_count == 0) {
+        return;
+    }
+
+    // New vertices of every old vertex as contiguous ranges
+    std::vector<uint32_t> target_begin(source_count + 2, 0);
+    for (uint32_t source : sources) {
+        if (source < source_count) {
+            ++target_begin[source + 2];
+        }
+    }
+    for (size_t i = 2; i < target_begin.size(); ++i) {
+        target_begin[i] += target_begin[i - 1];
+    }
+    std::vector<uint32_t> targets(target_begin[source_count + 1]);
+    for (uint32_t v = 0; v < sources.size(); ++v) {
+        if (sources[v] < source_count) {
+            targets[target_begin[sources[v] + 1]++] = v;
+        }
+    }
+
+    const BlendshapeInfo* infos = &storage.blendshape_infos[mesh_info.blendshape_start_index];
+    bool has_normals = infos[0].has_normals != 0;
+    for (uint32_t s = 0; s < mesh_info.blendshape_count; ++s) {
+        const BlendshapeInfo& info = infos[s];
+        const uint32_t* vertices = (const uint32_t*)(storage.data.data() + info.vertex_offset);
+        const float* position_deltas = (const float*)(storage.data.data() + info.position_offset);
+        const float* normal_deltas = (const float*)(storage.data.data() + info.normal_offset);
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < info.vertex_count; ++i) {
+            uint32_t source = vertices[i];
+            if (source >= source_count) {
+                continue;
+            }
+            for (uint32_t t = target_begin[source]; t < target_begin[source + 1]; ++t) {
+                shapes.vertices.push_back(targets[t]);
+                shapes.position_deltas.insert(shapes.position_deltas.end(), position_deltas + 3 * i, position_deltas + 3 * i + 3);
+                if (has_normals) {
+                    shapes.normal_deltas.insert(shapes.normal_deltas.end(), normal_deltas + 3 * i, normal_deltas + 3 * i + 3);
+                }
+                ++count;
+            }
+        }
+        shapes.vertex_counts.push_back(count);
+    }
+}
+
+uint64_t LayoutBlendshapes(BlendshapeInfo* shapes, uint32_t shape_count, bool has_normals, uint64_t current_offset) {
+    uint64_t total = 0;
+    for (uint32_t s = 0; s < shape_count; ++s) {
+        total += shapes[s].vertex_count;
+    }
+    uint64_t vertex_offset = align_up(current_offset, 16);
+    uint64_t position_offset = align_up(vertex_offset + total * sizeof(uint32_t), 16);
+    uint64_t normal_offset = align_up(position_offset + total * 3 * sizeof(float), 16);
+    current_offset = has_normals ? normal_offset + total * 3 * sizeof(float) : position_offset + total * 3 * sizeof(float);
+
+    uint64_t first = 0;
+    for (uint32_t s = 0; s < shape_count; ++s) {
+        shapes[s].vertex_offset = (DataOffset)(vertex_offset + first * sizeof(uint32_t));
+        shapes[s].position_offset = (DataOffset)(position_offset + first * 3 * sizeof(float));
+        shapes[s].normal_offset = has_normals ? (DataOffset)(normal_offset + first * 3 * sizeof(float)) : 0;
+        shapes[s].has_normals = has_normals ? 1 : 0;
+        first += shapes[s].vertex_count;
+    }
+    return current_offset;
+}
+
+uint64_t GetBlendshapeBlockSize(const SceneStorage& storage, const MeshInfo& mesh_info) {
+    const BlendshapeInfo& first = storage.blendshape_infos[mesh_info.blendshape_start_index];
+    const BlendshapeInfo& last = storage.blendshape_infos[mesh_info.blendshape_start_index + mesh_info.blendshape_count - 1];
+    uint64_t end = first.has_normals ? last.normal_offset : last.position_offset;
+    return end + (uint64_t)last.vertex_count * 3 * sizeof(float) - first.vertex_offset;
+}
+
+void WriteBlendshapes(SceneStorage& storage, const MeshInfo& mesh_info, const MeshBlendshapes& shapes) {
+    if (mesh_info.blendshape_count == 0) {
+        return;
+    }
+    const BlendshapeInfo& first = storage.blendshape_infos[mesh_info.blendshape_start_index];
+    if (!shapes.vertices.empty()) {
+        memcpy(storage.data.data() + first.vertex_offset, shapes.vertices.data(), sizeof(uint32_t) * shapes.vertices.size());
+        memcpy(storage.data.data() + first.position_offset, shapes.position_deltas.data(),
+            sizeof(float) * shapes.position_deltas.size());
+    }
+    ZeroPadding(storage, first.vertex_offset + sizeof(uint32_t) * shapes.vertices.size());
+    ZeroPadding(storage, first.position_offset + sizeof(float) * shapes.position_deltas.size());
+    if (first.has_normals) {
+        if (!shapes.normal_deltas.empty()) {
+            memcpy(storage.data.data() + first.normal_offset, shapes.normal_deltas.data(),
+                sizeof(float) * shapes.normal_deltas.size());
+        }
+        ZeroPadding(storage, first.normal_offset + sizeof(float) * shapes.normal_deltas.size());
+    }
+}
+
+bool EvaluateBlendshapes(const SceneStorage& storage, const MeshInfo& mesh_info, const float* weights,
+    float* positions, float* normals, std::string* error) {
+    // A NaN or infinite weight would spread into every vertex its shape moves
+    for (uint32_t s = 0; s < mesh_info.blendshape_count; ++s) {
+        if (!std::isfinite(weights[s])) {
+            if (error) {
+                *error = "weight of blend shape " + std::to_string(s) + " is not finite";
+            }
+            return false;
+        }
+    }
+
+    uint32_t vertex_count = GetPositionCount(storage, mesh_info);
+    for (uint32_t s = 0; s < mesh_info.blendshape_count; ++s) {
+        const BlendshapeInfo& info = storage.blendshape_infos[mesh_info.blendshape_start_index + s];
+        if (weights[s] == 0.0f || info.vertex_count == 0) {
+            continue;
+        }
+        const uint32_t* vertices = (const uint32_t*)(storage.data.data() + info.vertex_offset);
+        AddDeltas(positions, vertex_count, vertices, (const float*)(storage.data.data() + info.position_offset),
+            info.vertex_count, weights[s]);
+        if (normals && info.has_normals) {
+            AddDeltas(normals, vertex_count, vertices, (const float*)(storage.data.data() + info.normal_offset),
+                info.vertex_count, weights[s]);
+        }
+    }
+    return true;
+}
+
+}
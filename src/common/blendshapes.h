@@ -0,0 +1,46 @@
+#pragma once
+
+#include "scene_data.h"
+
+#include <span>
+#include <string>
+#include <vector>
+
+namespace mesh2py::common {
+
+// Blend shape arrays of one mesh, the entries of its shapes concatenated in order
+struct MeshBlendshapes {
+    std::vector<uint32_t> vertex_counts;
+    std::vector<uint32_t> vertices;
+    std::vector<float> position_deltas;
+    // Empty when the shapes of the mesh have no normal deltas
+    std::vector<float> normal_deltas;
+};
+
+// Moves the blend shapes of `mesh_info` onto new vertices: vertex v takes the deltas of old
+// vertex sources[v], UINT32_MAX for none. An old vertex may feed several new ones.
+// `source_count` is the number of old vertices. Used by the stages that rebuild the vertices.
+void RemapBlendshapes(const SceneStorage& storage, const MeshInfo& mesh_info, std::span<const uint32_t> sources,
+    uint32_t source_count, MeshBlendshapes& shapes);
+
+// Places the arrays of `shape_count` shapes whose vertex_count is set at `current_offset`:
+// the vertex indices of all shapes, then their position deltas, then their normal deltas when
+// `has_normals`. Returns the end offset.
+uint64_t LayoutBlendshapes(BlendshapeInfo* shapes, uint32_t shape_count, bool has_normals, uint64_t current_offset);
+
+// Bytes from the first to the end of the last blend shape array of a mesh with blend shapes,
+// the arrays move as one block
+uint64_t GetBlendshapeBlockSize(const SceneStorage& storage, const MeshInfo& mesh_info);
+
+// Writes `shapes` to the arrays LayoutBlendshapes placed for `mesh_info`
+void WriteBlendshapes(SceneStorage& storage, const MeshInfo& mesh_info, const MeshBlendshapes& shapes);
+
+// Adds the deltas of the blend shapes of `mesh_info`, shape i scaled by weights[i], to
+// `positions` and `normals` (nullptr to skip), which hold a float3 per value of the mesh
+// Position attribute. Shapes with a zero weight are skipped, the deltas are applied with SIMD.
+// Returns false and stores the reason in `error` (when not null), leaving `positions` and
+// `normals` untouched, when a weight is not finite.
+bool EvaluateBlendshapes(const SceneStorage& storage, const MeshInfo& mesh_info, const float* weights,
+    float* positions, float* normals, std::string* error);
+
+}
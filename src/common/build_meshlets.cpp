@@ -0,0 +1,154 @@
+#include "build_meshlets.h"
+
+#include "optimize_meshes.h"
+#include "quantize_attributes.h"
+#include "thread_pool.h"
+
+#include <meshoptimizer.h>
+
+#include <cstring>
+
+namespace mesh2py::common {
+
+namespace {
+
+// meshoptimizer limits for the meshlet size
+constexpr uint32_t kMaxMeshletVertices = 256;
+constexpr uint32_t kMaxMeshletTriangles = 512;
+
+struct MeshMeshlets {
+    std::vector<meshopt_Meshlet> meshlets;
+    std::vector<meshopt_Bounds> bounds;
+    std::vector<uint32_t> vertices;
+    std::vector<uint8_t> triangles;
+};
+
+void BuildMeshMeshlets(const SceneStorage& storage, const MeshInfo& mesh_info, const ImportOptions& options,
+    MeshMeshlets& mesh) {
+    const AttributeInfo* positions = GetTrianglePositions(storage, mesh_info);
+    if (!positions || positions->index_count == 0) {
+        return;
+    }
+    const uint32_t* indices = (const uint32_t*)(storage.data.data() + positions->index_offset);
+    const float* vertices = (const float*)(storage.data.data() + positions->value_offset);
+    size_t index_count = positions->index_count;
+    size_t vertex_count = positions->value_count;
+    size_t max_vertices = options.meshlet_max_vertices;
+    size_t max_triangles = options.meshlet_max_triangles;
+
+    size_t max_meshlets = meshopt_buildMeshletsBound(index_count, max_vertices, max_triangles);
+    mesh.meshlets.resize(max_meshlets);
+    mesh.vertices.resize(max_meshlets * max_vertices);
+    mesh.triangles.resize(max_meshlets * max_triangles * 3);
+    size_t meshlet_count = meshopt_buildMeshlets(mesh.meshlets.data(), mesh.vertices.data(), mesh.triangles.data(),
+        indices, index_count, vertices, vertex_count, 3 * sizeof(float), max_vertices, max_triangles,
+        options.meshlet_cone_weight);
+
+    mesh.meshlets.resize(meshlet_count);
+    const meshopt_Meshlet& last = mesh.meshlets.back();
+    mesh.vertices.resize(last.vertex_offset + last.vertex_count);
+    mesh.triangles.resize(last.triangle_offset + last.triangle_count * 3);
+
+    mesh.bounds.resize(meshlet_count);
+    for (size_t i = 0; i < meshlet_count; ++i) {
+        const meshopt_Meshlet& meshlet = mesh.meshlets[i];
+        meshopt_optimizeMeshlet(&mesh.vertices[meshlet.vertex_offset], &mesh.triangles[meshlet.triangle_offset],
+            meshlet.triangle_count, meshlet.vertex_count);
+        mesh.bounds[i] = meshopt_computeMeshletBounds(&mesh.vertices[meshlet.vertex_offset],
+            &mesh.triangles[meshlet.triangle_offset], meshlet.triangle_count, vertices, vertex_count,
+            3 * sizeof(float));
+    }
+}
+
+void WriteMeshlets(SceneStorage& storage, const MeshInfo& mesh_info, const MeshMeshlets& mesh) {
+    if (mesh_info.meshlet_count == 0) {
+        return;
+    }
+    const MeshletInfo& first = storage.meshlet_infos[mesh_info.meshlet_start_index];
+    memcpy(storage.data.data() + first.vertex_offset, mesh.vertices.data(), sizeof(uint32_t) * mesh.vertices.size());
+    ZeroPadding(storage, first.vertex_offset + sizeof(uint32_t) * mesh.vertices.size());
+    memcpy(storage.data.data() + first.triangle_offset, mesh.triangles.data(), mesh.triangles.size());
+    ZeroPadding(storage, first.triangle_offset + mesh.triangles.size());
+}
+
+}
+
+bool BuildMeshlets(SceneStorage& storage, const ImportOptions& options, std::string* error) {
+    if (!storage.meshlet_infos.empty()) {
+        if (error) {
+            *error = "storage already has meshlets";
+        }
+        return false;
+    }
+    if (IsQuantized(storage)) {
+        if (error) {
+            *error = "quantized storage, build meshlets before QuantizeAttributes";
+        }
+        return false;
+    }
+    if (options.meshlet_max_vertices < 3 || options.meshlet_max_vertices > kMaxMeshletVertices ||
+        options.meshlet_max_triangles == 0 || options.meshlet_max_triangles > kMaxMeshletTriangles ||
+        options.meshlet_max_triangles % 4 != 0) {
+        if (error) {
+            *error = "meshlets need 3 to 256 vertices and a multiple of 4 up to 512 triangles";
+        }
+        return false;
+    }
+
+    std::vector<MeshMeshlets> meshes(storage.mesh_infos.size());
+    ParallelFor(meshes.size(), options.num_threads, [&](size_t mesh_index) {
+        BuildMeshMeshlets(storage, storage.mesh_infos[mesh_index], options, meshes[mesh_index]);
+    });
+
+    // Every mesh gets one vertex and one triangle array behind the existing data
+    uint64_t current_offset = storage.data.size();
+    std::vector<MeshletInfo> meshlet_infos;
+    for (uint32_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
+        const MeshMeshlets& mesh = meshes[mesh_index];
+        MeshInfo& mesh_info = storage.mesh_infos[mesh_index];
+        mesh_info.meshlet_start_index = (uint32_t)meshlet_infos.size();
+        mesh_info.meshlet_count = (uint32_t)mesh.meshlets.size();
+        if (mesh.meshlets.empty()) {
+            continue;
+        }
+
+        uint64_t vertex_offset = align_up(current_offset, 16);
+        uint64_t triangle_offset = align_up(vertex_offset + mesh.vertices.size() * sizeof(uint32_t), 16);
+        current_offset = triangle_offset + mesh.triangles.size();
+        for (size_t i = 0; i < mesh.meshlets.size(); ++i) {
+            const meshopt_Meshlet& meshlet = mesh.meshlets[i];
+            const meshopt_Bounds& bounds = mesh.bounds[i];
+            MeshletInfo meshlet_info = {};
+            meshlet_info.vertex_offset = (DataOffset)(vertex_offset + meshlet.vertex_offset * sizeof(uint32_t));
+            meshlet_info.triangle_offset = (DataOffset)(triangle_offset + meshlet.triangle_offset);
+            meshlet_info.vertex_count = meshlet.vertex_count;
+            meshlet_info.triangle_count = meshlet.triangle_count;
+            memcpy(meshlet_info.center, bounds.center, sizeof(meshlet_info.center));
+            meshlet_info.radius = bounds.radius;
+            memcpy(meshlet_info.cone_apex, bounds.cone_apex, sizeof(meshlet_info.cone_apex));
+            memcpy(meshlet_info.cone_axis, bounds.cone_axis, sizeof(meshlet_info.cone_axis));
+            meshlet_info.cone_cutoff = bounds.cone_cutoff;
+            meshlet_infos.push_back(meshlet_info);
+        }
+    }
+    if (!CheckDataOffset(current_offset, "meshlet data", error)) {
+        for (MeshInfo& mesh_info : storage.mesh_infos) {
+            mesh_info.meshlet_start_index = 0;
+            mesh_info.meshlet_count = 0;
+        }
+        return false;
+    }
+
+    size_t meshlet_begin = storage.data.size();
+    storage.data.resize(current_offset);
+    storage.meshlet_infos = std::move(meshlet_infos);
+    if (!storage.meshlet_infos.empty()) {
+        memset(storage.data.data() + meshlet_begin, 0, storage.meshlet_infos[0].vertex_offset - meshlet_begin);
+    }
+    ParallelFor(meshes.size(), options.num_threads, [&](size_t mesh_index) {
+        WriteMeshlets(storage, storage.mesh_infos[mesh_index], meshes[mesh_index]);
+    });
+    return true;
+}
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "import_options.h"
+#include "scene_data.h"
+
+#include <string>
+
+namespace mesh2py::common {
+
+// Splits every triangle mesh of `storage` into meshlets of at most
+// options.meshlet_max_vertices vertices and options.meshlet_max_triangles triangles with
+// meshoptimizer, each with a bounding sphere and a backface cone. The meshlet vertex and
+// triangle arrays are appended to the data blob and recorded in meshlet_infos. Only meshes
+// GetTrianglePositions accepts get meshlets, e.g. the output of OptimizeMeshes. Meshes are
+// processed in parallel with options.num_threads. Returns false and stores the reason in
+// `error` (when not null) on failure.
+bool BuildMeshlets(SceneStorage& storage, const ImportOptions& options, std::string* error);
+
+}
@@ -0,0 +1,309 @@
+#include "convert.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MESH2PY_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need the instruction set enabled per function, MSVC accepts the intrinsics as is
+#if defined(_MSC_VER) && !defined(__clang__)
+#define MESH2PY_TARGET(isa)
+#else
+#define MESH2PY_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace mesh2py::common {
+
+namespace {
+
+using ConvertPositionsFn = void (*)(float* dst, const double* src, size_t count, float* bounds_min, float* bounds_max);
+
+void ConvertScalar(float* dst, const double* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = static_cast<float>(src[i]);
+    }
+}
+
+// std::min and std::max keep the bound when the value is NaN
+void ConvertPositionsScalar(float* dst, const double* src, size_t count, float* bounds_min, float* bounds_max) {
+    for (size_t i = 0; i < count; i++) {
+        for (int axis = 0; axis < 3; ++axis) {
+            float value = static_cast<float>(src[3 * i + axis]);
+            dst[3 * i + axis] = value;
+            bounds_min[axis] = std::min(bounds_min[axis], value);
+            bounds_max[axis] = std::max(bounds_max[axis], value);
+        }
+    }
+}
+
+void ExpandBoundsScalar(const float* positions, size_t count, float* bounds_min, float* bounds_max) {
+    for (size_t i = 0; i < count; i++) {
+        for (int axis = 0; axis < 3; ++axis) {
+            bounds_min[axis] = std::min(bounds_min[axis], positions[3 * i + axis]);
+            bounds_max[axis] = std::max(bounds_max[axis], positions[3 * i + axis]);
+        }
+    }
+}
+
+// Packed positions put lane i of a run of registers on axis i % 3
+void ReduceLanes(const float* lane_min, const float* lane_max, size_t lane_count, float* bounds_min, float* bounds_max) {
+    for (size_t i = 0; i < lane_count; ++i) {
+        bounds_min[i % 3] = std::min(bounds_min[i % 3], lane_min[i]);
+        bounds_max[i % 3] = std::max(bounds_max[i % 3], lane_max[i]);
+    }
+}
+
+#if MESH2PY_X86
+
+void ConvertSSE2(float* dst, const double* src, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+        _mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+    }
+    ConvertScalar(dst + i, src + i, count - i);
+}
+
+// Four positions fill three registers with the axes x y z x | y z x y | z x y z, the lanes
+// are folded onto the axes once at the end. _mm_min_ps returns its second operand for NaN.
+void ConvertPositionsSSE2(float* dst, const double* src, size_t count, float* bounds_min, float* bounds_max) {
+    __m128 lane_min[3];
+    __m128 lane_max[3];
+    for (int r = 0; r < 3; ++r) {
+        lane_min[r] = _mm_set1_ps(INFINITY);
+        lane_max[r] = _mm_set1_ps(-INFINITY);
+    }
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (int r = 0; r < 3; ++r) {
+            const double* values = src + 3 * i + 4 * r;
+            __m128 value = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(values)), _mm_cvtpd_ps(_mm_loadu_pd(values + 2)));
+            _mm_storeu_ps(dst + 3 * i + 4 * r, value);
+            lane_min[r] = _mm_min_ps(value, lane_min[r]);
+            lane_max[r] = _mm_max_ps(value, lane_max[r]);
+        }
+    }
+    float lanes_min[12];
+    float lanes_max[12];
+    for (int r = 0; r < 3; ++r) {
+        _mm_storeu_ps(lanes_min + 4 * r, lane_min[r]);
+        _mm_storeu_ps(lanes_max + 4 * r, lane_max[r]);
+    }
+    ReduceLanes(lanes_min, lanes_max, 12, bounds_min, bounds_max);
+    ConvertPositionsScalar(dst + 3 * i, src + 3 * i, count - i, bounds_min, bounds_max);
+}
+
+void ExpandBoundsSSE2(const float* positions, size_t count, float* bounds_min, float* bounds_max) {
+    __m128 lane_min[3];
+    __m128 lane_max[3];
+    for (int r = 0; r < 3; ++r) {
+        lane_min[r] = _mm_set1_ps(INFINITY);
+        lane_max[r] = _mm_set1_ps(-INFINITY);
+    }
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (int r = 0; r < 3; ++r) {
+            __m128 value = _mm_loadu_ps(positions + 3 * i + 4 * r);
+            lane_min[r] = _mm_min_ps(value, lane_min[r]);
+            lane_max[r] = _mm_max_ps(value, lane_max[r]);
+        }
+    }
+    float lanes_min[12];
+    float lanes_max[12];
+    for (int r = 0; r < 3; ++r) {
+        _mm_storeu_ps(lanes_min + 4 * r, lane_min[r]);
+        _mm_storeu_ps(lanes_max + 4 * r, lane_max[r]);
+    }
+    ReduceLanes(lanes_min, lanes_max, 12, bounds_min, bounds_max);
+    ExpandBoundsScalar(positions + 3 * i, count - i, bounds_min, bounds_max);
+}
+
+MESH2PY_TARGET("avx2")
+void ConvertAVX2(float* dst, const double* src, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(src + i));
+        __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(src + i + 4));
+        _mm256_storeu_ps(dst + i, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    }
+    ConvertSSE2(dst + i, src + i, count - i);
+}
+
+// Eight positions fill three registers, same lane folding as the SSE2 kernel
+MESH2PY_TARGET("avx2")
+void ConvertPositionsAVX2(float* dst, const double* src, size_t count, float* bounds_min, float* bounds_max) {
+    __m256 lane_min[3];
+    __m256 lane_max[3];
+    for (int r = 0; r < 3; ++r) {
+        lane_min[r] = _mm256_set1_ps(INFINITY);
+        lane_max[r] = _mm256_set1_ps(-INFINITY);
+    }
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        for (int r = 0; r < 3; ++r) {
+            const double* values = src + 3 * i + 8 * r;
+            __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(values));
+            __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(values + 4));
+            __m256 value = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+            _mm256_storeu_ps(dst + 3 * i + 8 * r, value);
+            lane_min[r] = _mm256_min_ps(value, lane_min[r]);
+            lane_max[r] = _mm256_max_ps(value, lane_max[r]);
+        }
+    }
+    float lanes_min[24];
+    float lanes_max[24];
+    for (int r = 0; r < 3; ++r) {
+        _mm256_storeu_ps(lanes_min + 8 * r, lane_min[r]);
+        _mm256_storeu_ps(lanes_max + 8 * r, lane_max[r]);
+    }
+    ReduceLanes(lanes_min, lanes_max, 24, bounds_min, bounds_max);
+    ConvertPositionsSSE2(dst + 3 * i, src + 3 * i, count - i, bounds_min, bounds_max);
+}
+
+MESH2PY_TARGET("avx512f")
+void ConvertAVX512(float* dst, const double* src, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 lo = _mm512_cvtpd_ps(_mm512_loadu_pd(src + i));
+        __m256 hi = _mm512_cvtpd_ps(_mm512_loadu_pd(src + i + 8));
+        _mm256_storeu_ps(dst + i, lo);
+        _mm256_storeu_ps(dst + i + 8, hi);
+    }
+    ConvertSSE2(dst + i, src + i, count - i);
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+bool CpuHasAVX2() {
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+
+bool CpuHasAVX512F() {
+    if (!CpuHasAVX2() || (_xgetbv(0) & 0xe6) != 0xe6) {
+        return false;
+    }
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 16)) != 0;
+}
+#else
+bool CpuHasAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+bool CpuHasAVX512F() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+#endif
+
+#endif
+
+SimdLevel DetectSimdLevel() {
+#if MESH2PY_X86
+    if (CpuHasAVX512F()) {
+        return SimdLevel::AVX512;
+    }
+    if (CpuHasAVX2()) {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+}
+
+SimdLevel GetSimdLevel() {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+ConvertDoubleToFloatFn GetConvertDoubleToFloatKernel(SimdLevel level) {
+    if ((uint32_t)level > (uint32_t)GetSimdLevel()) {
+        return nullptr;
+    }
+    switch (level) {
+        case SimdLevel::Scalar: return ConvertScalar;
+#if MESH2PY_X86
+        case SimdLevel::SSE2: return ConvertSSE2;
+        case SimdLevel::AVX2: return ConvertAVX2;
+        case SimdLevel::AVX512: return ConvertAVX512;
+#else
+        default: break;
+#endif
+    }
+    return nullptr;
+}
+
+void ConvertDoubleToFloat(float* dst, const double* src, size_t count) {
+    static const ConvertDoubleToFloatFn kernel = GetConvertDoubleToFloatKernel(GetSimdLevel());
+    kernel(dst, src, count);
+}
+
+void ConvertPositionsToFloat(float* dst, const double* src, size_t count, float* bounds_min, float* bounds_max) {
+#if MESH2PY_X86
+    // The AVX-512 conversion gains nothing over AVX2 once the min and max are added
+    static const ConvertPositionsFn kernel =
+        GetSimdLevel() >= SimdLevel::AVX2 ? ConvertPositionsAVX2 : ConvertPositionsSSE2;
+    kernel(dst, src, count, bounds_min, bounds_max);
+#else
+    ConvertPositionsScalar(dst, src, count, bounds_min, bounds_max);
+#endif
+}
+
+void ExpandBounds(const float* positions, size_t count, float* bounds_min, float* bounds_max) {
+#if MESH2PY_X86
+    ExpandBoundsSSE2(positions, count, bounds_min, bounds_max);
+#else
+    ExpandBoundsScalar(positions, count, bounds_min, bounds_max);
+#endif
+}
+
+void InitBounds(float* bounds_min, float* bounds_max) {
+    for (int axis = 0; axis < 3; ++axis) {
+        bounds_min[axis] = INFINITY;
+        bounds_max[axis] = -INFINITY;
+    }
+}
+
+void ResetEmptyBounds(float* bounds_min, float* bounds_max) {
+    for (int axis = 0; axis < 3; ++axis) {
+        if (bounds_min[axis] > bounds_max[axis]) {
+            bounds_min[axis] = 0.0f;
+            bounds_max[axis] = 0.0f;
+        }
+    }
+}
+
+}
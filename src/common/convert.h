@@ -0,0 +1,41 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+namespace mesh2py::common {
+
+enum class SimdLevel : uint32_t {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+using ConvertDoubleToFloatFn = void (*)(float* dst, const double* src, size_t count);
+
+// Highest instruction set supported by the running CPU and OS, detected once.
+SimdLevel GetSimdLevel();
+const char* GetSimdLevelName(SimdLevel level);
+
+// Returns the conversion kernel for `level`, or nullptr if it is not compiled in or
+// not supported by this CPU. Mostly useful for benchmarks and tests.
+ConvertDoubleToFloatFn GetConvertDoubleToFloatKernel(SimdLevel level);
+
+// Converts `count` packed doubles to floats using the widest kernel available.
+// Packed vec2/vec3/vec4 arrays convert as one flat stream of components.
+void ConvertDoubleToFloat(float* dst, const double* src, size_t count);
+
+// Converts `count` packed double xyz positions to floats and grows bounds_min and bounds_max
+// over them in the same pass, so the positions are read once. NaN components are ignored.
+void ConvertPositionsToFloat(float* dst, const double* src, size_t count, float* bounds_min, float* bounds_max);
+
+// Grows bounds_min and bounds_max over `count` packed float xyz positions
+void ExpandBounds(const float* positions, size_t count, float* bounds_min, float* bounds_max);
+
+// Sets bounds that any position grows, ResetEmptyBounds turns them back into zeros when no
+// position was added
+void InitBounds(float* bounds_min, float* bounds_max);
+void ResetEmptyBounds(float* bounds_min, float* bounds_max);
+
+}
@@ -0,0 +1,166 @@
+#include "data_buffer.h"
+
+#include "scene_data.h"
+
+#include <cstring>
+#include <new>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace mesh2py::common {
+
+namespace {
+
+constexpr size_t kBufferAlignment = 64;
+
+class DefaultStorageAllocator : public StorageAllocator {
+public:
+    void* Allocate(size_t size) override {
+        return ::operator new(size, std::align_val_t(kBufferAlignment), std::nothrow);
+    }
+
+    void Deallocate(void* ptr, size_t) override {
+        ::operator delete(ptr, std::align_val_t(kBufferAlignment));
+    }
+};
+
+#if defined(__linux__)
+class HugePageStorageAllocator : public StorageAllocator {
+public:
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+    void* Allocate(size_t size) override {
+        size_t mapping_size = align_up(size, kHugePageSize);
+        void* ptr = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return nullptr;
+        }
+        // Only a hint, the kernel may not back the mapping with huge pages
+        madvise(ptr, mapping_size, MADV_HUGEPAGE);
+        return ptr;
+    }
+
+    void Deallocate(void* ptr, size_t size) override {
+        munmap(ptr, align_up(size, kHugePageSize));
+    }
+};
+#endif
+
+}
+
+std::shared_ptr<StorageAllocator> GetDefaultStorageAllocator() {
+    static const std::shared_ptr<StorageAllocator> allocator = std::make_shared<DefaultStorageAllocator>();
+    return allocator;
+}
+
+std::shared_ptr<StorageAllocator> GetHugePageStorageAllocator() {
+#if defined(__linux__)
+    static const std::shared_ptr<StorageAllocator> allocator = std::make_shared<HugePageStorageAllocator>();
+    return allocator;
+#else
+    return GetDefaultStorageAllocator();
+#endif
+}
+
+ArenaStorageAllocator::ArenaStorageAllocator(void* memory, size_t capacity)
+    : m_memory((uint8_t*)memory), m_capacity(capacity) {
+}
+
+void* ArenaStorageAllocator::Allocate(size_t size) {
+    // Concurrent imports share the arena, claim the range with a compare exchange
+    size_t used = m_used.load(std::memory_order_relaxed);
+    size_t begin = 0;
+    do {
+        begin = align_up((size_t)m_memory + used, kBufferAlignment) - (size_t)m_memory;
+        if (begin > m_capacity || size > m_capacity - begin) {
+            return nullptr;
+        }
+    } while (!m_used.compare_exchange_weak(used, begin + size, std::memory_order_relaxed));
+    return m_memory + begin;
+}
+
+void ArenaStorageAllocator::Deallocate(void*, size_t) {
+}
+
+DataBuffer::DataBuffer(std::shared_ptr<StorageAllocator> allocator)
+    : m_allocator(std::move(allocator)) {
+}
+
+DataBuffer::DataBuffer(const DataBuffer& other)
+    : m_allocator(other.m_allocator) {
+    resize(other.m_size);
+    if (m_size) {
+        memcpy(m_data, other.m_data, m_size);
+    }
+}
+
+DataBuffer::DataBuffer(DataBuffer&& other) noexcept
+    : m_allocator(std::move(other.m_allocator)),
+      m_data(std::exchange(other.m_data, nullptr)),
+      m_size(std::exchange(other.m_size, 0)) {
+}
+
+DataBuffer& DataBuffer::operator=(const DataBuffer& other) {
+    if (this != &other) {
+        DataBuffer copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+DataBuffer& DataBuffer::operator=(DataBuffer&& other) noexcept {
+    if (this != &other) {
+        clear();
+        m_allocator = std::move(other.m_allocator);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+DataBuffer::~DataBuffer() {
+    clear();
+}
+
+void DataBuffer::resize(size_t size) {
+    if (size == m_size) {
+        return;
+    }
+    if (size == 0) {
+        clear();
+        return;
+    }
+    if (!m_allocator) {
+        m_allocator = GetDefaultStorageAllocator();
+    }
+    uint8_t* data = (uint8_t*)m_allocator->Allocate(size);
+    if (!data) {
+        throw std::bad_alloc();
+    }
+    if (m_data) {
+        memcpy(data, m_data, m_size < size ? m_size : size);
+        m_allocator->Deallocate(m_data, m_size);
+    }
+    m_data = data;
+    m_size = size;
+}
+
+void DataBuffer::adopt(std::shared_ptr<StorageAllocator> allocator, uint8_t* data, size_t size) {
+    clear();
+    m_allocator = std::move(allocator);
+    m_data = data;
+    m_size = size;
+}
+
+void DataBuffer::clear() {
+    if (m_data) {
+        m_allocator->Deallocate(m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+
+namespace mesh2py::common {
+
+// Provides the memory behind a SceneStorage data blob. Memory is handed out uninitialized,
+// every byte of the blob is written by the importer. Implementations must be thread safe:
+// ImportMany and the parallel stages allocate from one allocator on several threads.
+class StorageAllocator {
+public:
+    virtual ~StorageAllocator() = default;
+    // Returns at least `size` bytes aligned to 64 bytes, or nullptr if out of memory
+    virtual void* Allocate(size_t size) = 0;
+    virtual void Deallocate(void* ptr, size_t size) = 0;
+};
+
+// Aligned heap allocator used when none is given
+std::shared_ptr<StorageAllocator> GetDefaultStorageAllocator();
+
+// Anonymous mappings advised for transparent huge pages. Falls back to the default
+// allocator on platforms without THP support.
+std::shared_ptr<StorageAllocator> GetHugePageStorageAllocator();
+
+// Bump allocator over caller owned memory, e.g. a pinned or shared memory arena.
+// Deallocate is a no-op, the arena is reclaimed as a whole by its owner. Allocate claims its
+// range atomically, so concurrent imports never receive overlapping blobs.
+class ArenaStorageAllocator : public StorageAllocator {
+public:
+    ArenaStorageAllocator(void* memory, size_t capacity);
+    void* Allocate(size_t size) override;
+    void Deallocate(void* ptr, size_t size) override;
+
+    size_t used() const { return m_used.load(std::memory_order_relaxed); }
+    size_t capacity() const { return m_capacity; }
+
+private:
+    uint8_t* m_memory;
+    size_t m_capacity;
+    std::atomic<size_t> m_used{ 0 };
+};
+
+// Byte blob with a std::vector like interface that never zero fills
+class DataBuffer {
+public:
+    DataBuffer() = default;
+    explicit DataBuffer(std::shared_ptr<StorageAllocator> allocator);
+    DataBuffer(const DataBuffer& other);
+    DataBuffer(DataBuffer&& other) noexcept;
+    DataBuffer& operator=(const DataBuffer& other);
+    DataBuffer& operator=(DataBuffer&& other) noexcept;
+    ~DataBuffer();
+
+    uint8_t* data() { return m_data; }
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    // Changes the size keeping the existing bytes, bytes past the old size are uninitialized.
+    // Throws std::bad_alloc if the allocator runs out of memory.
+    void resize(size_t size);
+    void clear();
+
+    // Takes ownership of `size` bytes at `data` obtained from `allocator`, releasing the current bytes
+    void adopt(std::shared_ptr<StorageAllocator> allocator, uint8_t* data, size_t size);
+
+    const std::shared_ptr<StorageAllocator>& allocator() const { return m_allocator; }
+
+private:
+    std::shared_ptr<StorageAllocator> m_allocator;
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+}
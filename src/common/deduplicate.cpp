@@ -0,0 +1,354 @@
+#include "deduplicate.h"
+
+#include "blendshapes.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace mesh2py::common {
+
+namespace {
+
+// Bytes of the data blob holding one payload
+struct Region {
+    uint64_t offset;
+    uint64_t size;
+
+    bool operator<(const Region& other) const {
+        return offset != other.offset ? offset < other.offset : size < other.size;
+    }
+    bool operator==(const Region& other) const { return offset == other.offset && size == other.size; }
+};
+
+uint64_t MixWord(uint64_t hash, uint64_t word) {
+    hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+    return hash ^ (hash >> 32);
+}
+
+// Only buckets the payloads, equal hashes are confirmed with a byte compare. Four lanes of
+// 8 byte words keep independent multiplies in flight.
+uint64_t HashBytes(const uint8_t* data, uint64_t size) {
+    uint64_t lanes[4] = { 0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0x27d4eb2f165667c5ull };
+    uint64_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t word;
+            memcpy(&word, data + i + 8 * lane, sizeof(word));
+            lanes[lane] = MixWord(lanes[lane], word);
+        }
+    }
+    uint64_t hash = size;
+    for (uint64_t lane : lanes) {
+        hash = MixWord(hash, lane);
+    }
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = MixWord(hash, word);
+    }
+    if (i < size) {
+        uint64_t tail = 0;
+        memcpy(&tail, data + i, size - i);
+        hash = MixWord(hash, tail);
+    }
+    return hash;
+}
+
+// The vertex and the triangle arrays of the meshlets of a mesh, each contiguous
+Region GetMeshletVertexBlock(const SceneStorage& storage, const MeshInfo& mesh_info) {
+    const MeshletInfo& first = storage.meshlet_infos[mesh_info.meshlet_start_index];
+    const MeshletInfo& last = storage.meshlet_infos[mesh_info.meshlet_start_index + mesh_info.meshlet_count - 1];
+    return { first.vertex_offset,
+        last.vertex_offset + (uint64_t)last.vertex_count * GetIndexSize(last.vertex_encoding) - first.vertex_offset };
+}
+
+Region GetMeshletTriangleBlock(const SceneStorage& storage, const MeshInfo& mesh_info) {
+    const MeshletInfo& first = storage.meshlet_infos[mesh_info.meshlet_start_index];
+    const MeshletInfo& last = storage.meshlet_infos[mesh_info.meshlet_start_index + mesh_info.meshlet_count - 1];
+    return { first.triangle_offset, last.triangle_offset + (uint64_t)last.triangle_count * 3 - first.triangle_offset };
+}
+
+Region GetBlendshapeBlock(const SceneStorage& storage, const MeshInfo& mesh_info) {
+    return { storage.blendshape_infos[mesh_info.blendshape_start_index].vertex_offset,
+        GetBlendshapeBlockSize(storage, mesh_info) };
+}
+
+// Every payload of the storage, sorted by offset. A payload shared by several records, e.g.
+// an index array used by several attributes, appears once.
+std::vector<Region> CollectRegions(const SceneStorage& storage) {
+    std::vector<Region> regions;
+    for (const MeshInfo& mesh_info : storage.mesh_infos) {
+        regions.push_back({ mesh_info.face_offset, (uint64_t)mesh_info.face_count * sizeof(Face) });
+        for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+            const AttributeInfo& attrib_info = storage.attrib_infos[mesh_info.attrib_info_start_index + a];
+            regions.push_back({ attrib_info.index_offset, attrib_info.index_count * GetIndexSize(attrib_info) });
+            regions.push_back({ attrib_info.value_offset, attrib_info.value_count * GetValueSize(attrib_info) });
+        }
+        for (uint32_t l = 0; l < mesh_info.lod_info_count; ++l) {
+            const LodInfo& lod_info = storage.lod_infos[mesh_info.lod_info_start_index + l];
+            regions.push_back({ lod_info.index_offset, (uint64_t)lod_info.index_count * GetIndexSize(lod_info.index_encoding) });
+        }
+        if (mesh_info.meshlet_count > 0) {
+            regions.push_back(GetMeshletVertexBlock(storage, mesh_info));
+            regions.push_back(GetMeshletTriangleBlock(storage, mesh_info));
+        }
+        if (mesh_info.blendshape_count > 0) {
+            regions.push_back(GetBlendshapeBlock(storage, mesh_info));
+        }
+    }
+    std::sort(regions.begin(), regions.end());
+    regions.erase(std::unique(regions.begin(), regions.end()), regions.end());
+    return regions;
+}
+
+template <class T>
+void AppendKey(std::string& key, const T& value) {
+    key.append((const char*)&value, sizeof(T));
+}
+
+// Every field of a mesh and its records except the start indices, appended one by one so the
+// struct padding stays out. Equal keys of remapped meshes mean equal meshes.
+std::string GetMeshKey(const SceneStorage& storage, const MeshInfo& mesh_info) {
+    std::string key;
+    AppendKey(key, mesh_info.face_offset);
+    AppendKey(key, mesh_info.face_count);
+    AppendKey(key, mesh_info.attribute_info_count);
+    AppendKey(key, mesh_info.lod_info_count);
+    AppendKey(key, mesh_info.meshlet_count);
+    AppendKey(key, mesh_info.joint_info_count);
+    AppendKey(key, mesh_info.blendshape_count);
+    AppendKey(key, mesh_info.bounds_min);
+    AppendKey(key, mesh_info.bounds_max);
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        const AttributeInfo& attrib_info = storage.attrib_infos[mesh_info.attrib_info_start_index + a];
+        AppendKey(key, attrib_info.index_offset);
+        AppendKey(key, attrib_info.value_offset);
+        AppendKey(key, attrib_info.attrib_type);
+        AppendKey(key, attrib_info.index_count);
+        AppendKey(key, attrib_info.value_count);
+        AppendKey(key, attrib_info.num_value_per_index);
+        AppendKey(key, attrib_info.value_encoding);
+        AppendKey(key, attrib_info.index_encoding);
+    }
+    for (uint32_t l = 0; l < mesh_info.lod_info_count; ++l) {
+        const LodInfo& lod_info = storage.lod_infos[mesh_info.lod_info_start_index + l];
+        AppendKey(key, lod_info.index_offset);
+        AppendKey(key, lod_info.index_count);
+        AppendKey(key, lod_info.error);
+        AppendKey(key, lod_info.index_encoding);
+    }
+    for (uint32_t m = 0; m < mesh_info.meshlet_count; ++m) {
+        const MeshletInfo& meshlet_info = storage.meshlet_infos[mesh_info.meshlet_start_index + m];
+        AppendKey(key, meshlet_info.vertex_offset);
+        AppendKey(key, meshlet_info.triangle_offset);
+        AppendKey(key, meshlet_info.vertex_count);
+        AppendKey(key, meshlet_info.triangle_count);
+        AppendKey(key, meshlet_info.center);
+        AppendKey(key, meshlet_info.radius);
+        AppendKey(key, meshlet_info.cone_apex);
+        AppendKey(key, meshlet_info.cone_axis);
+        AppendKey(key, meshlet_info.cone_cutoff);
+        AppendKey(key, meshlet_info.vertex_encoding);
+    }
+    for (uint32_t j = 0; j < mesh_info.joint_info_count; ++j) {
+        const JointInfo& joint_info = storage.joint_infos[mesh_info.joint_info_start_index + j];
+        AppendKey(key, joint_info.node_index);
+        AppendKey(key, joint_info.inverse_bind_matrix);
+    }
+    for (uint32_t s = 0; s < mesh_info.blendshape_count; ++s) {
+        const BlendshapeInfo& shape = storage.blendshape_infos[mesh_info.blendshape_start_index + s];
+        AppendKey(key, shape.vertex_offset);
+        AppendKey(key, shape.position_offset);
+        AppendKey(key, shape.normal_offset);
+        AppendKey(key, shape.vertex_count);
+        AppendKey(key, shape.has_normals);
+        AppendKey(key, shape.default_weight);
+    }
+    return key;
+}
+
+template <class T>
+void AppendRange(const std::vector<T>& src, uint32_t start, uint32_t count, std::vector<T>& dst, uint32_t& new_start) {
+    new_start = (uint32_t)dst.size();
+    dst.insert(dst.end(), src.begin() + start, src.begin() + start + count);
+}
+
+}
+
+bool DeduplicateScene(const SceneStorage& storage, const ImportOptions& options,
+    SceneStorage& deduplicated, std::string* error) {
+    std::vector<Region> regions = CollectRegions(storage);
+    std::vector<uint64_t> hashes(regions.size());
+    ParallelFor(regions.size(), options.num_threads, [&](size_t r) {
+        hashes[r] = HashBytes(storage.data.data() + regions[r].offset, regions[r].size);
+    });
+
+    // Candidates of equal hash and size are adjacent, in offset order within a run
+    std::vector<uint32_t> order(regions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (hashes[a] != hashes[b]) {
+            return hashes[a] < hashes[b];
+        }
+        if (regions[a].size != regions[b].size) {
+            return regions[a].size < regions[b].size;
+        }
+        return a < b;
+    });
+    std::vector<size_t> run_begins;
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i == 0 || hashes[order[i]] != hashes[order[i - 1]] || regions[order[i]].size != regions[order[i - 1]].size) {
+            run_begins.push_back(i);
+        }
+    }
+    run_begins.push_back(order.size());
+
+    // Every region keeps the lowest offset copy of its bytes
+    std::vector<uint32_t> representatives(regions.size());
+    ParallelFor(run_begins.size() - 1, options.num_threads, [&](size_t run) {
+        std::vector<uint32_t> kept;
+        for (size_t i = run_begins[run]; i < run_begins[run + 1]; ++i) {
+            uint32_t r = order[i];
+            representatives[r] = r;
+            for (uint32_t candidate : kept) {
+                if (memcmp(storage.data.data() + regions[candidate].offset, storage.data.data() + regions[r].offset,
+                        regions[r].size) == 0) {
+                    representatives[r] = candidate;
+                    break;
+                }
+            }
+            if (representatives[r] == r) {
+                kept.push_back(r);
+            }
+        }
+    });
+
+    std::vector<uint64_t> new_offsets(regions.size());
+    uint64_t current_offset = 0;
+    for (uint32_t r = 0; r < regions.size(); ++r) {
+        if (representatives[r] == r) {
+            new_offsets[r] = align_up(current_offset, 16);
+            current_offset = new_offsets[r] + regions[r].size;
+        }
+    }
+    for (uint32_t r = 0; r < regions.size(); ++r) {
+        new_offsets[r] = new_offsets[representatives[r]];
+    }
+    if (!CheckDataOffset(current_offset, "deduplicated data", error)) {
+        return false;
+    }
+
+    auto remap_offset = [&](Region region) {
+        auto it = std::lower_bound(regions.begin(), regions.end(), region);
+        return new_offsets[it - regions.begin()];
+    };
+
+    // Records with the same indices as `storage`, pointing at the kept copies
+    SceneStorage remapped;
+    remapped.mesh_infos = storage.mesh_infos;
+    remapped.attrib_infos = storage.attrib_infos;
+    remapped.lod_infos = storage.lod_infos;
+    remapped.meshlet_infos = storage.meshlet_infos;
+    remapped.joint_infos = storage.joint_infos;
+    remapped.blendshape_infos = storage.blendshape_infos;
+    ParallelFor(storage.mesh_infos.size(), options.num_threads, [&](size_t mesh_index) {
+        const MeshInfo& mesh_info = storage.mesh_infos[mesh_index];
+        remapped.mesh_infos[mesh_index].face_offset =
+            (DataOffset)remap_offset({ mesh_info.face_offset, (uint64_t)mesh_info.face_count * sizeof(Face) });
+        for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+            const AttributeInfo& attrib_info = storage.attrib_infos[mesh_info.attrib_info_start_index + a];
+            AttributeInfo& new_info = remapped.attrib_infos[mesh_info.attrib_info_start_index + a];
+            new_info.index_offset =
+                (DataOffset)remap_offset({ attrib_info.index_offset, attrib_info.index_count * GetIndexSize(attrib_info) });
+            new_info.value_offset =
+                (DataOffset)remap_offset({ attrib_info.value_offset, attrib_info.value_count * GetValueSize(attrib_info) });
+        }
+        for (uint32_t l = 0; l < mesh_info.lod_info_count; ++l) {
+            const LodInfo& lod_info = storage.lod_infos[mesh_info.lod_info_start_index + l];
+            remapped.lod_infos[mesh_info.lod_info_start_index + l].index_offset =
+                (DataOffset)remap_offset({ lod_info.index_offset, (uint64_t)lod_info.index_count * GetIndexSize(lod_info.index_encoding) });
+        }
+        if (mesh_info.meshlet_count > 0) {
+            Region vertex_block = GetMeshletVertexBlock(storage, mesh_info);
+            Region triangle_block = GetMeshletTriangleBlock(storage, mesh_info);
+            uint64_t vertex_offset = remap_offset(vertex_block);
+            uint64_t triangle_offset = remap_offset(triangle_block);
+            for (uint32_t m = 0; m < mesh_info.meshlet_count; ++m) {
+                MeshletInfo& meshlet_info = remapped.meshlet_infos[mesh_info.meshlet_start_index + m];
+                meshlet_info.vertex_offset = (DataOffset)(vertex_offset + (meshlet_info.vertex_offset - vertex_block.offset));
+                meshlet_info.triangle_offset =
+                    (DataOffset)(triangle_offset + (meshlet_info.triangle_offset - triangle_block.offset));
+            }
+        }
+        if (mesh_info.blendshape_count > 0) {
+            Region block = GetBlendshapeBlock(storage, mesh_info);
+            uint64_t block_offset = remap_offset(block);
+            for (uint32_t s = 0; s < mesh_info.blendshape_count; ++s) {
+                BlendshapeInfo& shape = remapped.blendshape_infos[mesh_info.blendshape_start_index + s];
+                shape.vertex_offset = (DataOffset)(block_offset + (shape.vertex_offset - block.offset));
+                shape.position_offset = (DataOffset)(block_offset + (shape.position_offset - block.offset));
+                if (shape.has_normals) {
+                    shape.normal_offset = (DataOffset)(block_offset + (shape.normal_offset - block.offset));
+                }
+            }
+        }
+    });
+
+    // Meshes whose records now match collapse into the first of them
+    std::vector<std::string> keys(storage.mesh_infos.size());
+    ParallelFor(storage.mesh_infos.size(), options.num_threads, [&](size_t mesh_index) {
+        keys[mesh_index] = GetMeshKey(remapped, remapped.mesh_infos[mesh_index]);
+    });
+    SceneStorage result;
+    std::unordered_map<std::string, uint32_t> mesh_by_key;
+    std::vector<uint32_t> mesh_remap(storage.mesh_infos.size());
+    for (uint32_t mesh_index = 0; mesh_index < storage.mesh_infos.size(); ++mesh_index) {
+        auto [it, inserted] = mesh_by_key.emplace(std::move(keys[mesh_index]), (uint32_t)result.mesh_infos.size());
+        mesh_remap[mesh_index] = it->second;
+        if (!inserted) {
+            continue;
+        }
+        MeshInfo mesh_info = remapped.mesh_infos[mesh_index];
+        AppendRange(remapped.attrib_infos, mesh_info.attrib_info_start_index, mesh_info.attribute_info_count,
+            result.attrib_infos, mesh_info.attrib_info_start_index);
+        AppendRange(remapped.lod_infos, mesh_info.lod_info_start_index, mesh_info.lod_info_count, result.lod_infos,
+            mesh_info.lod_info_start_index);
+        AppendRange(remapped.meshlet_infos, mesh_info.meshlet_start_index, mesh_info.meshlet_count,
+            result.meshlet_infos, mesh_info.meshlet_start_index);
+        AppendRange(remapped.joint_infos, mesh_info.joint_info_start_index, mesh_info.joint_info_count,
+            result.joint_infos, mesh_info.joint_info_start_index);
+        AppendRange(remapped.blendshape_infos, mesh_info.blendshape_start_index, mesh_info.blendshape_count,
+            result.blendshape_infos, mesh_info.blendshape_start_index);
+        result.mesh_infos.push_back(mesh_info);
+    }
+    result.nodes = storage.nodes;
+    for (Node& node : result.nodes) {
+        if (node.mesh_index < mesh_remap.size()) {
+            node.mesh_index = mesh_remap[node.mesh_index];
+        }
+    }
+
+    std::vector<uint32_t> kept;
+    for (uint32_t r = 0; r < regions.size(); ++r) {
+        if (representatives[r] == r) {
+            kept.push_back(r);
+        }
+    }
+    result.data = DataBuffer(options.allocator);
+    result.data.resize(current_offset);
+    ParallelFor(kept.size(), options.num_threads, [&](size_t k) {
+        const Region& region = regions[kept[k]];
+        if (region.size > 0) {
+            memcpy(result.data.data() + new_offsets[kept[k]], storage.data.data() + region.offset, region.size);
+        }
+        ZeroPadding(result, new_offsets[kept[k]] + region.size);
+    });
+
+    deduplicated = std::move(result);
+    return true;
+}
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "import_options.h"
+#include "scene_data.h"
+
+#include <string>
+
+namespace mesh2py::common {
+
+// Copies `storage` into `deduplicated` keeping one copy of every distinct payload: faces,
+// index and value arrays, LOD index buffers, meshlet arrays and blend shape arrays are hashed
+// in parallel with options.num_threads, equal hashes are confirmed with a byte compare and
+// the records of every copy point at the one kept. Meshes whose records then match, e.g. the
+// same prop imported under several FBX meshes, collapse into one MeshInfo and the nodes are
+// pointed at it. Works on any encoding, RunPostImport runs it after every other stage. The
+// data blob comes from options.allocator. Returns false and stores the reason in `error`
+// (when not null) on failure.
+bool DeduplicateScene(const SceneStorage& storage, const ImportOptions& options,
+    SceneStorage& deduplicated, std::string* error);
+
+}
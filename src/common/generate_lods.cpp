@@ -0,0 +1,117 @@
+#include "generate_lods.h"
+
+#include "optimize_meshes.h"
+#include "quantize_attributes.h"
+#include "thread_pool.h"
+
+#include <meshoptimizer.h>
+
+#include <cstring>
+
+namespace mesh2py::common {
+
+namespace {
+
+struct MeshLods {
+    std::vector<std::vector<uint32_t>> indices;
+    std::vector<float> errors;
+};
+
+void SimplifyMesh(const SceneStorage& storage, const MeshInfo& mesh_info, const std::vector<LodLevel>& levels,
+    MeshLods& lods) {
+    const AttributeInfo* positions = GetTrianglePositions(storage, mesh_info);
+    if (!positions) {
+        return;
+    }
+    const uint32_t* indices = (const uint32_t*)(storage.data.data() + positions->index_offset);
+    const float* vertices = (const float*)(storage.data.data() + positions->value_offset);
+    size_t vertex_count = positions->value_count;
+
+    std::vector<uint32_t> current(indices, indices + positions->index_count);
+    float error = 0.0f;
+    for (const LodLevel& level : levels) {
+        size_t target_index_count = size_t(positions->index_count * level.index_ratio) / 3 * 3;
+        std::vector<uint32_t> lod(current.size());
+        float level_error = 0.0f;
+        size_t index_count = meshopt_simplify(lod.data(), current.data(), current.size(), vertices, vertex_count,
+            3 * sizeof(float), target_index_count, level.target_error, 0, &level_error);
+        if (index_count == 0 || index_count >= current.size()) {
+            break;
+        }
+        lod.resize(index_count);
+        meshopt_optimizeVertexCache(lod.data(), lod.data(), index_count, vertex_count);
+
+        // Each level is simplified from the previous one, so the errors add up
+        error += level_error;
+        current = lod;
+        lods.indices.push_back(std::move(lod));
+        lods.errors.push_back(error);
+    }
+}
+
+}
+
+bool GenerateLods(SceneStorage& storage, const std::vector<LodLevel>& levels, uint32_t num_threads,
+    std::string* error) {
+    if (!storage.lod_infos.empty()) {
+        if (error) {
+            *error = "storage already has LODs";
+        }
+        return false;
+    }
+    if (IsQuantized(storage)) {
+        if (error) {
+            *error = "quantized storage, generate LODs before QuantizeAttributes";
+        }
+        return false;
+    }
+
+    std::vector<MeshLods> meshes(storage.mesh_infos.size());
+    ParallelFor(meshes.size(), num_threads, [&](size_t mesh_index) {
+        SimplifyMesh(storage, storage.mesh_infos[mesh_index], levels, meshes[mesh_index]);
+    });
+
+    // The LOD index buffers go behind the existing data
+    uint64_t current_offset = storage.data.size();
+    std::vector<LodInfo> lod_infos;
+    for (uint32_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
+        MeshInfo& mesh_info = storage.mesh_infos[mesh_index];
+        mesh_info.lod_info_start_index = (uint32_t)lod_infos.size();
+        mesh_info.lod_info_count = (uint32_t)meshes[mesh_index].indices.size();
+        for (size_t level = 0; level < meshes[mesh_index].indices.size(); ++level) {
+            current_offset = align_up(current_offset, 16);
+            LodInfo lod_info = {};
+            lod_info.index_offset = (DataOffset)current_offset;
+            lod_info.index_count = (uint32_t)meshes[mesh_index].indices[level].size();
+            lod_info.error = meshes[mesh_index].errors[level];
+            lod_infos.push_back(lod_info);
+            current_offset += (uint64_t)lod_info.index_count * sizeof(uint32_t);
+        }
+    }
+    if (!CheckDataOffset(current_offset, "LOD data", error)) {
+        for (MeshInfo& mesh_info : storage.mesh_infos) {
+            mesh_info.lod_info_start_index = 0;
+            mesh_info.lod_info_count = 0;
+        }
+        return false;
+    }
+
+    size_t lod_begin = storage.data.size();
+    storage.data.resize(current_offset);
+    storage.lod_infos = std::move(lod_infos);
+    if (!storage.lod_infos.empty()) {
+        memset(storage.data.data() + lod_begin, 0, storage.lod_infos[0].index_offset - lod_begin);
+    }
+    ParallelFor(meshes.size(), num_threads, [&](size_t mesh_index) {
+        const MeshInfo& mesh_info = storage.mesh_infos[mesh_index];
+        for (uint32_t level = 0; level < mesh_info.lod_info_count; ++level) {
+            const LodInfo& lod_info = storage.lod_infos[mesh_info.lod_info_start_index + level];
+            memcpy(storage.data.data() + lod_info.index_offset, meshes[mesh_index].indices[level].data(),
+                sizeof(uint32_t) * lod_info.index_count);
+            ZeroPadding(storage, lod_info.index_offset + sizeof(uint32_t) * lod_info.index_count);
+        }
+    });
+    return true;
+}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "import_options.h"
+#include "scene_data.h"
+
+#include <string>
+
+namespace mesh2py::common {
+
+// Appends simplified index buffers for `levels` to the data blob of `storage` and records
+// them in lod_infos. Every level is simplified from the previous one with meshoptimizer and
+// reordered for the vertex cache, a mesh stops at the first level that does not get smaller.
+// Only meshes whose attributes share one index array, whose faces are all triangles and
+// which have float3 positions get LODs, e.g. the output of OptimizeMeshes. Meshes are
+// simplified in parallel with `num_threads`. Returns false and stores the reason in `error`
+// (when not null) on failure.
+bool GenerateLods(SceneStorage& storage, const std::vector<LodLevel>& levels, uint32_t num_threads,
+    std::string* error);
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "data_buffer.h"
+#include "scene_data.h"
+
+#include <inttypes.h>
+#include <memory>
+#include <vector>
+
+namespace mesh2py::common {
+
+struct ImportStats;
+
+// Target of one generated level of detail
+struct LodLevel {
+    // Wanted index count as a fraction of the full detail mesh
+    float index_ratio;
+    // Largest allowed simplification error relative to the mesh extents
+    float target_error;
+};
+
+struct ImportOptions {
+    // Worker threads used for scene layout and mesh conversion.
+    // 1 keeps the whole import on the calling thread, 0 uses every hardware thread.
+    uint32_t num_threads = 1;
+
+    // Provides the memory of SceneStorage::data, nullptr selects GetDefaultStorageAllocator()
+    std::shared_ptr<StorageAllocator> allocator;
+
+    // Joint influences kept per vertex of a skinned mesh, the largest weights renormalized to
+    // sum to 1. At most 255, 0 skips the skins.
+    uint32_t max_joint_influences = 4;
+
+    // Run OptimizeMeshes on the imported scene: unified, triangulated meshes with vertex cache,
+    // overdraw and vertex fetch optimization. Honored by ImportFbx and ImportGltf.
+    bool optimize_meshes = false;
+
+    // Levels GenerateLods adds to every optimized triangle mesh, empty for none. Implies
+    // optimize_meshes.
+    std::vector<LodLevel> lod_levels;
+
+    // Run BuildMeshlets on every optimized triangle mesh. Implies optimize_meshes.
+    bool build_meshlets = false;
+    // At most 256 vertices and 512 triangles, the triangle limit a multiple of 4
+    uint32_t meshlet_max_vertices = 64;
+    uint32_t meshlet_max_triangles = 124;
+    // 0 favors compact meshlets, values towards 1 tighter backface cones
+    float meshlet_cone_weight = 0.25f;
+
+    // Run QuantizeAttributes after the meshlet stage: half float or snorm16 positions,
+    // octahedral normals, unorm8 colors and uint16 indices where they fit.
+    bool quantize_attributes = false;
+    // Float16 or Snorm16, both normalized to the mesh bounds
+    ValueEncoding position_encoding = ValueEncoding::Snorm16;
+
+    // Run DeduplicateScene after every other stage: identical payloads are stored once and
+    // identical meshes share one MeshInfo.
+    bool deduplicate = false;
+
+    // Receives per phase timings, data sizes, counts and worker utilization of the import when
+    // not null, see import_stats.h. nullptr leaves the import uninstrumented.
+    ImportStats* stats = nullptr;
+};
+
+}
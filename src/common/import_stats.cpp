@@ -0,0 +1,288 @@
+#include "import_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace mesh2py::common {
+
+namespace {
+
+// Target of the instrumentation on this thread
+struct ActiveStats {
+    ImportStats* stats = nullptr;
+    // CPU time of the ParallelFor workers started from this thread, the running PhaseTimer
+    // adds what accumulated during its phase
+    double worker_cpu_seconds = 0.0;
+    ImportPhase phase = ImportPhase::Count;
+};
+
+thread_local ActiveStats t_active;
+
+double NowUs() {
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+double GetThreadCpuSeconds() {
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    auto to_seconds = [](const FILETIME& time) {
+        return (double)(((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) * 1e-7;
+    };
+    return to_seconds(kernel) + to_seconds(user);
+#else
+    timespec time = {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+#endif
+}
+
+uint32_t GetTraceThreadId() {
+    static std::atomic<uint32_t> next_id{ 1 };
+    thread_local uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+// Worker events outside of a PhaseTimer are named after the whole import
+const char* GetActivePhaseName() {
+    return t_active.phase == ImportPhase::Count ? "Import" : GetImportPhaseName(t_active.phase);
+}
+
+void AppendJsonEscaped(std::string& out, const char* text) {
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+        }
+        out += *c;
+    }
+}
+
+}
+
+const char* GetImportPhaseName(ImportPhase phase) {
+    static const char* const names[kImportPhaseCount] = {
+        "Parse", "Layout", "Meshes", "Nodes", "Skins", "Optimize", "Lods", "Meshlets", "Quantize", "Deduplicate"
+    };
+    return (size_t)phase < kImportPhaseCount ? names[(size_t)phase] : "Unknown";
+}
+
+const char* GetAttribTypeName(size_t bit) {
+    static const char* const names[kAttribTypeCount] = {
+        "Position", "Normal", "Tangent", "BiTangent", "TexCoord", "Color", "Joints", "Weights", "Blendshape"
+    };
+    return bit < kAttribTypeCount ? names[bit] : "Unknown";
+}
+
+double ImportStats::GetTotalWallSeconds() const {
+    double total = 0.0;
+    for (const PhaseTiming& phase : phases) {
+        total += phase.wall_seconds;
+    }
+    return total;
+}
+
+double ImportStats::GetTotalCpuSeconds() const {
+    double total = 0.0;
+    for (const PhaseTiming& phase : phases) {
+        total += phase.cpu_seconds;
+    }
+    return total;
+}
+
+double ImportStats::GetThreadUtilization() const {
+    return worker_available_seconds > 0.0 ? worker_busy_seconds / worker_available_seconds : 1.0;
+}
+
+void MergeImportStats(ImportStats& total, const ImportStats& stats, uint32_t file) {
+    for (size_t i = 0; i < kImportPhaseCount; ++i) {
+        total.phases[i].wall_seconds += stats.phases[i].wall_seconds;
+        total.phases[i].cpu_seconds += stats.phases[i].cpu_seconds;
+    }
+    total.face_bytes += stats.face_bytes;
+    for (size_t i = 0; i < kAttribTypeCount; ++i) {
+        total.attribute_bytes[i] += stats.attribute_bytes[i];
+    }
+    total.peak_allocated_bytes = std::max(total.peak_allocated_bytes, stats.peak_allocated_bytes);
+    total.node_count += stats.node_count;
+    total.mesh_count += stats.mesh_count;
+    total.face_count += stats.face_count;
+    total.vertex_count += stats.vertex_count;
+    total.max_workers = std::max(total.max_workers, stats.max_workers);
+    total.worker_busy_seconds += stats.worker_busy_seconds;
+    total.worker_available_seconds += stats.worker_available_seconds;
+    for (TraceEvent event : stats.trace_events) {
+        event.file = file;
+        total.trace_events.push_back(event);
+    }
+}
+
+void CountImportedData(const SceneStorage& storage, ImportStats& stats) {
+    stats.node_count += storage.nodes.size();
+    stats.mesh_count += storage.mesh_infos.size();
+    for (const MeshInfo& mesh_info : storage.mesh_infos) {
+        stats.face_count += mesh_info.face_count;
+        stats.face_bytes += (uint64_t)mesh_info.face_count * sizeof(Face);
+    }
+    for (const AttributeInfo& attrib_info : storage.attrib_infos) {
+        size_t bit = (size_t)std::countr_zero((uint32_t)attrib_info.attrib_type);
+        if (bit >= kAttribTypeCount) {
+            continue;
+        }
+        stats.attribute_bytes[bit] += (uint64_t)attrib_info.index_count * GetIndexSize(attrib_info) +
+            (uint64_t)attrib_info.value_count * GetValueSize(attrib_info);
+        if (attrib_info.attrib_type == VertexAttribType::Position) {
+            stats.vertex_count += attrib_info.value_count;
+        }
+    }
+    // uint32 vertex indices, float3 position deltas and the optional float3 normal deltas
+    size_t blendshape_bit = (size_t)std::countr_zero((uint32_t)VertexAttribType::Blendshape);
+    for (const BlendshapeInfo& shape : storage.blendshape_infos) {
+        stats.attribute_bytes[blendshape_bit] += (uint64_t)shape.vertex_count * (shape.has_normals ? 28 : 16);
+    }
+}
+
+std::string FormatChromeTrace(const ImportStats& stats) {
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char number[160];
+    for (size_t i = 0; i < stats.trace_events.size(); ++i) {
+        const TraceEvent& event = stats.trace_events[i];
+        out += i > 0 ? ",\n" : "\n";
+        out += "{\"name\":\"";
+        AppendJsonEscaped(out, event.name);
+        out += "\",\"cat\":\"";
+        AppendJsonEscaped(out, event.category);
+        snprintf(number, sizeof(number), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+            "\"args\":{\"file\":%u}}", event.start_us, event.duration_us, event.thread, event.file);
+        out += number;
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+bool WriteChromeTrace(const ImportStats& stats, const char* path, std::string* error) {
+    std::string trace = FormatChromeTrace(stats);
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        if (error) {
+            *error = std::string("cannot open ") + path + " for writing";
+        }
+        return false;
+    }
+    bool written = fwrite(trace.data(), 1, trace.size(), file) == trace.size();
+    written = fclose(file) == 0 && written;
+    if (!written && error) {
+        *error = std::string("failed to write ") + path;
+    }
+    return written;
+}
+
+ImportStatsScope::ImportStatsScope(ImportStats* stats)
+    : m_previous_stats(t_active.stats),
+      m_previous_worker_cpu_seconds(t_active.worker_cpu_seconds),
+      m_previous_phase(t_active.phase) {
+    t_active.stats = stats;
+    t_active.worker_cpu_seconds = 0.0;
+    t_active.phase = ImportPhase::Count;
+}
+
+ImportStatsScope::~ImportStatsScope() {
+    t_active.stats = m_previous_stats;
+    t_active.worker_cpu_seconds = m_previous_worker_cpu_seconds;
+    t_active.phase = m_previous_phase;
+}
+
+PhaseTimer::PhaseTimer(ImportPhase phase) : m_stats(t_active.stats), m_phase(phase) {
+    if (!m_stats) {
+        return;
+    }
+    m_previous_phase = t_active.phase;
+    t_active.phase = phase;
+    m_start_us = NowUs();
+    m_cpu_start = GetThreadCpuSeconds();
+    m_worker_cpu_start = t_active.worker_cpu_seconds;
+}
+
+PhaseTimer::~PhaseTimer() {
+    Stop();
+}
+
+void PhaseTimer::Stop() {
+    if (!m_stats) {
+        return;
+    }
+    double duration_us = NowUs() - m_start_us;
+    PhaseTiming& timing = m_stats->phases[(size_t)m_phase];
+    timing.wall_seconds += duration_us * 1e-6;
+    timing.cpu_seconds += GetThreadCpuSeconds() - m_cpu_start + t_active.worker_cpu_seconds - m_worker_cpu_start;
+    if (m_stats->record_trace) {
+        m_stats->trace_events.push_back({ GetImportPhaseName(m_phase), "phase", GetTraceThreadId(), 0,
+            m_start_us, duration_us });
+    }
+    t_active.phase = m_previous_phase;
+    m_stats = nullptr;
+}
+
+void RecordAllocatedBytes(uint64_t live_bytes) {
+    if (ImportStats* stats = t_active.stats) {
+        stats->peak_allocated_bytes = std::max(stats->peak_allocated_bytes, live_bytes);
+    }
+}
+
+void WorkerSpan::Begin() {
+    thread = GetTraceThreadId();
+    start_us = NowUs();
+    cpu_seconds = GetThreadCpuSeconds();
+}
+
+void WorkerSpan::End() {
+    end_us = NowUs();
+    cpu_seconds = GetThreadCpuSeconds() - cpu_seconds;
+}
+
+ParallelForRecorder::ParallelForRecorder(uint32_t worker_count) : m_stats(t_active.stats) {
+    if (!m_stats) {
+        return;
+    }
+    m_spans.resize(worker_count);
+    m_start_us = NowUs();
+}
+
+ParallelForRecorder::~ParallelForRecorder() {
+    if (!m_stats) {
+        return;
+    }
+    double wall_us = NowUs() - m_start_us;
+    uint32_t worker_count = (uint32_t)m_spans.size();
+    m_stats->max_workers = std::max(m_stats->max_workers, worker_count);
+    m_stats->worker_available_seconds += wall_us * 1e-6 * worker_count;
+    const char* name = GetActivePhaseName();
+    for (uint32_t w = 0; w < worker_count; ++w) {
+        const WorkerSpan& span = m_spans[w];
+        m_stats->worker_busy_seconds += (span.end_us - span.start_us) * 1e-6;
+        // The calling thread is worker 0, its CPU time is already part of the running phase
+        if (w > 0) {
+            t_active.worker_cpu_seconds += span.cpu_seconds;
+        }
+        if (m_stats->record_trace) {
+            m_stats->trace_events.push_back({ name, "worker", span.thread, 0, span.start_us,
+                span.end_us - span.start_us });
+        }
+    }
+}
+
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "scene_data.h"
+
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+namespace mesh2py::common {
+
+// Stages of an import in the order they run. Parse reads the source file, Layout sizes the
+// records and allocates the data blob, the stages after Skins are the RunPostImport stages.
+enum class ImportPhase : uint32_t {
+    Parse,
+    Layout,
+    Meshes,
+    Nodes,
+    Skins,
+    Optimize,
+    Lods,
+    Meshlets,
+    Quantize,
+    Deduplicate,
+    Count
+};
+constexpr size_t kImportPhaseCount = (size_t)ImportPhase::Count;
+
+// One slot per VertexAttribType bit
+constexpr size_t kAttribTypeCount = 9;
+
+const char* GetImportPhaseName(ImportPhase phase);
+// Name of the VertexAttribType with bit `bit`
+const char* GetAttribTypeName(size_t bit);
+
+struct PhaseTiming {
+    double wall_seconds = 0.0;
+    // CPU time of the importing thread plus that of the ParallelFor workers it started
+    double cpu_seconds = 0.0;
+};
+
+// Complete event of a Chrome trace
+struct TraceEvent {
+    // Phase name, static storage
+    const char* name;
+    // "phase" for the importing thread, "worker" for a ParallelFor worker
+    const char* category;
+    // Small id of the recording thread, stable for the life of the thread
+    uint32_t thread;
+    // Index of the file in an ImportMany batch, 0 otherwise
+    uint32_t file;
+    // Microseconds since the first event of the process
+    double start_us;
+    double duration_us;
+};
+
+// Timings and counts of one or more imports, filled when passed as ImportOptions::stats.
+// Values are added to what the struct already holds, so one ImportStats can sum several
+// imports.
+struct ImportStats {
+    PhaseTiming phases[kImportPhaseCount];
+
+    // Bytes the importer wrote: the faces, and the indices plus values of every attribute
+    // indexed by its VertexAttribType bit. Blend shape deltas count under Blendshape.
+    uint64_t face_bytes = 0;
+    uint64_t attribute_bytes[kAttribTypeCount] = {};
+
+    // Largest total of parser memory and data blobs alive at once, sampled between phases.
+    // The largest single import for merged stats.
+    uint64_t peak_allocated_bytes = 0;
+
+    // Of the imported scene, before the post import stages
+    uint64_t node_count = 0;
+    uint64_t mesh_count = 0;
+    uint64_t face_count = 0;
+    // Position values
+    uint64_t vertex_count = 0;
+
+    // Parallel loops of the import: the most workers one ran on (0 when every loop ran on the
+    // calling thread), the time the workers spent taking items, and the time they were
+    // available (loop wall time times workers)
+    uint32_t max_workers = 0;
+    double worker_busy_seconds = 0.0;
+    double worker_available_seconds = 0.0;
+
+    // Set before the import to record a TraceEvent per phase and per ParallelFor worker
+    bool record_trace = false;
+    std::vector<TraceEvent> trace_events;
+
+    double GetTotalWallSeconds() const;
+    double GetTotalCpuSeconds() const;
+    // Busy share of the available worker time, 1 when nothing ran in parallel
+    double GetThreadUtilization() const;
+};
+
+// Adds `stats` to `total`. Trace events are appended with their file set to `file`.
+void MergeImportStats(ImportStats& total, const ImportStats& stats, uint32_t file);
+
+// Adds the record counts and the bytes of the faces and attributes of `storage` to `stats`
+void CountImportedData(const SceneStorage& storage, ImportStats& stats);
+
+// Chrome trace event JSON of the recorded events, loadable in chrome://tracing and Perfetto
+std::string FormatChromeTrace(const ImportStats& stats);
+// Writes FormatChromeTrace to `path`. Returns false and stores the reason in `error` (when not
+// null) on failure.
+bool WriteChromeTrace(const ImportStats& stats, const char* path, std::string* error);
+
+// Makes `stats` the target of the instrumentation below on the calling thread until the
+// scope ends, nullptr turns it off. Without an active target every recording call costs one
+// thread local load.
+class ImportStatsScope {
+public:
+    explicit ImportStatsScope(ImportStats* stats);
+    ~ImportStatsScope();
+
+    ImportStatsScope(const ImportStatsScope&) = delete;
+    ImportStatsScope& operator=(const ImportStatsScope&) = delete;
+
+private:
+    // Target of the enclosing scope, restored when this one ends
+    ImportStats* m_previous_stats;
+    double m_previous_worker_cpu_seconds;
+    ImportPhase m_previous_phase;
+};
+
+// Adds the wall and CPU time until the end of the scope, or until Stop, to `phase` of the
+// active stats
+class PhaseTimer {
+public:
+    explicit PhaseTimer(ImportPhase phase);
+    ~PhaseTimer();
+
+    void Stop();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    ImportStats* m_stats;
+    ImportPhase m_phase;
+    ImportPhase m_previous_phase;
+    double m_start_us;
+    double m_cpu_start;
+    double m_worker_cpu_start;
+};
+
+// Raises the peak of the active stats to `live_bytes`
+void RecordAllocatedBytes(uint64_t live_bytes);
+
+// Time a ParallelFor worker spent taking items
+struct WorkerSpan {
+    uint32_t thread;
+    double start_us;
+    double end_us;
+    double cpu_seconds;
+
+    // Called on the worker thread around its loop
+    void Begin();
+    void End();
+};
+
+// Collects the WorkerSpan of every worker of one ParallelFor and adds them to the active stats
+// when destroyed on the calling thread. Inactive, with every span nullptr, when no stats are.
+class ParallelForRecorder {
+public:
+    explicit ParallelForRecorder(uint32_t worker_count);
+    ~ParallelForRecorder();
+
+    ParallelForRecorder(const ParallelForRecorder&) = delete;
+    ParallelForRecorder& operator=(const ParallelForRecorder&) = delete;
+
+    WorkerSpan* GetSpan(uint32_t worker) { return m_stats ? &m_spans[worker] : nullptr; }
+
+private:
+    ImportStats* m_stats;
+    std::vector<WorkerSpan> m_spans;
+    double m_start_us = 0.0;
+};
+
+}
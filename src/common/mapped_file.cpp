@@ -0,0 +1,99 @@
+#include "mapped_file.h"
+
+#include "scene_data.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mesh2py::common {
+
+MappedFileAllocator::MappedFileAllocator(uint8_t* base, size_t length, void* file, void* mapping)
+    : m_base(base), m_length(length), m_file(file), m_mapping(mapping) {
+}
+
+MappedFileAllocator::~MappedFileAllocator() {
+#if defined(_WIN32)
+    UnmapViewOfFile(m_base);
+    CloseHandle((HANDLE)m_mapping);
+    CloseHandle((HANDLE)m_file);
+#else
+    munmap(m_base, m_length);
+#endif
+}
+
+void* MappedFileAllocator::Allocate(size_t size) {
+    return GetDefaultStorageAllocator()->Allocate(size);
+}
+
+void MappedFileAllocator::Deallocate(void* ptr, size_t size) {
+    if ((uint8_t*)ptr >= m_base && (uint8_t*)ptr < m_base + m_length) {
+        return;
+    }
+    GetDefaultStorageAllocator()->Deallocate(ptr, size);
+}
+
+std::shared_ptr<MappedFileAllocator> MapFile(const char* path, size_t tail_size) {
+#if defined(_WIN32)
+    if (tail_size) {
+        return nullptr;
+    }
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return nullptr;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return nullptr;
+    }
+    void* base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (!base) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+    return std::make_shared<MappedFileAllocator>((uint8_t*)base, (size_t)file_size.QuadPart, file, mapping);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    size_t file_size = (size_t)st.st_size;
+    size_t length = tail_size ? align_up(file_size, kMappedTailAlignment) + tail_size : file_size;
+
+    // Reserve the whole range as zeroed anonymous memory, then place the file at its start
+    void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | (tail_size ? MAP_ANONYMOUS : 0),
+        tail_size ? -1 : fd, 0);
+    if (base != MAP_FAILED && tail_size &&
+        mmap(base, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, length);
+        base = MAP_FAILED;
+    }
+    close(fd);
+    if (base == MAP_FAILED) {
+        return nullptr;
+    }
+    return std::make_shared<MappedFileAllocator>((uint8_t*)base, length);
+#endif
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "data_buffer.h"
+
+namespace mesh2py::common {
+
+// Start of the anonymous tail behind a mapped file, a multiple of every page size in use
+constexpr size_t kMappedTailAlignment = 65536;
+
+// Keeps a file mapping alive for as long as a DataBuffer points into it. Growing the
+// buffer later moves it to the heap.
+class MappedFileAllocator : public StorageAllocator {
+public:
+    // `file` and `mapping` are the Win32 handles closed with the view, unused elsewhere
+    MappedFileAllocator(uint8_t* base, size_t length, void* file = nullptr, void* mapping = nullptr);
+    ~MappedFileAllocator() override;
+
+    void* Allocate(size_t size) override;
+    void Deallocate(void* ptr, size_t size) override;
+
+    uint8_t* base() const { return m_base; }
+    size_t length() const { return m_length; }
+
+private:
+    uint8_t* m_base;
+    size_t m_length;
+    void* m_file;
+    void* m_mapping;
+};
+
+// Maps `path` copy on write, writes through the mapping stay private to the process.
+// With a `tail_size` the file is followed by that many zeroed bytes starting at
+// align_up(file size, kMappedTailAlignment), in the same address range, so data derived
+// from the file can sit next to it in one blob. Tails are not supported on Windows.
+// Returns nullptr on failure or for empty files.
+std::shared_ptr<MappedFileAllocator> MapFile(const char* path, size_t tail_size = 0);
+
+}
@@ -0,0 +1,239 @@
+#include "optimize_meshes.h"
+
+#include "blendshapes.h"
+#include "thread_pool.h"
+#include "unify_vertices.h"
+
+#include <meshoptimizer.h>
+
+#include <cstring>
+
+namespace mesh2py::common {
+
+namespace {
+
+// Overdraw may make the vertex cache this much worse, the meshoptimizer recommendation
+constexpr float kOverdrawThreshold = 1.05f;
+
+struct OptimizedMesh {
+    std::vector<Face> faces;
+    std::vector<uint32_t> indices;
+    // Old vertex to new vertex, empty when the vertices are kept as they are
+    std::vector<uint32_t> remap;
+    uint32_t vertex_count = 0;
+    // Blend shapes on the remapped vertices
+    MeshBlendshapes blendshapes;
+};
+
+// Moves the blend shapes along with the vertex fetch remap
+void RemapMeshBlendshapes(const SceneStorage& unified, const MeshInfo& mesh_info, OptimizedMesh& mesh) {
+    if (mesh_info.blendshape_count == 0 || mesh_info.attribute_info_count == 0) {
+        return;
+    }
+    uint32_t source_count = unified.attrib_infos[mesh_info.attrib_info_start_index].value_count;
+    std::vector<uint32_t> sources(mesh.vertex_count, UINT32_MAX);
+    for (uint32_t v = 0; v < source_count; ++v) {
+        uint32_t target = mesh.remap.empty() ? v : mesh.remap[v];
+        if (target < mesh.vertex_count) {
+            sources[target] = v;
+        }
+    }
+    RemapBlendshapes(unified, mesh_info, sources, source_count, mesh.blendshapes);
+}
+
+void OptimizeMesh(const SceneStorage& unified, const MeshInfo& mesh_info, OptimizedMesh& mesh) {
+    std::span<const Face> faces((const Face*)(unified.data.data() + mesh_info.face_offset), mesh_info.face_count);
+    if (mesh_info.attribute_info_count == 0) {
+        mesh.faces.assign(faces.begin(), faces.end());
+        return;
+    }
+    const AttributeInfo* attrib_infos = &unified.attrib_infos[mesh_info.attrib_info_start_index];
+    const uint32_t* corners = (const uint32_t*)(unified.data.data() + attrib_infos[0].index_offset);
+    mesh.vertex_count = attrib_infos[0].value_count;
+
+    bool triangles = true;
+    size_t triangle_count = 0;
+    for (const Face& face : faces) {
+        triangles = triangles && face.num_of_indices >= 3;
+        triangle_count += face.num_of_indices >= 3 ? face.num_of_indices - 2 : 0;
+    }
+    if (!triangles) {
+        mesh.faces.assign(faces.begin(), faces.end());
+        mesh.indices.assign(corners, corners + attrib_infos[0].index_count);
+        RemapMeshBlendshapes(unified, mesh_info, mesh);
+        return;
+    }
+
+    mesh.indices.reserve(triangle_count * 3);
+    for (const Face& face : faces) {
+        const uint32_t* face_corners = corners + face.indices_begin;
+        for (uint32_t i = 1; i + 1 < face.num_of_indices; ++i) {
+            mesh.indices.push_back(face_corners[0]);
+            mesh.indices.push_back(face_corners[i]);
+            mesh.indices.push_back(face_corners[i + 1]);
+        }
+    }
+    uint32_t* indices = mesh.indices.data();
+    size_t index_count = mesh.indices.size();
+
+    meshopt_optimizeVertexCache(indices, indices, index_count, mesh.vertex_count);
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        if (attrib_infos[a].attrib_type == VertexAttribType::Position && attrib_infos[a].num_value_per_index == 3) {
+            const float* positions = (const float*)(unified.data.data() + attrib_infos[a].value_offset);
+            meshopt_optimizeOverdraw(indices, indices, index_count, positions, mesh.vertex_count,
+                3 * sizeof(float), kOverdrawThreshold);
+            break;
+        }
+    }
+    mesh.remap.resize(mesh.vertex_count);
+    mesh.vertex_count = (uint32_t)meshopt_optimizeVertexFetchRemap(mesh.remap.data(), indices, index_count, mesh.vertex_count);
+    meshopt_remapIndexBuffer(indices, indices, index_count, mesh.remap.data());
+    RemapMeshBlendshapes(unified, mesh_info, mesh);
+
+    mesh.faces.resize(triangle_count);
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        mesh.faces[i] = { 3 * i, 3 };
+    }
+}
+
+uint64_t LayoutOptimizedMesh(const SceneStorage& unified, uint32_t mesh_index, const OptimizedMesh& mesh,
+    uint64_t current_offset, SceneStorage& optimized) {
+    const MeshInfo& mesh_info = unified.mesh_infos[mesh_index];
+    MeshInfo& optimized_info = optimized.mesh_infos[mesh_index];
+    optimized_info = mesh_info;
+
+    current_offset = align_up(current_offset, 16);
+    optimized_info.face_offset = (DataOffset)current_offset;
+    optimized_info.face_count = (uint32_t)mesh.faces.size();
+    current_offset += (uint64_t)mesh.faces.size() * sizeof(Face);
+
+    current_offset = align_up(current_offset, 16);
+    DataOffset index_offset = (DataOffset)current_offset;
+    current_offset += (uint64_t)mesh.indices.size() * sizeof(uint32_t);
+
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        uint32_t attrib_index = mesh_info.attrib_info_start_index + a;
+        AttributeInfo& attrib_info = optimized.attrib_infos[attrib_index];
+        attrib_info = unified.attrib_infos[attrib_index];
+        attrib_info.index_offset = index_offset;
+        attrib_info.index_count = (uint32_t)mesh.indices.size();
+
+        current_offset = align_up(current_offset, 16);
+        attrib_info.value_offset = (DataOffset)current_offset;
+        attrib_info.value_count = mesh.vertex_count;
+        current_offset += (uint64_t)attrib_info.value_count * GetValueSize(attrib_info);
+    }
+
+    if (mesh_info.blendshape_count > 0) {
+        BlendshapeInfo* shapes = &optimized.blendshape_infos[mesh_info.blendshape_start_index];
+        for (uint32_t s = 0; s < mesh_info.blendshape_count; ++s) {
+            shapes[s].vertex_count = s < mesh.blendshapes.vertex_counts.size() ? mesh.blendshapes.vertex_counts[s] : 0;
+        }
+        current_offset = LayoutBlendshapes(shapes, mesh_info.blendshape_count, shapes[0].has_normals != 0, current_offset);
+    }
+    return current_offset;
+}
+
+void WriteOptimizedMesh(const SceneStorage& unified, uint32_t mesh_index, const OptimizedMesh& mesh,
+    SceneStorage& optimized) {
+    const MeshInfo& mesh_info = unified.mesh_infos[mesh_index];
+    const MeshInfo& optimized_info = optimized.mesh_infos[mesh_index];
+
+    memcpy(optimized.data.data() + optimized_info.face_offset, mesh.faces.data(), sizeof(Face) * mesh.faces.size());
+    ZeroPadding(optimized, optimized_info.face_offset + sizeof(Face) * mesh.faces.size());
+    if (mesh_info.attribute_info_count == 0) {
+        return;
+    }
+
+    DataOffset index_offset = optimized.attrib_infos[mesh_info.attrib_info_start_index].index_offset;
+    memcpy(optimized.data.data() + index_offset, mesh.indices.data(), sizeof(uint32_t) * mesh.indices.size());
+    ZeroPadding(optimized, index_offset + sizeof(uint32_t) * mesh.indices.size());
+
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        uint32_t attrib_index = mesh_info.attrib_info_start_index + a;
+        const AttributeInfo& attrib_info = unified.attrib_infos[attrib_index];
+        const AttributeInfo& optimized_attrib = optimized.attrib_infos[attrib_index];
+        const uint8_t* values = unified.data.data() + attrib_info.value_offset;
+        uint8_t* dst = optimized.data.data() + optimized_attrib.value_offset;
+
+        size_t vertex_size = GetValueSize(attrib_info);
+        if (mesh.remap.empty()) {
+            memcpy(dst, values, vertex_size * attrib_info.value_count);
+        } else {
+            meshopt_remapVertexBuffer(dst, values, attrib_info.value_count, vertex_size, mesh.remap.data());
+        }
+        ZeroPadding(optimized, optimized_attrib.value_offset + vertex_size * optimized_attrib.value_count);
+    }
+    WriteBlendshapes(optimized, optimized_info, mesh.blendshapes);
+}
+
+}
+
+const AttributeInfo* GetTrianglePositions(const SceneStorage& storage, const MeshInfo& mesh_info) {
+    if (mesh_info.attribute_info_count == 0) {
+        return nullptr;
+    }
+    const AttributeInfo* attrib_infos = &storage.attrib_infos[mesh_info.attrib_info_start_index];
+    const AttributeInfo* positions = nullptr;
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        if (attrib_infos[a].index_offset != attrib_infos[0].index_offset) {
+            return nullptr;
+        }
+        if (!positions && attrib_infos[a].attrib_type == VertexAttribType::Position &&
+            attrib_infos[a].num_value_per_index == 3) {
+            positions = &attrib_infos[a];
+        }
+    }
+
+    const Face* faces = (const Face*)(storage.data.data() + mesh_info.face_offset);
+    for (uint32_t i = 0; i < mesh_info.face_count; ++i) {
+        if (faces[i].indices_begin != 3 * i || faces[i].num_of_indices != 3) {
+            return nullptr;
+        }
+    }
+    if (!positions || positions->index_count != 3 * mesh_info.face_count) {
+        return nullptr;
+    }
+    return positions;
+}
+
+bool OptimizeMeshes(const SceneStorage& storage, const ImportOptions& options,
+    SceneStorage& optimized, std::string* error) {
+    // The unified blob is scratch, keep it off the caller's allocator
+    ImportOptions unify_options;
+    unify_options.num_threads = options.num_threads;
+    SceneStorage unified;
+    if (!BuildUnifiedVertices(storage, unify_options, unified, error)) {
+        return false;
+    }
+
+    std::vector<OptimizedMesh> meshes(unified.mesh_infos.size());
+    ParallelFor(meshes.size(), options.num_threads, [&](size_t mesh_index) {
+        OptimizeMesh(unified, unified.mesh_infos[mesh_index], meshes[mesh_index]);
+    });
+
+    SceneStorage result;
+    result.nodes = std::move(unified.nodes);
+    result.joint_infos = std::move(unified.joint_infos);
+    result.blendshape_infos = unified.blendshape_infos;
+    result.mesh_infos.resize(unified.mesh_infos.size());
+    result.attrib_infos.resize(unified.attrib_infos.size());
+    uint64_t current_offset = 0;
+    for (uint32_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
+        current_offset = LayoutOptimizedMesh(unified, mesh_index, meshes[mesh_index], current_offset, result);
+    }
+    if (!CheckDataOffset(current_offset, "optimized data", error)) {
+        return false;
+    }
+
+    result.data = DataBuffer(options.allocator);
+    result.data.resize(current_offset);
+    ParallelFor(meshes.size(), options.num_threads, [&](size_t mesh_index) {
+        WriteOptimizedMesh(unified, (uint32_t)mesh_index, meshes[mesh_index], result);
+    });
+
+    optimized = std::move(result);
+    return true;
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "import_options.h"
+#include "scene_data.h"
+
+#include <string>
+
+namespace mesh2py::common {
+
+// Post-import meshoptimizer pipeline. The storage is first de-indexed with
+// BuildUnifiedVertices and polygons are fan triangulated, then every triangle mesh gets
+// vertex cache reordering, overdraw optimization (when it has positions) and vertex fetch
+// remapping, which also drops unreferenced vertices. Meshes with points or lines are only
+// unified. Faces of optimized meshes are the triangles, all attributes share one index array.
+// Meshes run in parallel with options.num_threads. Returns false and stores the reason in
+// `error` (when not null) on failure.
+bool OptimizeMeshes(const SceneStorage& storage, const ImportOptions& options,
+    SceneStorage& optimized, std::string* error);
+
+// Float3 positions of a mesh in the layout OptimizeMeshes leaves triangle meshes in: only
+// triangle faces in order and one index array shared by every attribute. nullptr for other
+// meshes, which GenerateLods and BuildMeshlets skip.
+const AttributeInfo* GetTrianglePositions(const SceneStorage& storage, const MeshInfo& mesh_info);
+
+}
@@ -0,0 +1,69 @@
+#include "post_import.h"
+
+#include "build_meshlets.h"
+#include "deduplicate.h"
+#include "generate_lods.h"
+#include "import_stats.h"
+#include "optimize_meshes.h"
+#include "quantize_attributes.h"
+
+namespace mesh2py::common {
+
+bool RunPostImport(SceneStorage& imported, const ImportOptions& options, SceneStorage& storage,
+    std::string* error) {
+    SceneStorage current = std::move(imported);
+    if (options.optimize_meshes || !options.lod_levels.empty() || options.build_meshlets) {
+        // Only the last stage writes into the caller's allocator
+        ImportOptions optimize_options = options;
+        if (options.quantize_attributes || options.deduplicate) {
+            optimize_options.allocator = nullptr;
+        }
+        PhaseTimer timer(ImportPhase::Optimize);
+        SceneStorage optimized;
+        if (!OptimizeMeshes(current, optimize_options, optimized, error)) {
+            return false;
+        }
+        RecordAllocatedBytes(current.data.size() + optimized.data.size());
+        current = std::move(optimized);
+    }
+    if (!options.lod_levels.empty()) {
+        PhaseTimer timer(ImportPhase::Lods);
+        if (!GenerateLods(current, options.lod_levels, options.num_threads, error)) {
+            return false;
+        }
+        RecordAllocatedBytes(current.data.size());
+    }
+    if (options.build_meshlets) {
+        PhaseTimer timer(ImportPhase::Meshlets);
+        if (!BuildMeshlets(current, options, error)) {
+            return false;
+        }
+        RecordAllocatedBytes(current.data.size());
+    }
+    if (options.quantize_attributes) {
+        ImportOptions quantize_options = options;
+        if (options.deduplicate) {
+            quantize_options.allocator = nullptr;
+        }
+        PhaseTimer timer(ImportPhase::Quantize);
+        SceneStorage quantized;
+        if (!QuantizeAttributes(current, quantize_options, quantized, error)) {
+            return false;
+        }
+        RecordAllocatedBytes(current.data.size() + quantized.data.size());
+        current = std::move(quantized);
+    }
+    if (options.deduplicate) {
+        PhaseTimer timer(ImportPhase::Deduplicate);
+        SceneStorage deduplicated;
+        if (!DeduplicateScene(current, options, deduplicated, error)) {
+            return false;
+        }
+        RecordAllocatedBytes(current.data.size() + deduplicated.data.size());
+        current = std::move(deduplicated);
+    }
+    storage = std::move(current);
+    return true;
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "import_options.h"
+#include "scene_data.h"
+
+#include <string>
+
+namespace mesh2py::common {
+
+// Runs the stages `options` asks for on a freshly imported scene, in order OptimizeMeshes,
+// GenerateLods, BuildMeshlets, QuantizeAttributes and DeduplicateScene, the order
+// import_options.h documents, and stores the result in `storage`. `imported` is moved into
+// `storage` when no stage is requested. Returns false and stores the reason in `error` (when
+// not null) on failure.
+bool RunPostImport(SceneStorage& imported, const ImportOptions& options, SceneStorage& storage,
+    std::string* error);
+
+}
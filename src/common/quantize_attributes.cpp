@@ -0,0 +1,478 @@
+#include "quantize_attributes.h"
+
+#include "blendshapes.h"
+#include "convert.h"
+#include "thread_pool.h"
+
+#include <meshoptimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace mesh2py::common {
+
+namespace {
+
+constexpr uint32_t kMaxUint16Values = 65536;
+
+int16_t EncodeSnorm16(float value) {
+    return (int16_t)lrintf(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+float DecodeSnorm16(int16_t value) {
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+uint8_t EncodeUnorm8(float value) {
+    return (uint8_t)lrintf(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+float DecodeHalf(uint16_t value) {
+    uint32_t sign = (uint32_t)(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    if (exponent == 0) {
+        // Zero or subnormal, mantissa * 2^-24
+        float magnitude = mantissa * (1.0f / 16777216.0f);
+        return sign ? -magnitude : magnitude;
+    }
+    uint32_t bits = exponent == 0x1f ? sign | 0x7f800000u | (mantissa << 13)
+                                     : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Octahedral projection: the unit vector is mapped onto the |x| + |y| + |z| = 1 octahedron
+// and the lower half is folded over the diagonals into the [-1, 1] square
+void EncodeOctahedral(const float* vector, int16_t* dst) {
+    float length = fabsf(vector[0]) + fabsf(vector[1]) + fabsf(vector[2]);
+    if (length == 0.0f) {
+        dst[0] = dst[1] = 0;
+        return;
+    }
+    float u = vector[0] / length;
+    float v = vector[1] / length;
+    if (vector[2] < 0.0f) {
+        float folded_u = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        float folded_v = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = folded_u;
+        v = folded_v;
+    }
+    dst[0] = EncodeSnorm16(u);
+    dst[1] = EncodeSnorm16(v);
+}
+
+void DecodeOctahedral(const int16_t* value, float* dst) {
+    float x = DecodeSnorm16(value[0]);
+    float y = DecodeSnorm16(value[1]);
+    float z = 1.0f - fabsf(x) - fabsf(y);
+    float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float scale = 1.0f / sqrtf(x * x + y * y + z * z);
+    dst[0] = x * scale;
+    dst[1] = y * scale;
+    dst[2] = z * scale;
+}
+
+bool IsPositions(const AttributeInfo& attrib_info) {
+    return attrib_info.attrib_type == VertexAttribType::Position && attrib_info.num_value_per_index == 3;
+}
+
+bool InUnitRange(const float* values, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!(values[i] >= 0.0f && values[i] <= 1.0f)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ValueEncoding ChooseValueEncoding(const SceneStorage& storage, const AttributeInfo& attrib_info,
+    const ImportOptions& options) {
+    const float* values = (const float*)(storage.data.data() + attrib_info.value_offset);
+    switch (attrib_info.attrib_type) {
+    case VertexAttribType::Position:
+        return IsPositions(attrib_info) ? options.position_encoding : ValueEncoding::Float32;
+    case VertexAttribType::Normal:
+    case VertexAttribType::Tangent:
+    case VertexAttribType::BiTangent:
+        if (attrib_info.num_value_per_index == 3) {
+            return ValueEncoding::Octahedral16;
+        }
+        return attrib_info.attrib_type == VertexAttribType::Tangent && attrib_info.num_value_per_index == 4
+            ? ValueEncoding::Snorm16 : ValueEncoding::Float16;
+    case VertexAttribType::Color:
+        return InUnitRange(values, (size_t)attrib_info.value_count * attrib_info.num_value_per_index)
+            ? ValueEncoding::Unorm8 : ValueEncoding::Float16;
+    case VertexAttribType::TexCoord:
+        return ValueEncoding::Float16;
+    default:
+        return attrib_info.value_encoding;
+    }
+}
+
+// Bounds and attribute encodings of a mesh, written straight into its quantized records
+void PlanMesh(const SceneStorage& storage, uint32_t mesh_index, const ImportOptions& options,
+    SceneStorage& quantized) {
+    const MeshInfo& mesh_info = storage.mesh_infos[mesh_index];
+    MeshInfo& quantized_info = quantized.mesh_infos[mesh_index];
+    quantized_info = mesh_info;
+    for (int axis = 0; axis < 3; ++axis) {
+        quantized_info.bounds_min[axis] = 0.0f;
+        quantized_info.bounds_max[axis] = 0.0f;
+    }
+
+    const AttributeInfo* attrib_infos = &storage.attrib_infos[mesh_info.attrib_info_start_index];
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        if (!IsPositions(attrib_infos[a]) || attrib_infos[a].value_count == 0) {
+            continue;
+        }
+        // The import bounds also cover vertices the optimization may have dropped, tighten them
+        const float* positions = (const float*)(storage.data.data() + attrib_infos[a].value_offset);
+        InitBounds(quantized_info.bounds_min, quantized_info.bounds_max);
+        ExpandBounds(positions, attrib_infos[a].value_count, quantized_info.bounds_min, quantized_info.bounds_max);
+        ResetEmptyBounds(quantized_info.bounds_min, quantized_info.bounds_max);
+        break;
+    }
+
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        AttributeInfo& quantized_attrib = quantized.attrib_infos[mesh_info.attrib_info_start_index + a];
+        quantized_attrib = attrib_infos[a];
+        quantized_attrib.value_encoding = ChooseValueEncoding(storage, attrib_infos[a], options);
+
+        // Attributes sharing an index array share its encoding
+        bool small = true;
+        for (uint32_t b = 0; b < mesh_info.attribute_info_count; ++b) {
+            if (attrib_infos[b].index_offset == attrib_infos[a].index_offset) {
+                small = small && attrib_infos[b].value_count < kMaxUint16Values;
+            }
+        }
+        quantized_attrib.index_encoding = small ? IndexEncoding::Uint16 : IndexEncoding::Uint32;
+    }
+
+    // The LOD indices and meshlet vertices index the values of every attribute
+    bool small = true;
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        small = small && attrib_infos[a].value_count < kMaxUint16Values;
+    }
+    IndexEncoding vertex_encoding = small ? IndexEncoding::Uint16 : IndexEncoding::Uint32;
+    for (uint32_t l = 0; l < mesh_info.lod_info_count; ++l) {
+        quantized.lod_infos[mesh_info.lod_info_start_index + l].index_encoding = vertex_encoding;
+    }
+    for (uint32_t m = 0; m < mesh_info.meshlet_count; ++m) {
+        quantized.meshlet_infos[mesh_info.meshlet_start_index + m].vertex_encoding = vertex_encoding;
+    }
+}
+
+// Faces, the index arrays, the values, the LODs, the meshlets and the blend shapes of every mesh,
+// index arrays stay shared.
+// `owns_indices` marks the attributes that write their index array.
+uint64_t LayoutQuantizedMesh(const SceneStorage& storage, uint32_t mesh_index, uint64_t current_offset,
+    SceneStorage& quantized, std::vector<uint8_t>& owns_indices) {
+    const MeshInfo& mesh_info = storage.mesh_infos[mesh_index];
+    MeshInfo& quantized_info = quantized.mesh_infos[mesh_index];
+
+    current_offset = align_up(current_offset, 16);
+    quantized_info.face_offset = (DataOffset)current_offset;
+    current_offset += (uint64_t)mesh_info.face_count * sizeof(Face);
+
+    uint32_t first = mesh_info.attrib_info_start_index;
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        AttributeInfo& quantized_attrib = quantized.attrib_infos[first + a];
+        uint32_t shared = a;
+        for (uint32_t b = 0; b < a; ++b) {
+            if (storage.attrib_infos[first + b].index_offset == storage.attrib_infos[first + a].index_offset) {
+                shared = b;
+                break;
+            }
+        }
+        owns_indices[first + a] = shared == a;
+        if (shared != a) {
+            quantized_attrib.index_offset = quantized.attrib_infos[first + shared].index_offset;
+            continue;
+        }
+        current_offset = align_up(current_offset, 16);
+        quantized_attrib.index_offset = (DataOffset)current_offset;
+        current_offset += (uint64_t)quantized_attrib.index_count * GetIndexSize(quantized_attrib);
+    }
+
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        AttributeInfo& quantized_attrib = quantized.attrib_infos[first + a];
+        current_offset = align_up(current_offset, 16);
+        quantized_attrib.value_offset = (DataOffset)current_offset;
+        current_offset += (uint64_t)quantized_attrib.value_count * GetValueSize(quantized_attrib);
+    }
+
+    for (uint32_t l = 0; l < mesh_info.lod_info_count; ++l) {
+        LodInfo& lod_info = quantized.lod_infos[mesh_info.lod_info_start_index + l];
+        current_offset = align_up(current_offset, 16);
+        lod_info.index_offset = (DataOffset)current_offset;
+        current_offset += (uint64_t)lod_info.index_count * GetIndexSize(lod_info.index_encoding);
+    }
+
+    // The meshlet arrays of a mesh move as a whole, the uint32 vertices possibly narrowed
+    if (mesh_info.meshlet_count > 0) {
+        MeshletInfo* meshlets = &quantized.meshlet_infos[mesh_info.meshlet_start_index];
+        const MeshletInfo& last = meshlets[mesh_info.meshlet_count - 1];
+        size_t vertex_size = GetIndexSize(meshlets[0].vertex_encoding);
+        uint64_t vertex_begin = meshlets[0].vertex_offset;
+        uint64_t vertex_end = last.vertex_offset + (uint64_t)last.vertex_count * sizeof(uint32_t);
+        uint64_t triangle_begin = meshlets[0].triangle_offset;
+        uint64_t triangle_end = last.triangle_offset + (uint64_t)last.triangle_count * 3;
+
+        uint64_t vertex_offset = align_up(current_offset, 16);
+        uint64_t triangle_offset = align_up(vertex_offset + (vertex_end - vertex_begin) / sizeof(uint32_t) * vertex_size, 16);
+        current_offset = triangle_offset + (triangle_end - triangle_begin);
+        for (uint32_t m = 0; m < mesh_info.meshlet_count; ++m) {
+            meshlets[m].vertex_offset = (DataOffset)(vertex_offset +
+                (meshlets[m].vertex_offset - vertex_begin) / sizeof(uint32_t) * vertex_size);
+            meshlets[m].triangle_offset = (DataOffset)(triangle_offset + (meshlets[m].triangle_offset - triangle_begin));
+        }
+    }
+
+    // So do the blend shape arrays, the deltas stay float32
+    if (mesh_info.blendshape_count > 0) {
+        BlendshapeInfo* shapes = &quantized.blendshape_infos[mesh_info.blendshape_start_index];
+        uint64_t block_begin = shapes[0].vertex_offset;
+        uint64_t block_offset = align_up(current_offset, 16);
+        current_offset = block_offset + GetBlendshapeBlockSize(storage, mesh_info);
+        for (uint32_t s = 0; s < mesh_info.blendshape_count; ++s) {
+            shapes[s].vertex_offset = (DataOffset)(block_offset + (shapes[s].vertex_offset - block_begin));
+            shapes[s].position_offset = (DataOffset)(block_offset + (shapes[s].position_offset - block_begin));
+            if (shapes[s].has_normals) {
+                shapes[s].normal_offset = (DataOffset)(block_offset + (shapes[s].normal_offset - block_begin));
+            }
+        }
+    }
+    return current_offset;
+}
+
+void WriteIndices(const uint32_t* indices, size_t count, IndexEncoding encoding, uint8_t* dst) {
+    if (encoding == IndexEncoding::Uint32) {
+        memcpy(dst, indices, sizeof(uint32_t) * count);
+        return;
+    }
+    uint16_t* dst16 = (uint16_t*)dst;
+    for (size_t i = 0; i < count; ++i) {
+        dst16[i] = (uint16_t)indices[i];
+    }
+}
+
+void WriteValues(const float* values, const MeshInfo& mesh_info, const AttributeInfo& attrib_info, uint8_t* dst) {
+    size_t width = attrib_info.num_value_per_index;
+    size_t count = (size_t)attrib_info.value_count * width;
+    switch (attrib_info.value_encoding) {
+    case ValueEncoding::Float32:
+        memcpy(dst, values, sizeof(float) * count);
+        break;
+    case ValueEncoding::Uint16:
+        memcpy(dst, values, sizeof(uint16_t) * count);
+        break;
+    case ValueEncoding::Float16:
+    case ValueEncoding::Snorm16: {
+        // Positions are normalized to the mesh bounds first
+        bool positions = IsPositions(attrib_info);
+        float center[3] = { 0.0f, 0.0f, 0.0f };
+        float inv_extent[3] = { 1.0f, 1.0f, 1.0f };
+        if (positions) {
+            for (int axis = 0; axis < 3; ++axis) {
+                float extent = 0.5f * (mesh_info.bounds_max[axis] - mesh_info.bounds_min[axis]);
+                center[axis] = 0.5f * (mesh_info.bounds_max[axis] + mesh_info.bounds_min[axis]);
+                inv_extent[axis] = extent > 0.0f ? 1.0f / extent : 0.0f;
+            }
+        }
+        uint16_t* dst16 = (uint16_t*)dst;
+        for (size_t i = 0; i < count; ++i) {
+            float value = positions ? (values[i] - center[i % 3]) * inv_extent[i % 3] : values[i];
+            dst16[i] = attrib_info.value_encoding == ValueEncoding::Float16 ? meshopt_quantizeHalf(value)
+                                                                            : (uint16_t)EncodeSnorm16(value);
+        }
+        break;
+    }
+    case ValueEncoding::Octahedral16:
+        for (uint32_t i = 0; i < attrib_info.value_count; ++i) {
+            EncodeOctahedral(values + 3 * i, (int16_t*)dst + 2 * i);
+        }
+        break;
+    case ValueEncoding::Unorm8:
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = EncodeUnorm8(values[i]);
+        }
+        break;
+    }
+}
+
+void WriteQuantizedMesh(const SceneStorage& storage, uint32_t mesh_index, const std::vector<uint8_t>& owns_indices,
+    SceneStorage& quantized) {
+    const MeshInfo& mesh_info = storage.mesh_infos[mesh_index];
+    const MeshInfo& quantized_info = quantized.mesh_infos[mesh_index];
+
+    memcpy(quantized.data.data() + quantized_info.face_offset, storage.data.data() + mesh_info.face_offset,
+        sizeof(Face) * mesh_info.face_count);
+    ZeroPadding(quantized, quantized_info.face_offset + sizeof(Face) * mesh_info.face_count);
+
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        uint32_t attrib_index = mesh_info.attrib_info_start_index + a;
+        const AttributeInfo& attrib_info = storage.attrib_infos[attrib_index];
+        const AttributeInfo& quantized_attrib = quantized.attrib_infos[attrib_index];
+        if (owns_indices[attrib_index]) {
+            WriteIndices((const uint32_t*)(storage.data.data() + attrib_info.index_offset), attrib_info.index_count,
+                quantized_attrib.index_encoding, quantized.data.data() + quantized_attrib.index_offset);
+            ZeroPadding(quantized, quantized_attrib.index_offset + GetIndexSize(quantized_attrib) * quantized_attrib.index_count);
+        }
+        WriteValues((const float*)(storage.data.data() + attrib_info.value_offset), quantized_info, quantized_attrib,
+            quantized.data.data() + quantized_attrib.value_offset);
+        ZeroPadding(quantized, quantized_attrib.value_offset + GetValueSize(quantized_attrib) * quantized_attrib.value_count);
+    }
+
+    for (uint32_t l = 0; l < mesh_info.lod_info_count; ++l) {
+        const LodInfo& lod_info = storage.lod_infos[mesh_info.lod_info_start_index + l];
+        const LodInfo& quantized_lod = quantized.lod_infos[mesh_info.lod_info_start_index + l];
+        WriteIndices((const uint32_t*)(storage.data.data() + lod_info.index_offset), lod_info.index_count,
+            quantized_lod.index_encoding, quantized.data.data() + quantized_lod.index_offset);
+        ZeroPadding(quantized, quantized_lod.index_offset + GetIndexSize(quantized_lod.index_encoding) * lod_info.index_count);
+    }
+
+    if (mesh_info.meshlet_count > 0) {
+        const MeshletInfo& first = storage.meshlet_infos[mesh_info.meshlet_start_index];
+        const MeshletInfo& last = storage.meshlet_infos[mesh_info.meshlet_start_index + mesh_info.meshlet_count - 1];
+        const MeshletInfo& quantized_first = quantized.meshlet_infos[mesh_info.meshlet_start_index];
+        size_t vertex_count = (last.vertex_offset + sizeof(uint32_t) * last.vertex_count - first.vertex_offset) / sizeof(uint32_t);
+        size_t vertex_size = GetIndexSize(quantized_first.vertex_encoding) * vertex_count;
+        size_t triangle_size = last.triangle_offset + 3 * last.triangle_count - first.triangle_offset;
+        WriteIndices((const uint32_t*)(storage.data.data() + first.vertex_offset), vertex_count,
+            quantized_first.vertex_encoding, quantized.data.data() + quantized_first.vertex_offset);
+        ZeroPadding(quantized, quantized_first.vertex_offset + vertex_size);
+        memcpy(quantized.data.data() + quantized_first.triangle_offset, storage.data.data() + first.triangle_offset, triangle_size);
+        ZeroPadding(quantized, quantized_first.triangle_offset + triangle_size);
+    }
+
+    if (mesh_info.blendshape_count > 0) {
+        size_t block_size = GetBlendshapeBlockSize(storage, mesh_info);
+        DataOffset block_offset = quantized.blendshape_infos[mesh_info.blendshape_start_index].vertex_offset;
+        memcpy(quantized.data.data() + block_offset,
+            storage.data.data() + storage.blendshape_infos[mesh_info.blendshape_start_index].vertex_offset, block_size);
+        ZeroPadding(quantized, block_offset + block_size);
+    }
+}
+
+}
+
+bool QuantizeAttributes(const SceneStorage& storage, const ImportOptions& options,
+    SceneStorage& quantized, std::string* error) {
+    if (IsQuantized(storage)) {
+        if (error) {
+            *error = "storage is already quantized";
+        }
+        return false;
+    }
+    if (options.position_encoding != ValueEncoding::Float16 && options.position_encoding != ValueEncoding::Snorm16) {
+        if (error) {
+            *error = "position_encoding must be Float16 or Snorm16";
+        }
+        return false;
+    }
+
+    SceneStorage result;
+    result.nodes = storage.nodes;
+    result.mesh_infos.resize(storage.mesh_infos.size());
+    result.attrib_infos.resize(storage.attrib_infos.size());
+    result.lod_infos = storage.lod_infos;
+    result.meshlet_infos = storage.meshlet_infos;
+    result.joint_infos = storage.joint_infos;
+    result.blendshape_infos = storage.blendshape_infos;
+    ParallelFor(storage.mesh_infos.size(), options.num_threads, [&](size_t mesh_index) {
+        PlanMesh(storage, (uint32_t)mesh_index, options, result);
+    });
+
+    std::vector<uint8_t> owns_indices(storage.attrib_infos.size());
+    uint64_t current_offset = 0;
+    for (uint32_t mesh_index = 0; mesh_index < storage.mesh_infos.size(); ++mesh_index) {
+        current_offset = LayoutQuantizedMesh(storage, mesh_index, current_offset, result, owns_indices);
+    }
+    if (!CheckDataOffset(current_offset, "quantized data", error)) {
+        return false;
+    }
+
+    result.data = DataBuffer(options.allocator);
+    result.data.resize(current_offset);
+    ParallelFor(storage.mesh_infos.size(), options.num_threads, [&](size_t mesh_index) {
+        WriteQuantizedMesh(storage, (uint32_t)mesh_index, owns_indices, result);
+    });
+
+    quantized = std::move(result);
+    return true;
+}
+
+bool IsQuantized(const SceneStorage& storage) {
+    for (const AttributeInfo& attrib_info : storage.attrib_infos) {
+        bool lossless = attrib_info.value_encoding == ValueEncoding::Float32 ||
+            attrib_info.value_encoding == ValueEncoding::Uint16;
+        if (!lossless || attrib_info.index_encoding != IndexEncoding::Uint32) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DecodeIndices(const SceneStorage& storage, const AttributeInfo& attrib_info, uint32_t* dst) {
+    const uint8_t* indices = storage.data.data() + attrib_info.index_offset;
+    if (attrib_info.index_encoding == IndexEncoding::Uint32) {
+        memcpy(dst, indices, sizeof(uint32_t) * attrib_info.index_count);
+        return;
+    }
+    for (uint32_t i = 0; i < attrib_info.index_count; ++i) {
+        dst[i] = ((const uint16_t*)indices)[i];
+    }
+}
+
+void DecodeValues(const SceneStorage& storage, const MeshInfo& mesh_info, const AttributeInfo& attrib_info,
+    float* dst) {
+    const uint8_t* values = storage.data.data() + attrib_info.value_offset;
+    size_t width = attrib_info.num_value_per_index;
+    size_t count = (size_t)attrib_info.value_count * width;
+    switch (attrib_info.value_encoding) {
+    case ValueEncoding::Float32:
+        memcpy(dst, values, sizeof(float) * count);
+        return;
+    case ValueEncoding::Float16:
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = DecodeHalf(((const uint16_t*)values)[i]);
+        }
+        break;
+    case ValueEncoding::Snorm16:
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = DecodeSnorm16(((const int16_t*)values)[i]);
+        }
+        break;
+    case ValueEncoding::Octahedral16:
+        for (uint32_t i = 0; i < attrib_info.value_count; ++i) {
+            DecodeOctahedral((const int16_t*)values + 2 * i, dst + 3 * i);
+        }
+        return;
+    case ValueEncoding::Unorm8:
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = values[i] / 255.0f;
+        }
+        return;
+    case ValueEncoding::Uint16:
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = ((const uint16_t*)values)[i];
+        }
+        return;
+    }
+
+    if (IsPositions(attrib_info)) {
+        for (size_t i = 0; i < count; ++i) {
+            size_t axis = i % 3;
+            float center = 0.5f * (mesh_info.bounds_max[axis] + mesh_info.bounds_min[axis]);
+            float extent = 0.5f * (mesh_info.bounds_max[axis] - mesh_info.bounds_min[axis]);
+            dst[i] = center + dst[i] * extent;
+        }
+    }
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "import_options.h"
+#include "scene_data.h"
+
+#include <string>
+
+namespace mesh2py::common {
+
+// Re-encodes a float32 storage into `quantized`, the encoding of every attribute is recorded
+// in its AttributeInfo:
+//  - 3 component positions become options.position_encoding, normalized to the mesh bounds
+//  - 3 component normals, tangents and bitangents become Octahedral16 (unit length on decode),
+//    4 component tangents Snorm16
+//  - colors become Unorm8 when all their values are in [0, 1], Float16 otherwise
+//  - texture coordinates become Float16
+//  - joints stay Uint16, weights Float32
+//  - index arrays become Uint16 when every attribute sharing them has fewer than 65536 values,
+//    the LOD indices and meshlet vertices when every attribute of the mesh does
+// Faces, nodes, joints, the meshlet triangles and the float32 blend shapes are copied. Runs
+// after BuildMeshlets in RunPostImport. Meshes are processed in parallel with
+// options.num_threads, the data blob comes from options.allocator.
+// Returns false and stores the reason in `error` (when not null) on failure.
+bool QuantizeAttributes(const SceneStorage& storage, const ImportOptions& options,
+    SceneStorage& quantized, std::string* error);
+
+// True when an attribute of `storage` has values encoded by QuantizeAttributes or Uint16 indices
+bool IsQuantized(const SceneStorage& storage);
+
+// Decodes the index_count indices of an attribute into `dst`
+void DecodeIndices(const SceneStorage& storage, const AttributeInfo& attrib_info, uint32_t* dst);
+
+// Decodes the values of an attribute of `mesh_info` into value_count * num_value_per_index
+// floats at `dst`
+void DecodeValues(const SceneStorage& storage, const MeshInfo& mesh_info, const AttributeInfo& attrib_info,
+    float* dst);
+
+}
@@ -0,0 +1,408 @@
+#include "scene_bvh.h"
+
+#include "thread_pool.h"
+#include "world_transforms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace mesh2py::common {
+
+namespace {
+
+constexpr uint32_t kBinCount = 16;
+constexpr uint32_t kMaxLeafItems = 4;
+// Ranges at most this large are left to the parallel subtree builds
+constexpr uint32_t kMinSubtreeItems = 1024;
+
+struct BuildTask {
+    uint32_t node;
+    uint32_t begin;
+    uint32_t end;
+};
+
+void InitAabb(Aabb& box) {
+    for (int axis = 0; axis < 3; ++axis) {
+        box.min[axis] = INFINITY;
+        box.max[axis] = -INFINITY;
+    }
+}
+
+void GrowAabb(Aabb& box, const Aabb& other) {
+    for (int axis = 0; axis < 3; ++axis) {
+        box.min[axis] = std::min(box.min[axis], other.min[axis]);
+        box.max[axis] = std::max(box.max[axis], other.max[axis]);
+    }
+}
+
+bool IsEmpty(const Aabb& box) {
+    return !(box.min[0] <= box.max[0] && box.min[1] <= box.max[1] && box.min[2] <= box.max[2]);
+}
+
+float HalfArea(const Aabb& box) {
+    if (IsEmpty(box)) {
+        return 0.0f;
+    }
+    float x = box.max[0] - box.min[0];
+    float y = box.max[1] - box.min[1];
+    float z = box.max[2] - box.min[2];
+    return x * y + y * z + z * x;
+}
+
+bool Overlaps(const Aabb& a, const Aabb& b) {
+    for (int axis = 0; axis < 3; ++axis) {
+        if (a.min[axis] > b.max[axis] || a.max[axis] < b.min[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float DistanceSquared(const Aabb& box, const float* point) {
+    float result = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        float d = std::max(std::max(box.min[axis] - point[axis], point[axis] - box.max[axis]), 0.0f);
+        result += d * d;
+    }
+    return result;
+}
+
+// Entry distance of the ray into `box` within [0, t_max], or a negative value when it misses
+float IntersectRay(const Aabb& box, const float* origin, const float* inv_direction, float t_max) {
+    float t_near = 0.0f;
+    float t_far = t_max;
+    for (int axis = 0; axis < 3; ++axis) {
+        float t0 = (box.min[axis] - origin[axis]) * inv_direction[axis];
+        float t1 = (box.max[axis] - origin[axis]) * inv_direction[axis];
+        // A NaN from a ray lying in the slab plane leaves the interval as is
+        t_near = std::max(t_near, std::min(t0, t1));
+        t_far = std::min(t_far, std::max(t0, t1));
+    }
+    return t_near <= t_far ? t_near : -1.0f;
+}
+
+struct BuildContext {
+    const Aabb* boxes;
+    const float* centroids;
+    uint32_t* items;
+};
+
+// Splits items [task.begin, task.end) at the cheapest of the bin planes of all three axes and
+// returns the first item of the second half, or task.begin for a leaf
+uint32_t SplitTask(const BuildContext& context, const BuildTask& task, Aabb& bounds) {
+    Aabb centroid_bounds;
+    InitAabb(bounds);
+    InitAabb(centroid_bounds);
+    for (uint32_t i = task.begin; i < task.end; ++i) {
+        uint32_t item = context.items[i];
+        GrowAabb(bounds, context.boxes[item]);
+        const float* centroid = context.centroids + 3 * (size_t)item;
+        for (int axis = 0; axis < 3; ++axis) {
+            centroid_bounds.min[axis] = std::min(centroid_bounds.min[axis], centroid[axis]);
+            centroid_bounds.max[axis] = std::max(centroid_bounds.max[axis], centroid[axis]);
+        }
+    }
+    uint32_t count = task.end - task.begin;
+    if (count <= kMaxLeafItems) {
+        return task.begin;
+    }
+
+    float best_cost = INFINITY;
+    int best_axis = -1;
+    uint32_t best_bin = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+        if (!(extent > 0.0f) || !std::isfinite(extent)) {
+            continue;
+        }
+        float scale = kBinCount / extent;
+        Aabb bin_bounds[kBinCount];
+        uint32_t bin_counts[kBinCount] = {};
+        for (uint32_t b = 0; b < kBinCount; ++b) {
+            InitAabb(bin_bounds[b]);
+        }
+        for (uint32_t i = task.begin; i < task.end; ++i) {
+            uint32_t item = context.items[i];
+            float offset = (context.centroids[3 * (size_t)item + axis] - centroid_bounds.min[axis]) * scale;
+            uint32_t b = std::min((uint32_t)offset, kBinCount - 1);
+            GrowAabb(bin_bounds[b], context.boxes[item]);
+            ++bin_counts[b];
+        }
+
+        // Cost of splitting in front of bin b: items times half area on both sides
+        float right_costs[kBinCount];
+        Aabb right;
+        InitAabb(right);
+        uint32_t right_count = 0;
+        for (uint32_t b = kBinCount - 1; b > 0; --b) {
+            GrowAabb(right, bin_bounds[b]);
+            right_count += bin_counts[b];
+            right_costs[b] = right_count * HalfArea(right);
+        }
+        Aabb left;
+        InitAabb(left);
+        uint32_t left_count = 0;
+        for (uint32_t b = 1; b < kBinCount; ++b) {
+            GrowAabb(left, bin_bounds[b - 1]);
+            left_count += bin_counts[b - 1];
+            if (left_count == 0 || left_count == count) {
+                continue;
+            }
+            float cost = left_count * HalfArea(left) + right_costs[b];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_bin = b;
+            }
+        }
+    }
+
+    uint32_t* begin = context.items + task.begin;
+    uint32_t* end = context.items + task.end;
+    if (best_axis < 0) {
+        // Every centroid coincides, halve the range so the leaves stay small
+        return task.begin + count / 2;
+    }
+    float scale = kBinCount / (centroid_bounds.max[best_axis] - centroid_bounds.min[best_axis]);
+    uint32_t* middle = std::partition(begin, end, [&](uint32_t item) {
+        float offset = (context.centroids[3 * (size_t)item + best_axis] - centroid_bounds.min[best_axis]) * scale;
+        return std::min((uint32_t)offset, kBinCount - 1) < best_bin;
+    });
+    return task.begin + (uint32_t)(middle - begin);
+}
+
+// Builds the nodes of the tasks on `stack` into `nodes`. Tasks of at most `defer_items` items
+// are moved to `deferred` instead when it is not null.
+void BuildNodes(const BuildContext& context, std::vector<BvhNode>& nodes, std::vector<BuildTask>& stack,
+    uint32_t defer_items, std::vector<BuildTask>* deferred) {
+    while (!stack.empty()) {
+        BuildTask task = stack.back();
+        stack.pop_back();
+        if (deferred && task.end - task.begin <= defer_items) {
+            deferred->push_back(task);
+            continue;
+        }
+        Aabb bounds;
+        uint32_t middle = SplitTask(context, task, bounds);
+        nodes[task.node].bounds = bounds;
+        if (middle == task.begin) {
+            nodes[task.node].first = task.begin;
+            nodes[task.node].count = task.end - task.begin;
+            continue;
+        }
+        uint32_t children = (uint32_t)nodes.size();
+        nodes.resize(nodes.size() + 2);
+        nodes[task.node].first = children;
+        nodes[task.node].count = 0;
+        stack.push_back({ children + 1, middle, task.end });
+        stack.push_back({ children, task.begin, middle });
+    }
+}
+
+}
+
+void ComputeNodeBounds(const SceneStorage& storage, const float* world, uint32_t num_threads, Aabb* bounds) {
+    ParallelFor(storage.nodes.size(), num_threads, [&](size_t n) {
+        uint32_t mesh_index = storage.nodes[n].mesh_index;
+        if (mesh_index >= storage.mesh_infos.size()) {
+            InitAabb(bounds[n]);
+            return;
+        }
+        // The center moves with the matrix, the extent grows by the absolute linear part
+        const MeshInfo& mesh_info = storage.mesh_infos[mesh_index];
+        const float* m = world + 16 * n;
+        float center[3];
+        float extent[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            center[axis] = 0.5f * (mesh_info.bounds_max[axis] + mesh_info.bounds_min[axis]);
+            extent[axis] = 0.5f * (mesh_info.bounds_max[axis] - mesh_info.bounds_min[axis]);
+        }
+        for (int row = 0; row < 3; ++row) {
+            float world_center = m[12 + row];
+            float world_extent = 0.0f;
+            for (int axis = 0; axis < 3; ++axis) {
+                world_center += m[4 * axis + row] * center[axis];
+                world_extent += fabsf(m[4 * axis + row]) * extent[axis];
+            }
+            bounds[n].min[row] = world_center - world_extent;
+            bounds[n].max[row] = world_center + world_extent;
+        }
+    });
+}
+
+bool BuildSceneBvh(const SceneStorage& storage, uint32_t num_threads, SceneBvh& bvh, std::string* error) {
+    size_t node_count = storage.nodes.size();
+    std::vector<float> world(16 * node_count);
+    if (!ComputeWorldTransforms(storage, num_threads, world.data(), error)) {
+        return false;
+    }
+    bvh.node_bounds.resize(node_count);
+    ComputeNodeBounds(storage, world.data(), num_threads, bvh.node_bounds.data());
+
+    bvh.nodes.clear();
+    bvh.items.clear();
+    for (uint32_t n = 0; n < node_count; ++n) {
+        if (!IsEmpty(bvh.node_bounds[n])) {
+            bvh.items.push_back(n);
+        }
+    }
+    if (bvh.items.empty()) {
+        return true;
+    }
+    std::vector<float> centroids(3 * node_count);
+    ParallelFor(bvh.items.size(), num_threads, [&](size_t i) {
+        const Aabb& box = bvh.node_bounds[bvh.items[i]];
+        for (int axis = 0; axis < 3; ++axis) {
+            centroids[3 * (size_t)bvh.items[i] + axis] = 0.5f * (box.min[axis] + box.max[axis]);
+        }
+    });
+    BuildContext context = { bvh.node_bounds.data(), centroids.data(), bvh.items.data() };
+
+    // Split the top of the tree here until every range fits a worker share
+    uint32_t item_count = (uint32_t)bvh.items.size();
+    uint32_t worker_count = ResolveThreadCount(num_threads);
+    uint32_t defer_items = std::max(kMinSubtreeItems, item_count / (4 * worker_count));
+    bvh.nodes.resize(1);
+    std::vector<BuildTask> stack = { { 0, 0, item_count } };
+    std::vector<BuildTask> deferred;
+    BuildNodes(context, bvh.nodes, stack, defer_items, worker_count > 1 ? &deferred : nullptr);
+
+    // The subtrees write disjoint item ranges and their own node tables, which are appended
+    // in task order with the child indices rebased
+    std::vector<std::vector<BvhNode>> subtrees(deferred.size());
+    ParallelFor(deferred.size(), num_threads, [&](size_t t) {
+        std::vector<BvhNode>& nodes = subtrees[t];
+        nodes.resize(1);
+        std::vector<BuildTask> subtree_stack = { { 0, deferred[t].begin, deferred[t].end } };
+        BuildNodes(context, nodes, subtree_stack, 0, nullptr);
+    });
+    for (size_t t = 0; t < deferred.size(); ++t) {
+        const std::vector<BvhNode>& nodes = subtrees[t];
+        uint32_t base = (uint32_t)bvh.nodes.size() - 1;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            BvhNode node = nodes[i];
+            if (node.count == 0) {
+                node.first += base;
+            }
+            if (i == 0) {
+                bvh.nodes[deferred[t].node] = node;
+            } else {
+                bvh.nodes.push_back(node);
+            }
+        }
+    }
+    return true;
+}
+
+void QueryBox(const SceneBvh& bvh, const Aabb& box, std::vector<uint32_t>& hits) {
+    if (bvh.nodes.empty()) {
+        return;
+    }
+    std::vector<uint32_t> stack = { 0 };
+    while (!stack.empty()) {
+        const BvhNode& node = bvh.nodes[stack.back()];
+        stack.pop_back();
+        if (!Overlaps(node.bounds, box)) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            if (Overlaps(bvh.node_bounds[bvh.items[i]], box)) {
+                hits.push_back(bvh.items[i]);
+            }
+        }
+    }
+}
+
+uint32_t QueryRay(const SceneBvh& bvh, const float* origin, const float* direction, float max_distance,
+    float* distance) {
+    uint32_t best = UINT32_MAX;
+    float best_t = max_distance;
+    float inv_direction[3] = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+    if (!bvh.nodes.empty() && IntersectRay(bvh.nodes[0].bounds, origin, inv_direction, best_t) >= 0.0f) {
+        // Children are visited nearest first and skipped once a closer hit is known
+        std::vector<std::pair<uint32_t, float>> stack = { { 0, 0.0f } };
+        while (!stack.empty()) {
+            auto [node_index, t_entry] = stack.back();
+            stack.pop_back();
+            if (t_entry > best_t) {
+                continue;
+            }
+            const BvhNode& node = bvh.nodes[node_index];
+            if (node.count == 0) {
+                float t0 = IntersectRay(bvh.nodes[node.first].bounds, origin, inv_direction, best_t);
+                float t1 = IntersectRay(bvh.nodes[node.first + 1].bounds, origin, inv_direction, best_t);
+                std::pair<uint32_t, float> near = { node.first, t0 };
+                std::pair<uint32_t, float> far = { node.first + 1, t1 };
+                if (t1 >= 0.0f && (t0 < 0.0f || t1 < t0)) {
+                    std::swap(near, far);
+                }
+                if (far.second >= 0.0f) {
+                    stack.push_back(far);
+                }
+                if (near.second >= 0.0f) {
+                    stack.push_back(near);
+                }
+                continue;
+            }
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                float t = IntersectRay(bvh.node_bounds[bvh.items[i]], origin, inv_direction, best_t);
+                if (t >= 0.0f && (best == UINT32_MAX || t < best_t || (t == best_t && bvh.items[i] < best))) {
+                    best = bvh.items[i];
+                    best_t = t;
+                }
+            }
+        }
+    }
+    if (distance) {
+        *distance = best == UINT32_MAX ? INFINITY : best_t;
+    }
+    return best;
+}
+
+uint32_t QueryNearest(const SceneBvh& bvh, const float* point, uint32_t k, uint32_t* nodes, float* distances) {
+    if (bvh.nodes.empty() || k == 0) {
+        return 0;
+    }
+    using Entry = std::pair<float, uint32_t>;
+    // Squared distances: the closest unvisited BVH nodes and the best k items found so far
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    std::priority_queue<Entry> best;
+    open.push({ DistanceSquared(bvh.nodes[0].bounds, point), 0 });
+    while (!open.empty()) {
+        auto [node_distance, node_index] = open.top();
+        open.pop();
+        if (best.size() == k && node_distance > best.top().first) {
+            break;
+        }
+        const BvhNode& node = bvh.nodes[node_index];
+        if (node.count == 0) {
+            open.push({ DistanceSquared(bvh.nodes[node.first].bounds, point), node.first });
+            open.push({ DistanceSquared(bvh.nodes[node.first + 1].bounds, point), node.first + 1 });
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            Entry entry = { DistanceSquared(bvh.node_bounds[bvh.items[i]], point), bvh.items[i] };
+            if (best.size() < k) {
+                best.push(entry);
+            } else if (entry < best.top()) {
+                best.pop();
+                best.push(entry);
+            }
+        }
+    }
+    uint32_t found = (uint32_t)best.size();
+    for (uint32_t i = found; i-- > 0;) {
+        nodes[i] = best.top().second;
+        distances[i] = sqrtf(best.top().first);
+        best.pop();
+    }
+    return found;
+}
+
+}
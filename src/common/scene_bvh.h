@@ -0,0 +1,58 @@
+#pragma once
+
+#include "scene_data.h"
+
+#include <string>
+#include <vector>
+
+namespace mesh2py::common {
+
+// Axis aligned box, empty when min is above max on an axis
+struct Aabb {
+    float min[3];
+    float max[3];
+};
+
+struct BvhNode {
+    Aabb bounds;
+    // First child of an inner node, the second follows it. First entry in SceneBvh::items of
+    // a leaf.
+    uint32_t first;
+    // Items of a leaf, 0 for an inner node
+    uint32_t count;
+};
+
+// Bounding volume hierarchy over the world bounds of the scene nodes that have a mesh
+struct SceneBvh {
+    // World bounds of every scene node in node order, empty for nodes without a mesh
+    std::vector<Aabb> node_bounds;
+    // nodes[0] is the root, the table is empty when no node has a mesh
+    std::vector<BvhNode> nodes;
+    // Scene node indices the leaves point into
+    std::vector<uint32_t> items;
+};
+
+// Fills `bounds` with the world bounds of every node: the MeshInfo bounds of its mesh
+// transformed by its world matrix from ComputeWorldTransforms. Empty for nodes without a mesh.
+void ComputeNodeBounds(const SceneStorage& storage, const float* world, uint32_t num_threads, Aabb* bounds);
+
+// Computes the world transforms and node bounds of `storage` and builds a BVH over them with
+// binned SAH splits. The top of the tree is split on the calling thread until the ranges left
+// are small enough to spread over `num_threads` workers, which build their subtrees in
+// parallel. Returns false and stores the reason in `error` (when not null) if the node
+// hierarchy has a cycle.
+bool BuildSceneBvh(const SceneStorage& storage, uint32_t num_threads, SceneBvh& bvh, std::string* error);
+
+// Appends the scene nodes whose bounds overlap `box` to `hits`
+void QueryBox(const SceneBvh& bvh, const Aabb& box, std::vector<uint32_t>& hits);
+
+// Scene node whose bounds the ray enters first within [0, max_distance], UINT32_MAX when none.
+// `distance` receives the entry distance along `direction`, 0 when the origin is inside.
+uint32_t QueryRay(const SceneBvh& bvh, const float* origin, const float* direction, float max_distance,
+    float* distance);
+
+// The up to `k` scene nodes whose bounds are closest to `point`, nearest first, with their
+// distances (0 inside the bounds). Returns how many were found.
+uint32_t QueryNearest(const SceneBvh& bvh, const float* point, uint32_t k, uint32_t* nodes, float* distances);
+
+}
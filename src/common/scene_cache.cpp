@@ -0,0 +1,291 @@
+#include "scene_cache.h"
+
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace mesh2py::common {
+
+namespace {
+
+constexpr char kSceneCacheMagic[8] = { 'M', '2', 'P', 'Y', 'S', 'C', 'N', 0 };
+constexpr uint32_t kEndianTag = 0x01020304;
+// Sections start on a page so the data blob can be handed out straight from the mapping
+constexpr uint64_t kSectionAlignment = 4096;
+
+enum class CacheSectionId : uint32_t {
+    Nodes = 1,
+    MeshInfos = 2,
+    AttribInfos = 3,
+    Data = 4,
+    LodInfos = 5,
+    MeshletInfos = 6,
+    JointInfos = 7,
+    BlendshapeInfos = 8
+};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;
+    uint32_t offset_bits;
+    uint32_t section_count;
+    uint64_t file_size;
+};
+
+struct CacheSection {
+    CacheSectionId id;
+    uint32_t record_size;
+    uint64_t count;
+    uint64_t offset;
+};
+
+struct SectionSource {
+    CacheSectionId id;
+    uint32_t record_size;
+    uint64_t count;
+    const void* data;
+};
+
+template <class T>
+SectionSource TableSection(CacheSectionId id, const std::vector<T>& table) {
+    return { id, (uint32_t)sizeof(T), table.size(), table.data() };
+}
+
+bool WritePadding(FILE* file, uint64_t& position, uint64_t alignment) {
+    static const uint8_t zeros[kSectionAlignment] = {};
+    uint64_t padding = align_up(position, alignment) - position;
+    position += padding;
+    return fwrite(zeros, 1, padding, file) == padding;
+}
+
+template <class T>
+bool ReadTable(const MappedFileAllocator& mapping, const CacheSection& section, std::vector<T>& table) {
+    if (section.record_size != sizeof(T)) {
+        return false;
+    }
+    table.resize(section.count);
+    if (section.count) {
+        memcpy(table.data(), mapping.base() + section.offset, section.count * sizeof(T));
+    }
+    return true;
+}
+
+// True when `count` items of `item_size` bytes starting at `offset` lie inside the data blob
+bool InData(const SceneStorage& storage, uint64_t offset, uint64_t count, uint64_t item_size) {
+    uint64_t size = storage.data.size();
+    return offset <= size && (item_size == 0 || count <= (size - offset) / item_size);
+}
+
+// True when [start, start + count) lies inside a table of `table_size` records
+bool InTable(uint64_t start, uint64_t count, size_t table_size) {
+    return start <= table_size && count <= table_size - start;
+}
+
+// Checks that every record only references data and records that exist, so views created from
+// a corrupt cache stay in bounds
+bool ValidateRecords(const SceneStorage& storage, std::string* error) {
+    auto fail = [error](const char* what, size_t index) {
+        if (error) {
+            *error = std::string(what) + " " + std::to_string(index) + " points outside the scene cache";
+        }
+        return false;
+    };
+    for (size_t i = 0; i < storage.nodes.size(); ++i) {
+        const Node& node = storage.nodes[i];
+        if ((node.parent != UINT32_MAX && node.parent >= storage.nodes.size()) ||
+            (node.mesh_index != UINT32_MAX && node.mesh_index >= storage.mesh_infos.size())) {
+            return fail("node", i);
+        }
+    }
+    for (size_t i = 0; i < storage.mesh_infos.size(); ++i) {
+        const MeshInfo& mesh_info = storage.mesh_infos[i];
+        if (!InData(storage, mesh_info.face_offset, mesh_info.face_count, sizeof(Face)) ||
+            !InTable(mesh_info.attrib_info_start_index, mesh_info.attribute_info_count, storage.attrib_infos.size()) ||
+            !InTable(mesh_info.lod_info_start_index, mesh_info.lod_info_count, storage.lod_infos.size()) ||
+            !InTable(mesh_info.meshlet_start_index, mesh_info.meshlet_count, storage.meshlet_infos.size()) ||
+            !InTable(mesh_info.joint_info_start_index, mesh_info.joint_info_count, storage.joint_infos.size()) ||
+            !InTable(mesh_info.blendshape_start_index, mesh_info.blendshape_count, storage.blendshape_infos.size())) {
+            return fail("mesh", i);
+        }
+    }
+    for (size_t i = 0; i < storage.attrib_infos.size(); ++i) {
+        const AttributeInfo& attrib_info = storage.attrib_infos[i];
+        if (attrib_info.index_encoding > IndexEncoding::Uint16 || attrib_info.value_encoding > ValueEncoding::Uint16 ||
+            !InData(storage, attrib_info.index_offset, attrib_info.index_count, GetIndexSize(attrib_info)) ||
+            !InData(storage, attrib_info.value_offset, attrib_info.value_count, GetValueSize(attrib_info))) {
+            return fail("attribute", i);
+        }
+    }
+    for (size_t i = 0; i < storage.lod_infos.size(); ++i) {
+        const LodInfo& lod_info = storage.lod_infos[i];
+        if (lod_info.index_encoding > IndexEncoding::Uint16 ||
+            !InData(storage, lod_info.index_offset, lod_info.index_count, GetIndexSize(lod_info.index_encoding))) {
+            return fail("lod", i);
+        }
+    }
+    for (size_t i = 0; i < storage.meshlet_infos.size(); ++i) {
+        const MeshletInfo& meshlet = storage.meshlet_infos[i];
+        if (meshlet.vertex_encoding > IndexEncoding::Uint16 ||
+            !InData(storage, meshlet.vertex_offset, meshlet.vertex_count, GetIndexSize(meshlet.vertex_encoding)) ||
+            !InData(storage, meshlet.triangle_offset, meshlet.triangle_count, 3)) {
+            return fail("meshlet", i);
+        }
+    }
+    for (size_t i = 0; i < storage.blendshape_infos.size(); ++i) {
+        const BlendshapeInfo& shape = storage.blendshape_infos[i];
+        if (!InData(storage, shape.vertex_offset, shape.vertex_count, sizeof(uint32_t)) ||
+            !InData(storage, shape.position_offset, shape.vertex_count, 3 * sizeof(float)) ||
+            (shape.has_normals && !InData(storage, shape.normal_offset, shape.vertex_count, 3 * sizeof(float)))) {
+            return fail("blend shape", i);
+        }
+    }
+    return true;
+}
+
+}
+
+bool SaveSceneStorage(const SceneStorage& storage, const char* path, std::string* error) {
+    SectionSource sources[] = {
+        TableSection(CacheSectionId::Nodes, storage.nodes),
+        TableSection(CacheSectionId::MeshInfos, storage.mesh_infos),
+        TableSection(CacheSectionId::AttribInfos, storage.attrib_infos),
+        { CacheSectionId::Data, 1, storage.data.size(), storage.data.data() },
+        TableSection(CacheSectionId::LodInfos, storage.lod_infos),
+        TableSection(CacheSectionId::MeshletInfos, storage.meshlet_infos),
+        TableSection(CacheSectionId::JointInfos, storage.joint_infos),
+        TableSection(CacheSectionId::BlendshapeInfos, storage.blendshape_infos),
+    };
+    constexpr uint32_t section_count = sizeof(sources) / sizeof(sources[0]);
+
+    CacheHeader header = {};
+    memcpy(header.magic, kSceneCacheMagic, sizeof(header.magic));
+    header.version = kSceneCacheVersion;
+    header.endian_tag = kEndianTag;
+    header.offset_bits = 8 * sizeof(DataOffset);
+    header.section_count = section_count;
+
+    CacheSection sections[section_count];
+    uint64_t position = sizeof(CacheHeader) + sizeof(sections);
+    for (uint32_t i = 0; i < section_count; ++i) {
+        position = align_up(position, kSectionAlignment);
+        sections[i].id = sources[i].id;
+        sections[i].record_size = sources[i].record_size;
+        sections[i].count = sources[i].count;
+        sections[i].offset = position;
+        position += sources[i].count * sources[i].record_size;
+    }
+    header.file_size = position;
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        if (error) {
+            *error = std::string("cannot open ") + path + " for writing";
+        }
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(sections, sizeof(sections), 1, file) == 1;
+    position = sizeof(CacheHeader) + sizeof(sections);
+    for (uint32_t i = 0; ok && i < section_count; ++i) {
+        uint64_t size = sources[i].count * sources[i].record_size;
+        ok = WritePadding(file, position, kSectionAlignment) &&
+             (size == 0 || fwrite(sources[i].data, 1, size, file) == size);
+        position += size;
+    }
+    ok = fclose(file) == 0 && ok;
+    if (!ok && error) {
+        *error = std::string("failed to write scene cache ") + path;
+    }
+    return ok;
+}
+
+bool MapSceneStorage(const char* path, SceneStorage& storage, std::string* error) {
+    auto fail = [&](const std::string& reason) {
+        if (error) {
+            *error = reason;
+        }
+        return false;
+    };
+
+    std::shared_ptr<MappedFileAllocator> mapping = MapFile(path);
+    if (!mapping) {
+        return fail(std::string("cannot map ") + path);
+    }
+
+    CacheHeader header;
+    if (mapping->length() < sizeof(header)) {
+        return fail(std::string(path) + " is not a scene cache");
+    }
+    memcpy(&header, mapping->base(), sizeof(header));
+    if (memcmp(header.magic, kSceneCacheMagic, sizeof(header.magic)) != 0 ||
+        header.endian_tag != kEndianTag || header.file_size != mapping->length()) {
+        return fail(std::string(path) + " is not a scene cache");
+    }
+    if (header.version != kSceneCacheVersion || header.offset_bits != 8 * sizeof(DataOffset)) {
+        return fail(std::string("scene cache ") + path + " was written by an incompatible build (version " +
+            std::to_string(header.version) + ", " + std::to_string(header.offset_bits) + " bit offsets)");
+    }
+    if (header.section_count > (mapping->length() - sizeof(header)) / sizeof(CacheSection)) {
+        return fail(std::string("scene cache ") + path + " is truncated");
+    }
+
+    SceneStorage mapped;
+    const CacheSection* sections = (const CacheSection*)(mapping->base() + sizeof(header));
+    for (uint32_t i = 0; i < header.section_count; ++i) {
+        const CacheSection& section = sections[i];
+        if (section.record_size == 0 || section.offset > mapping->length() ||
+            section.count > (mapping->length() - section.offset) / section.record_size) {
+            return fail(std::string("scene cache ") + path + " is truncated");
+        }
+
+        bool ok = true;
+        switch (section.id) {
+            case CacheSectionId::Nodes:
+                ok = ReadTable(*mapping, section, mapped.nodes);
+                break;
+            case CacheSectionId::MeshInfos:
+                ok = ReadTable(*mapping, section, mapped.mesh_infos);
+                break;
+            case CacheSectionId::AttribInfos:
+                ok = ReadTable(*mapping, section, mapped.attrib_infos);
+                break;
+            case CacheSectionId::LodInfos:
+                ok = ReadTable(*mapping, section, mapped.lod_infos);
+                break;
+            case CacheSectionId::MeshletInfos:
+                ok = ReadTable(*mapping, section, mapped.meshlet_infos);
+                break;
+            case CacheSectionId::JointInfos:
+                ok = ReadTable(*mapping, section, mapped.joint_infos);
+                break;
+            case CacheSectionId::BlendshapeInfos:
+                ok = ReadTable(*mapping, section, mapped.blendshape_infos);
+                break;
+            case CacheSectionId::Data:
+                if (section.count) {
+                    mapped.data.adopt(mapping, mapping->base() + section.offset, section.count);
+                }
+                break;
+            default:
+                // Sections from newer writers that this build does not know about
+                break;
+        }
+        if (!ok) {
+            return fail(std::string("scene cache ") + path + " has mismatching record sizes");
+        }
+    }
+
+    std::string record_error;
+    if (!ValidateRecords(mapped, &record_error)) {
+        return fail(std::string("scene cache ") + path + " is corrupt: " + record_error);
+    }
+
+    storage = std::move(mapped);
+    return true;
+}
+
+}
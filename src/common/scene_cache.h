@@ -0,0 +1,26 @@
+#pragma once
+
+#include "scene_data.h"
+
+#include <string>
+
+namespace mesh2py::common {
+
+// Binary cache of a SceneStorage: a header, a section directory, the record tables and the
+// data blob, each section aligned so the file can be mapped without any parsing. The format
+// is native endian and records the DataOffset width, files are rejected on mismatch.
+constexpr uint32_t kSceneCacheVersion = 8;
+
+// Writes `storage` to `path`. Returns false and stores the reason in `error` (when not null) on
+// failure.
+bool SaveSceneStorage(const SceneStorage& storage, const char* path, std::string* error);
+
+// Maps a file written by SaveSceneStorage into `storage`. The record tables are copied, the
+// data blob stays in the mapped pages: reload cost does not depend on the data size and
+// processes mapping the same file share its page cache. The mapping is copy on write, writes
+// through views are private to this storage. Every record is checked against the tables and
+// the data size, so a truncated or corrupt file is rejected rather than producing out of bounds
+// views. Returns false and stores the reason in `error` (when not null) on failure.
+bool MapSceneStorage(const char* path, SceneStorage& storage, std::string* error);
+
+}
@@ -1,5 +1,7 @@
 #include "scene_data.h"
 
+#include <cstring>
+
 namespace mesh2py::common {
 
 FaceView GetFaceView(SceneStorage& storage, MeshInfo& mesh_info) {
@@ -16,9 +18,65 @@ AttributeView GetAttribView(SceneStorage& storage, AttributeInfo& attrib_info) {
     size_t value_ptr = base_addr + attrib_info.value_offset;
 
     AttributeView ret;
-    ret.indices = std::span<uint32_t>((uint32_t*)index_ptr, attrib_info.index_count);
-    ret.data = std::span<float>((float*)value_ptr, attrib_info.value_count * attrib_info.num_value_per_index);
+    if (attrib_info.index_encoding == IndexEncoding::Uint32) {
+        ret.indices = std::span<uint32_t>((uint32_t*)index_ptr, attrib_info.index_count);
+    }
+    if (attrib_info.value_encoding == ValueEncoding::Float32) {
+        ret.data = std::span<float>((float*)value_ptr, attrib_info.value_count * attrib_info.num_value_per_index);
+    }
     return ret;
 }
 
-}
\ No newline at end of file
+uint32_t GetEncodedWidth(const AttributeInfo& attrib_info) {
+    return attrib_info.value_encoding == ValueEncoding::Octahedral16 ? 2 : attrib_info.num_value_per_index;
+}
+
+size_t GetIndexSize(IndexEncoding encoding) {
+    return encoding == IndexEncoding::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+size_t GetIndexSize(const AttributeInfo& attrib_info) {
+    return GetIndexSize(attrib_info.index_encoding);
+}
+
+size_t GetValueSize(const AttributeInfo& attrib_info) {
+    size_t component_size = sizeof(float);
+    switch (attrib_info.value_encoding) {
+    case ValueEncoding::Float32:
+        component_size = sizeof(float);
+        break;
+    case ValueEncoding::Float16:
+    case ValueEncoding::Snorm16:
+    case ValueEncoding::Octahedral16:
+    case ValueEncoding::Uint16:
+        component_size = sizeof(uint16_t);
+        break;
+    case ValueEncoding::Unorm8:
+        component_size = sizeof(uint8_t);
+        break;
+    }
+    return component_size * GetEncodedWidth(attrib_info);
+}
+
+bool CheckDataOffset(uint64_t size, const char* what, std::string* error) {
+    if (size <= kMaxDataOffset) {
+        return true;
+    }
+    if (error) {
+        *error = std::string(what) + " needs " + std::to_string(size) +
+            " bytes, more than DataOffset can address. Rebuild with MESH2PY_LARGE_SCENES";
+    }
+    return false;
+}
+
+void ZeroPadding(SceneStorage& storage, size_t end_offset) {
+    size_t padding_end = align_up(end_offset, 16);
+    if (padding_end > storage.data.size()) {
+        padding_end = storage.data.size();
+    }
+    if (padding_end > end_offset) {
+        memset(storage.data.data() + end_offset, 0, padding_end - end_offset);
+    }
+}
+
+}
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "data_buffer.h"
+
 #include <inttypes.h>
 #include <span>
+#include <string>
 #include <vector>
 namespace mesh2py::common {
 
@@ -12,17 +15,51 @@ constexpr T align_up(T x, size_t a) noexcept
   return T((x + (T(a) - 1)) & ~T(a - 1));
 }
 
+// Byte offset into SceneStorage::data. 32 bit by default so small scenes keep compact
+// records, builds configured with MESH2PY_LARGE_SCENES address more than 4 GB of data.
+#if defined(MESH2PY_LARGE_SCENES)
+using DataOffset = uint64_t;
+#else
+using DataOffset = uint32_t;
+#endif
+constexpr uint64_t kMaxDataOffset = UINT64_C(0xffffffffffffffff) >> (64 - 8 * sizeof(DataOffset));
+
 enum class VertexAttribType : uint32_t {
     Position  = 1u << 0,
     Normal    = 1u << 1,
+    // 3 floats from FBX, which stores BiTangent separately. 4 from glTF, w is the handedness
+    // of the bitangent cross(normal, tangent) * w and glTF has no BiTangent.
     Tangent   = 1u << 2,
     BiTangent = 1u << 3,
     TexCoord = 1u << 4,
     Color    = 1u << 5,
     Joints   = 1u << 6,
     Weights  = 1u << 7,
+    // Not emitted, blend shapes are stored sparsely in SceneStorage::blendshape_infos
     Blendshape = 1u << 8
 };
+// How the values of an attribute are stored. Everything is Float32 unless QuantizeAttributes
+// picked a compact encoding.
+enum class ValueEncoding : uint8_t {
+    Float32,
+    // IEEE half floats
+    Float16,
+    // int16 mapped to [-1, 1]
+    Snorm16,
+    // Unit vectors as two Snorm16 octahedral coordinates, num_value_per_index stays 3
+    Octahedral16,
+    // uint8 mapped to [0, 1]
+    Unorm8,
+    // Plain uint16 integers, the joint indices of skinned meshes. Not a lossy encoding, the
+    // importers write it and QuantizeAttributes keeps it.
+    Uint16
+};
+
+enum class IndexEncoding : uint8_t {
+    Uint32,
+    Uint16
+};
+
 struct Node {
     uint32_t parent;
     float transform[16];
@@ -30,25 +67,102 @@ struct Node {
 };
 
 struct MeshInfo {
-    // Index into the face_infos
-    uint32_t face_offset;
+    // Byte offset of the faces in the data
+    DataOffset face_offset;
     uint32_t face_count;
 
     // Index into the attrib_infos
     uint32_t attrib_info_start_index;
     uint32_t attribute_info_count;
+
+    // Index into the lod_infos, from the most to the least detailed level
+    uint32_t lod_info_start_index;
+    uint32_t lod_info_count;
+
+    // Index into the meshlet_infos
+    uint32_t meshlet_start_index;
+    uint32_t meshlet_count;
+
+    // Index into the joint_infos, the values of the Joints attribute index the joints of the mesh
+    uint32_t joint_info_start_index;
+    uint32_t joint_info_count;
+
+    // Index into the blendshape_infos
+    uint32_t blendshape_start_index;
+    uint32_t blendshape_count;
+
+    // Bounds of the positions, set while the importers convert them and tightened by
+    // QuantizeAttributes, zero without positions. Float16 and Snorm16 positions are
+    // normalized to them: position = min + (value + 1) / 2 * (max - min)
+    float bounds_min[3];
+    float bounds_max[3];
+};
+
+// Simplified triangle list of a mesh, it indexes the values of the mesh attributes
+struct LodInfo {
+    // Byte offset of the indices in the data
+    DataOffset index_offset;
+    uint32_t index_count;
+    // Simplification error relative to the mesh extents
+    float error;
+    // Uint32 unless QuantizeAttributes narrowed the indices
+    IndexEncoding index_encoding;
+};
+
+// Cluster of a triangle mesh built by BuildMeshlets. The vertex and triangle arrays of the
+// meshlets of one mesh are contiguous.
+struct MeshletInfo {
+    // Byte offset of the mesh vertices the meshlet uses, encoded as vertex_encoding
+    DataOffset vertex_offset;
+    // Byte offset of the uint8 triangles, three indices into the meshlet vertices each
+    DataOffset triangle_offset;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+    // Bounding sphere
+    float center[3];
+    float radius;
+    // Backface cone, the meshlet faces away from the eye when
+    // dot(normalize(cone_apex - eye), cone_axis) >= cone_cutoff
+    float cone_apex[3];
+    float cone_axis[3];
+    float cone_cutoff;
+    // Uint32 unless QuantizeAttributes narrowed the vertices, the same for every meshlet of a mesh
+    IndexEncoding vertex_encoding;
+};
+
+// Bone of a skinned mesh
+struct JointInfo {
+    // Index into the nodes
+    uint32_t node_index;
+    // Column major 4x4 from the mesh geometry to the bone space at bind time
+    float inverse_bind_matrix[16];
+};
+
+// Sparse blend shape target: deltas for the Position values it moves, indexed like them. The
+// arrays of the shapes of one mesh are contiguous, see LayoutBlendshapes.
+struct BlendshapeInfo {
+    // Byte offsets of the uint32 vertex indices and of the float3 position and normal deltas
+    DataOffset vertex_offset;
+    DataOffset position_offset;
+    DataOffset normal_offset;
+    uint32_t vertex_count;
+    // 0 when the shapes of the mesh have no normal deltas and normal_offset is unused
+    uint32_t has_normals;
+    // Weight of the channel in the source file
+    float default_weight;
 };
 
 struct AttributeInfo {
-    uint32_t index_offset;
-    uint32_t value_offset;
+    DataOffset index_offset;
+    DataOffset value_offset;
     VertexAttribType attrib_type;
     uint32_t index_count;
     uint32_t value_count;
     // This will be 3 float for vector3
-    // max_bones float
-    // 3 * max_blendshape floats for blendshapes
+    // max_joint_influences uint16 joints or float weights
     uint8_t num_value_per_index;
+    ValueEncoding value_encoding;
+    IndexEncoding index_encoding;
 };
 
 struct Face {
@@ -70,11 +184,30 @@ struct SceneStorage {
     std::vector<Node> nodes;
     std::vector<MeshInfo> mesh_infos;
     std::vector<AttributeInfo> attrib_infos;
-    std::vector<uint8_t> data;
+    std::vector<LodInfo> lod_infos;
+    std::vector<MeshletInfo> meshlet_infos;
+    std::vector<JointInfo> joint_infos;
+    std::vector<BlendshapeInfo> blendshape_infos;
+    DataBuffer data;
 };
 
 FaceView GetFaceView(SceneStorage& storage, MeshInfo& mesh_info);
+// Spans of an encoded index array or value array are left empty, see DecodeAttribute
 AttributeView GetAttribView(SceneStorage& storage, AttributeInfo& attrib_info);
 
+// Components stored per value, 2 for Octahedral16
+uint32_t GetEncodedWidth(const AttributeInfo& attrib_info);
+// Bytes of one index and of one value with all its components
+size_t GetIndexSize(IndexEncoding encoding);
+size_t GetIndexSize(const AttributeInfo& attrib_info);
+size_t GetValueSize(const AttributeInfo& attrib_info);
+
+// False when a data blob of `size` bytes is past kMaxDataOffset, the reason naming `what`
+// (e.g. "LOD data") is then stored in `error` when not null
+bool CheckDataOffset(uint64_t size, const char* what, std::string* error);
+
+// The data is not zero filled, clear the alignment gap after a region so the blob is deterministic
+void ZeroPadding(SceneStorage& storage, size_t end_offset);
+
 }
 
@@ -0,0 +1,215 @@
+#include "thread_pool.h"
+
+#include "import_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mesh2py::common {
+
+namespace {
+
+// Pending slice of the iteration space owned by one worker.
+struct alignas(64) WorkRange {
+    std::mutex lock;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+// Pops the next index from the worker's own slice.
+bool PopLocal(WorkRange& range, size_t& index) {
+    std::lock_guard<std::mutex> guard(range.lock);
+    if (range.begin >= range.end) {
+        return false;
+    }
+    index = range.begin++;
+    return true;
+}
+
+// Moves the upper half of the largest pending slice into `ranges[self]`.
+bool Steal(WorkRange* ranges, uint32_t worker_count, uint32_t self) {
+    for (;;) {
+        uint32_t victim = UINT32_MAX;
+        size_t victim_remaining = 0;
+        for (uint32_t w = 0; w < worker_count; ++w) {
+            if (w == self) {
+                continue;
+            }
+            std::lock_guard<std::mutex> guard(ranges[w].lock);
+            size_t remaining = ranges[w].end - ranges[w].begin;
+            if (ranges[w].begin < ranges[w].end && remaining > victim_remaining) {
+                victim = w;
+                victim_remaining = remaining;
+            }
+        }
+        if (victim == UINT32_MAX) {
+            return false;
+        }
+
+        size_t stolen_begin = 0;
+        size_t stolen_end = 0;
+        {
+            std::lock_guard<std::mutex> guard(ranges[victim].lock);
+            WorkRange& range = ranges[victim];
+            if (range.begin >= range.end) {
+                // Drained between the scan and the lock, look again
+                continue;
+            }
+            size_t mid = range.begin + (range.end - range.begin) / 2;
+            stolen_begin = mid;
+            stolen_end = range.end;
+            range.end = mid;
+        }
+
+        std::lock_guard<std::mutex> guard(ranges[self].lock);
+        ranges[self].begin = stolen_begin;
+        ranges[self].end = stolen_end;
+        return true;
+    }
+}
+
+// First exception thrown by `fn` on any worker, rethrown on the calling thread once every
+// worker has been joined. The other workers stop taking items after it.
+struct WorkerFailure {
+    std::mutex lock;
+    std::exception_ptr exception;
+    std::atomic<bool> failed{ false };
+
+    void Store(std::exception_ptr thrown) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!exception) {
+            exception = thrown;
+        }
+        failed.store(true, std::memory_order_relaxed);
+    }
+};
+
+void RunWorker(WorkRange* ranges, uint32_t worker_count, uint32_t self, const std::function<void(size_t)>& fn,
+    WorkerSpan* span, WorkerFailure* failure) {
+    if (span) {
+        span->Begin();
+    }
+    try {
+        size_t index = 0;
+        for (;;) {
+            while (!failure->failed.load(std::memory_order_relaxed) && PopLocal(ranges[self], index)) {
+                fn(index);
+            }
+            if (failure->failed.load(std::memory_order_relaxed) || !Steal(ranges, worker_count, self)) {
+                break;
+            }
+        }
+    } catch (...) {
+        failure->Store(std::current_exception());
+    }
+    if (span) {
+        span->End();
+    }
+}
+
+}
+
+uint32_t ResolveThreadCount(uint32_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return num_threads;
+}
+
+void ParallelFor(size_t count, uint32_t num_threads, const std::function<void(size_t)>& fn) {
+    uint32_t worker_count = (uint32_t)std::min<size_t>(ResolveThreadCount(num_threads), count);
+    if (worker_count <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    // Seed every worker with an equal contiguous slice
+    std::unique_ptr<WorkRange[]> ranges(new WorkRange[worker_count]);
+    for (uint32_t w = 0; w < worker_count; ++w) {
+        ranges[w].begin = count * w / worker_count;
+        ranges[w].end = count * (w + 1) / worker_count;
+    }
+
+    // Times every worker when the calling thread collects import stats
+    ParallelForRecorder recorder(worker_count);
+    WorkerFailure failure;
+    std::vector<std::thread> threads;
+    threads.reserve(worker_count - 1);
+    for (uint32_t w = 1; w < worker_count; ++w) {
+        threads.emplace_back(RunWorker, ranges.get(), worker_count, w, std::cref(fn), recorder.GetSpan(w), &failure);
+    }
+    RunWorker(ranges.get(), worker_count, 0, fn, recorder.GetSpan(0), &failure);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (failure.exception) {
+        std::rethrow_exception(failure.exception);
+    }
+}
+
+ThreadPool::ThreadPool(uint32_t num_threads) {
+    uint32_t worker_count = ResolveThreadCount(num_threads);
+    m_workers.reserve(worker_count);
+    for (uint32_t w = 0; w < worker_count; ++w) {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stopping = true;
+    }
+    m_task_ready.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_tasks.push_back(std::move(task));
+    }
+    m_task_ready.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> guard(m_lock);
+    m_idle.wait(guard, [this] { return m_tasks.empty() && m_running == 0; });
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> guard(m_lock);
+            m_task_ready.wait(guard, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            m_running++;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_running--;
+            if (m_tasks.empty() && m_running == 0) {
+                m_idle.notify_all();
+            }
+        }
+    }
+}
+
+}
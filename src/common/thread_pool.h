@@ -0,0 +1,56 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mesh2py::common {
+
+// Returns the number of workers to use for a requested thread count.
+// 0 selects one worker per hardware thread.
+uint32_t ResolveThreadCount(uint32_t num_threads);
+
+// Calls `fn(i)` for every i in [0, count) on up to `num_threads` workers (the calling
+// thread is one of them). Every worker starts on its own contiguous slice of the range
+// and, once it runs dry, steals the upper half of the largest slice still pending, so a
+// few very large items among many small ones do not leave the other workers idle.
+// `fn` must be safe to call concurrently for distinct indices. The first exception `fn`
+// throws stops the remaining items and is rethrown once every worker has been joined.
+void ParallelFor(size_t count, uint32_t num_threads, const std::function<void(size_t)>& fn);
+
+// Long lived workers running submitted tasks in FIFO order, for work that outlives a call
+// such as asynchronous imports.
+class ThreadPool {
+public:
+    // 0 starts one worker per hardware thread
+    explicit ThreadPool(uint32_t num_threads);
+    // Runs every task still queued, then joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+    // Blocks until the queue is empty and no task is running
+    void Wait();
+
+    uint32_t size() const { return (uint32_t)m_workers.size(); }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_lock;
+    std::condition_variable m_task_ready;
+    std::condition_variable m_idle;
+    uint32_t m_running = 0;
+    bool m_stopping = false;
+};
+
+}
@@ -0,0 +1,228 @@
+#include "unify_vertices.h"
+
+#include "blendshapes.h"
+#include "quantize_attributes.h"
+#include "thread_pool.h"
+
+#include <cstring>
+
+namespace mesh2py::common {
+
+namespace {
+
+constexpr uint32_t kEmptySlot = UINT32_MAX;
+
+// Welded vertices of one mesh
+struct UnifiedMesh {
+    // Vertex of every corner, the output index array
+    std::vector<uint32_t> corner_vertices;
+    // A corner of every vertex, its attribute indices pick the vertex values
+    std::vector<uint32_t> vertex_corners;
+    // Blend shapes moved to the welded vertices
+    MeshBlendshapes blendshapes;
+    bool valid = true;
+};
+
+uint64_t HashCorner(const std::vector<const uint32_t*>& indices, uint32_t corner) {
+    uint64_t hash = 0x9e3779b97f4a7c15ull;
+    for (const uint32_t* attribute_indices : indices) {
+        hash = (hash ^ attribute_indices[corner]) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+bool SameCorner(const std::vector<const uint32_t*>& indices, uint32_t a, uint32_t b) {
+    for (const uint32_t* attribute_indices : indices) {
+        if (attribute_indices[a] != attribute_indices[b]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Welds the corners of a mesh with an open addressing table of vertex ids, linear probing
+void WeldMesh(const SceneStorage& storage, const MeshInfo& mesh_info, UnifiedMesh& mesh) {
+    if (mesh_info.attribute_info_count == 0) {
+        return;
+    }
+    const AttributeInfo* attrib_infos = &storage.attrib_infos[mesh_info.attrib_info_start_index];
+    uint32_t corner_count = attrib_infos[0].index_count;
+
+    std::vector<const uint32_t*> indices(mesh_info.attribute_info_count);
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        const AttributeInfo& attrib_info = attrib_infos[a];
+        if (attrib_info.index_count != corner_count) {
+            mesh.valid = false;
+            return;
+        }
+        indices[a] = (const uint32_t*)(storage.data.data() + attrib_info.index_offset);
+        for (uint32_t c = 0; c < corner_count; ++c) {
+            if (indices[a][c] >= attrib_info.value_count) {
+                mesh.valid = false;
+                return;
+            }
+        }
+    }
+
+    size_t capacity = 16;
+    while (capacity < 2 * (size_t)corner_count) {
+        capacity *= 2;
+    }
+    std::vector<uint32_t> table(capacity, kEmptySlot);
+    mesh.corner_vertices.resize(corner_count);
+    for (uint32_t c = 0; c < corner_count; ++c) {
+        size_t slot = HashCorner(indices, c) & (capacity - 1);
+        while (table[slot] != kEmptySlot && !SameCorner(indices, mesh.vertex_corners[table[slot]], c)) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (table[slot] == kEmptySlot) {
+            table[slot] = (uint32_t)mesh.vertex_corners.size();
+            mesh.vertex_corners.push_back(c);
+        }
+        mesh.corner_vertices[c] = table[slot];
+    }
+
+    // Blend shapes index the position values, a welded vertex takes the position of its corner
+    if (mesh_info.blendshape_count > 0) {
+        for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+            if (attrib_infos[a].attrib_type != VertexAttribType::Position) {
+                continue;
+            }
+            std::vector<uint32_t> sources(mesh.vertex_corners.size());
+            for (size_t v = 0; v < sources.size(); ++v) {
+                sources[v] = indices[a][mesh.vertex_corners[v]];
+            }
+            RemapBlendshapes(storage, mesh_info, sources, attrib_infos[a].value_count, mesh.blendshapes);
+            break;
+        }
+    }
+}
+
+// Same block layout as the importers: faces, the shared index array, the values of every
+// attribute, then the blend shapes
+uint64_t LayoutUnifiedMesh(const SceneStorage& storage, uint32_t mesh_index, const UnifiedMesh& mesh,
+    uint64_t current_offset, SceneStorage& unified) {
+    const MeshInfo& mesh_info = storage.mesh_infos[mesh_index];
+    MeshInfo& unified_info = unified.mesh_infos[mesh_index];
+    unified_info = mesh_info;
+    // LODs and meshlets index the old vertices and are dropped
+    unified_info.lod_info_start_index = 0;
+    unified_info.lod_info_count = 0;
+    unified_info.meshlet_start_index = 0;
+    unified_info.meshlet_count = 0;
+
+    current_offset = align_up(current_offset, 16);
+    unified_info.face_offset = (DataOffset)current_offset;
+    current_offset += (uint64_t)mesh_info.face_count * sizeof(Face);
+
+    current_offset = align_up(current_offset, 16);
+    DataOffset index_offset = (DataOffset)current_offset;
+    current_offset += (uint64_t)mesh.corner_vertices.size() * sizeof(uint32_t);
+
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        uint32_t attrib_index = mesh_info.attrib_info_start_index + a;
+        AttributeInfo& attrib_info = unified.attrib_infos[attrib_index];
+        attrib_info = storage.attrib_infos[attrib_index];
+        attrib_info.index_offset = index_offset;
+
+        current_offset = align_up(current_offset, 16);
+        attrib_info.value_offset = (DataOffset)current_offset;
+        attrib_info.value_count = (uint32_t)mesh.vertex_corners.size();
+        current_offset += (uint64_t)attrib_info.value_count * GetValueSize(attrib_info);
+    }
+
+    if (mesh_info.blendshape_count > 0) {
+        BlendshapeInfo* shapes = &unified.blendshape_infos[mesh_info.blendshape_start_index];
+        for (uint32_t s = 0; s < mesh_info.blendshape_count; ++s) {
+            shapes[s].vertex_count = s < mesh.blendshapes.vertex_counts.size() ? mesh.blendshapes.vertex_counts[s] : 0;
+        }
+        current_offset = LayoutBlendshapes(shapes, mesh_info.blendshape_count, shapes[0].has_normals != 0, current_offset);
+    }
+    return current_offset;
+}
+
+void WriteUnifiedMesh(const SceneStorage& storage, uint32_t mesh_index, const UnifiedMesh& mesh,
+    SceneStorage& unified) {
+    const MeshInfo& mesh_info = storage.mesh_infos[mesh_index];
+    const MeshInfo& unified_info = unified.mesh_infos[mesh_index];
+
+    memcpy(unified.data.data() + unified_info.face_offset, storage.data.data() + mesh_info.face_offset,
+        sizeof(Face) * mesh_info.face_count);
+    ZeroPadding(unified, unified_info.face_offset + sizeof(Face) * mesh_info.face_count);
+    if (mesh_info.attribute_info_count == 0) {
+        return;
+    }
+
+    DataOffset index_offset = unified.attrib_infos[mesh_info.attrib_info_start_index].index_offset;
+    memcpy(unified.data.data() + index_offset, mesh.corner_vertices.data(), sizeof(uint32_t) * mesh.corner_vertices.size());
+    ZeroPadding(unified, index_offset + sizeof(uint32_t) * mesh.corner_vertices.size());
+
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        uint32_t attrib_index = mesh_info.attrib_info_start_index + a;
+        const AttributeInfo& attrib_info = storage.attrib_infos[attrib_index];
+        const AttributeInfo& unified_attrib = unified.attrib_infos[attrib_index];
+        const uint32_t* indices = (const uint32_t*)(storage.data.data() + attrib_info.index_offset);
+        const uint8_t* values = storage.data.data() + attrib_info.value_offset;
+        uint8_t* dst = unified.data.data() + unified_attrib.value_offset;
+
+        // Float32 values or Uint16 joints
+        size_t value_size = GetValueSize(attrib_info);
+        for (uint32_t corner : mesh.vertex_corners) {
+            memcpy(dst, values + indices[corner] * value_size, value_size);
+            dst += value_size;
+        }
+        ZeroPadding(unified, unified_attrib.value_offset + value_size * unified_attrib.value_count);
+    }
+    WriteBlendshapes(unified, unified_info, mesh.blendshapes);
+}
+
+}
+
+bool BuildUnifiedVertices(const SceneStorage& storage, const ImportOptions& options,
+    SceneStorage& unified, std::string* error) {
+    if (IsQuantized(storage)) {
+        if (error) {
+            *error = "quantized storage, unify the vertices before QuantizeAttributes";
+        }
+        return false;
+    }
+
+    std::vector<UnifiedMesh> meshes(storage.mesh_infos.size());
+    ParallelFor(meshes.size(), options.num_threads, [&](size_t mesh_index) {
+        WeldMesh(storage, storage.mesh_infos[mesh_index], meshes[mesh_index]);
+    });
+    for (size_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
+        if (!meshes[mesh_index].valid) {
+            if (error) {
+                *error = "mesh " + std::to_string(mesh_index) + " has attributes with mismatching or out of range indices";
+            }
+            return false;
+        }
+    }
+
+    SceneStorage result;
+    result.nodes = storage.nodes;
+    result.joint_infos = storage.joint_infos;
+    result.blendshape_infos = storage.blendshape_infos;
+    result.mesh_infos.resize(storage.mesh_infos.size());
+    result.attrib_infos.resize(storage.attrib_infos.size());
+    uint64_t current_offset = 0;
+    for (uint32_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
+        current_offset = LayoutUnifiedMesh(storage, mesh_index, meshes[mesh_index], current_offset, result);
+    }
+    if (!CheckDataOffset(current_offset, "unified data", error)) {
+        return false;
+    }
+
+    result.data = DataBuffer(options.allocator);
+    result.data.resize(current_offset);
+    ParallelFor(meshes.size(), options.num_threads, [&](size_t mesh_index) {
+        WriteUnifiedMesh(storage, (uint32_t)mesh_index, meshes[mesh_index], result);
+    });
+
+    unified = std::move(result);
+    return true;
+}
+
+}
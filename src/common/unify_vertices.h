@@ -0,0 +1,20 @@
+#pragma once
+
+#include "import_options.h"
+#include "scene_data.h"
+
+#include <string>
+
+namespace mesh2py::common {
+
+// De-indexes `storage` into `unified`: corners whose tuple of attribute indices match are
+// welded into one vertex, every attribute of a mesh then shares a single uint32 index array
+// and holds one value per vertex. Faces, nodes and joints are copied, blend shapes follow the
+// positions to the welded vertices, LODs and meshlets are dropped.
+// Meshes are processed in parallel with options.num_threads, the data blob comes from
+// options.allocator. All attributes of a mesh must have the same index_count. Returns false
+// and stores the reason in `error` (when not null) on failure.
+bool BuildUnifiedVertices(const SceneStorage& storage, const ImportOptions& options,
+    SceneStorage& unified, std::string* error);
+
+}
@@ -0,0 +1,122 @@
+#include "world_transforms.h"
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MESH2PY_X86 1
+#include <immintrin.h>
+#endif
+
+namespace mesh2py::common {
+
+namespace {
+
+// Levels narrower than this are multiplied on the calling thread
+constexpr size_t kMinParallelLevel = 4096;
+// Nodes per ParallelFor item on wide levels
+constexpr size_t kLevelBatch = 256;
+
+// dst = a * b, column major. dst may not alias a or b.
+#if MESH2PY_X86
+void MultiplyMatrix(float* dst, const float* a, const float* b) {
+    __m128 a0 = _mm_loadu_ps(a);
+    __m128 a1 = _mm_loadu_ps(a + 4);
+    __m128 a2 = _mm_loadu_ps(a + 8);
+    __m128 a3 = _mm_loadu_ps(a + 12);
+    for (int c = 0; c < 4; ++c) {
+        __m128 column = _mm_mul_ps(a0, _mm_set1_ps(b[4 * c]));
+        column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b[4 * c + 1])));
+        column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b[4 * c + 2])));
+        column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b[4 * c + 3])));
+        _mm_storeu_ps(dst + 4 * c, column);
+    }
+}
+#else
+void MultiplyMatrix(float* dst, const float* a, const float* b) {
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            dst[4 * c + r] = a[r] * b[4 * c] + a[4 + r] * b[4 * c + 1] + a[8 + r] * b[4 * c + 2] + a[12 + r] * b[4 * c + 3];
+        }
+    }
+}
+#endif
+
+void ComputeWorld(const SceneStorage& storage, const uint32_t* order, size_t begin, size_t end, float* world) {
+    for (size_t i = begin; i < end; ++i) {
+        uint32_t n = order[i];
+        uint32_t parent = storage.nodes[n].parent;
+        MultiplyMatrix(world + 16 * (size_t)n, world + 16 * (size_t)parent, storage.nodes[n].transform);
+    }
+}
+
+}
+
+bool ComputeWorldTransforms(const SceneStorage& storage, uint32_t num_threads, float* world, std::string* error) {
+    size_t node_count = storage.nodes.size();
+
+    // Children of every node as contiguous ranges, roots under the virtual parent node_count
+    std::vector<uint32_t> child_begin(node_count + 3, 0);
+    for (const Node& node : storage.nodes) {
+        uint32_t parent = node.parent < node_count ? node.parent : (uint32_t)node_count;
+        ++child_begin[parent + 2];
+    }
+    for (size_t i = 2; i < child_begin.size(); ++i) {
+        child_begin[i] += child_begin[i - 1];
+    }
+    std::vector<uint32_t> children(node_count);
+    for (uint32_t n = 0; n < node_count; ++n) {
+        uint32_t parent = storage.nodes[n].parent < node_count ? storage.nodes[n].parent : (uint32_t)node_count;
+        children[child_begin[parent + 1]++] = n;
+    }
+
+    // Breadth first from the roots, which keeps every level contiguous in `order`
+    std::vector<uint32_t> order;
+    order.reserve(node_count);
+    std::vector<size_t> level_ends;
+    for (uint32_t i = child_begin[node_count]; i < child_begin[node_count + 1]; ++i) {
+        order.push_back(children[i]);
+    }
+    size_t level_begin = 0;
+    while (level_begin < order.size()) {
+        size_t level_end = order.size();
+        level_ends.push_back(level_end);
+        for (size_t i = level_begin; i < level_end; ++i) {
+            uint32_t n = order[i];
+            for (uint32_t c = child_begin[n]; c < child_begin[n + 1]; ++c) {
+                order.push_back(children[c]);
+            }
+        }
+        level_begin = level_end;
+    }
+    if (order.size() != node_count) {
+        if (error) {
+            *error = std::to_string(node_count - order.size()) + " nodes are not reachable from a root, the parent links form a cycle";
+        }
+        return false;
+    }
+
+    level_begin = 0;
+    for (size_t level = 0; level < level_ends.size(); ++level) {
+        size_t level_end = level_ends[level];
+        if (level == 0) {
+            for (size_t i = level_begin; i < level_end; ++i) {
+                memcpy(world + 16 * (size_t)order[i], storage.nodes[order[i]].transform, 16 * sizeof(float));
+            }
+        } else if (level_end - level_begin < kMinParallelLevel) {
+            ComputeWorld(storage, order.data(), level_begin, level_end, world);
+        } else {
+            size_t batch_count = (level_end - level_begin + kLevelBatch - 1) / kLevelBatch;
+            ParallelFor(batch_count, num_threads, [&](size_t batch) {
+                size_t begin = level_begin + batch * kLevelBatch;
+                ComputeWorld(storage, order.data(), begin, std::min(begin + kLevelBatch, level_end), world);
+            });
+        }
+        level_begin = level_end;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "scene_data.h"
+
+#include <string>
+
+namespace mesh2py::common {
+
+// Computes the world matrix of every node into `world`, 16 column major floats per node in
+// node order. Nodes are sorted parents first and every hierarchy level is multiplied as one
+// batch with SIMD, wide levels in parallel with `num_threads`. A parent index past the node
+// table (UINT32_MAX) marks a root. Returns false and stores the reason in `error` (when not
+// null) if the parent links form a cycle.
+bool ComputeWorldTransforms(const SceneStorage& storage, uint32_t num_threads, float* world, std::string* error);
+
+}
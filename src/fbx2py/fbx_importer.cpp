@@ -1,44 +1,181 @@
 #include "fbx_importer.h"
 
+#include <common/blendshapes.h>
+#include <common/convert.h>
+#include <common/import_stats.h>
+#include <common/post_import.h>
+#include <common/thread_pool.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
 namespace mesh2py::fbx {
     using namespace mesh2py::common;
 
-    struct FbxContext {
-        const ufbx_scene* scene;
-        std::unordered_map<ufbx_node*, int> node_to_index;
-        std::unordered_map<ufbx_mesh*, int> mesh_to_index;
-        SceneStorage storage;
-    };
+    // Positions set the mesh bounds in the same pass that converts them
+    inline void ConvertPositions(float* dst, const double* src, size_t count, MeshInfo& mesh_info) {
+        InitBounds(mesh_info.bounds_min, mesh_info.bounds_max);
+        ConvertPositionsToFloat(dst, src, count, mesh_info.bounds_min, mesh_info.bounds_max);
+        ResetEmptyBounds(mesh_info.bounds_min, mesh_info.bounds_max);
+    }
+
+    inline void ConvertPositions(float* dst, const float* src, size_t count, MeshInfo& mesh_info) {
+        memcpy(dst, src, count * 3 * sizeof(float));
+        InitBounds(mesh_info.bounds_min, mesh_info.bounds_max);
+        ExpandBounds(dst, count, mesh_info.bounds_min, mesh_info.bounds_max);
+        ResetEmptyBounds(mesh_info.bounds_min, mesh_info.bounds_max);
+    }
 
     // Helper function to copy indices (no conversion needed - they're uint32_t)
     inline void CopyIndices(uint32_t* dst, const uint32_t* src, size_t count) {
         memcpy(dst, src, count * sizeof(uint32_t));
     }
 
+    // ufbx stores doubles unless built with UFBX_REAL_IS_FLOAT
+    inline void ConvertRealsToFloat(float* dst, const double* src, size_t count) {
+        ConvertDoubleToFloat(dst, src, count);
+    }
+
+    inline void ConvertRealsToFloat(float* dst, const float* src, size_t count) {
+        memcpy(dst, src, count * sizeof(float));
+    }
+
+    // ufbx vectors are packed reals, so vec2/vec3/vec4 arrays convert as one flat stream
+    static_assert(sizeof(ufbx_vec2) == 2 * sizeof(ufbx_real));
+    static_assert(sizeof(ufbx_vec3) == 3 * sizeof(ufbx_real));
+    static_assert(sizeof(ufbx_vec4) == 4 * sizeof(ufbx_real));
+
     // Helper to convert vec2 array from double to float
     inline void ConvertVec2ToFloat(float* dst, const ufbx_vec2* src, size_t count) {
-        for (size_t i = 0; i < count; i++) {
-            dst[i * 2 + 0] = static_cast<float>(src[i].x);
-            dst[i * 2 + 1] = static_cast<float>(src[i].y);
-        }
+        ConvertRealsToFloat(dst, &src->x, count * 2);
     }
 
     // Helper to convert vec3 array from double to float
     inline void ConvertVec3ToFloat(float* dst, const ufbx_vec3* src, size_t count) {
-        for (size_t i = 0; i < count; i++) {
-            dst[i * 3 + 0] = static_cast<float>(src[i].x);
-            dst[i * 3 + 1] = static_cast<float>(src[i].y);
-            dst[i * 3 + 2] = static_cast<float>(src[i].z);
-        }
+        ConvertRealsToFloat(dst, &src->x, count * 3);
     }
 
     // Helper to convert vec4 array from double to float
     inline void ConvertVec4ToFloat(float* dst, const ufbx_vec4* src, size_t count) {
-        for (size_t i = 0; i < count; i++) {
-            dst[i * 4 + 0] = static_cast<float>(src[i].x);
-            dst[i * 4 + 1] = static_cast<float>(src[i].y);
-            dst[i * 4 + 2] = static_cast<float>(src[i].z);
-            dst[i * 4 + 3] = static_cast<float>(src[i].w);
+        ConvertRealsToFloat(dst, &src->x, count * 4);
+    }
+
+    // ufbx matrices are affine, 4 columns of 3 reals. Node::transform is a column major 4x4.
+    inline void CopyMatrix(const ufbx_matrix& src, float* dst) {
+        for (int c = 0; c < 4; ++c) {
+            dst[4 * c + 0] = static_cast<float>(src.cols[c].x);
+            dst[4 * c + 1] = static_cast<float>(src.cols[c].y);
+            dst[4 * c + 2] = static_cast<float>(src.cols[c].z);
+            dst[4 * c + 3] = c == 3 ? 1.0f : 0.0f;
+        }
+    }
+
+    // Joint indices are stored as uint16
+    constexpr size_t kMaxSkinJoints = 65536;
+
+    // Skin imported for a mesh: the first skin deformer, skins need control point positions
+    inline const ufbx_skin_deformer* GetSkin(const ufbx_mesh* fbx_mesh, uint32_t max_joint_influences) {
+        if (max_joint_influences == 0 || fbx_mesh->skin_deformers.count == 0 || !fbx_mesh->vertex_position.exists) {
+            return nullptr;
+        }
+        return fbx_mesh->skin_deformers[0];
+    }
+
+    // Keeps the `width` largest weights of every control point, renormalized to sum to 1. Unused
+    // slots get joint 0 with weight 0.
+    static void ConvertSkinInfluences(const ufbx_skin_deformer* skin, uint32_t width, size_t vertex_count,
+        uint16_t* joints, float* weights) {
+        std::vector<ufbx_skin_weight> influences;
+        for (size_t v = 0; v < vertex_count; ++v) {
+            uint16_t* vertex_joints = joints + v * width;
+            float* vertex_weights = weights + v * width;
+            std::fill_n(vertex_joints, width, uint16_t(0));
+            std::fill_n(vertex_weights, width, 0.0f);
+            if (v >= skin->vertices.count) {
+                continue;
+            }
+
+            const ufbx_skin_vertex& skin_vertex = skin->vertices.data[v];
+            const ufbx_skin_weight* begin = skin->weights.data + skin_vertex.weight_begin;
+            influences.assign(begin, begin + skin_vertex.num_weights);
+            size_t kept = std::min<size_t>(width, influences.size());
+            std::partial_sort(influences.begin(), influences.begin() + kept, influences.end(),
+                [](const ufbx_skin_weight& a, const ufbx_skin_weight& b) { return a.weight > b.weight; });
+
+            double total = 0.0;
+            for (size_t i = 0; i < kept; ++i) {
+                total += influences[i].weight;
+            }
+            for (size_t i = 0; i < kept; ++i) {
+                vertex_joints[i] = (uint16_t)influences[i].cluster_index;
+                vertex_weights[i] = total > 0.0 ? float(influences[i].weight / total) : 0.0f;
+            }
+        }
+    }
+
+    // Blend shapes imported for a mesh: the target shape of every channel of its blend
+    // deformers, in order. In-between shapes are not imported.
+    static void CollectBlendChannels(const ufbx_mesh* fbx_mesh, std::vector<const ufbx_blend_channel*>& channels) {
+        channels.clear();
+        if (!fbx_mesh->vertex_position.exists) {
+            return;
+        }
+        for (size_t d = 0; d < fbx_mesh->blend_deformers.count; ++d) {
+            const ufbx_blend_deformer* deformer = fbx_mesh->blend_deformers.data[d];
+            for (size_t c = 0; c < deformer->channels.count; ++c) {
+                if (deformer->channels.data[c]->target_shape) {
+                    channels.push_back(deformer->channels.data[c]);
+                }
+            }
+        }
+    }
+
+    // Offsets of a shape that move an existing control point, the others are dropped
+    static uint32_t CountBlendOffsets(const ufbx_blend_shape* shape, size_t vertex_count) {
+        uint32_t count = 0;
+        for (size_t i = 0; i < shape->num_offsets; ++i) {
+            count += shape->offset_vertices.data[i] < vertex_count ? 1 : 0;
+        }
+        return count;
+    }
+
+    static void ImportBlendshapes(SceneStorage& storage, const MeshInfo& mesh_info, const ufbx_mesh* fbx_mesh) {
+        if (mesh_info.blendshape_count == 0) {
+            return;
+        }
+        std::vector<const ufbx_blend_channel*> channels;
+        CollectBlendChannels(fbx_mesh, channels);
+        size_t vertex_count = fbx_mesh->vertex_position.values.count;
+        for (uint32_t s = 0; s < mesh_info.blendshape_count; ++s) {
+            const BlendshapeInfo& info = storage.blendshape_infos[mesh_info.blendshape_start_index + s];
+            const ufbx_blend_shape* shape = channels[s]->target_shape;
+            uint32_t* vertices = (uint32_t*)(storage.data.data() + info.vertex_offset);
+            float* position_deltas = (float*)(storage.data.data() + info.position_offset);
+            float* normal_deltas = (float*)(storage.data.data() + info.normal_offset);
+            bool shape_normals = shape->normal_offsets.count == shape->num_offsets;
+            uint32_t entry = 0;
+            for (size_t i = 0; i < shape->num_offsets; ++i) {
+                if (shape->offset_vertices.data[i] >= vertex_count) {
+                    continue;
+                }
+                vertices[entry] = shape->offset_vertices.data[i];
+                ConvertVec3ToFloat(position_deltas + 3 * entry, shape->position_offsets.data + i, 1);
+                if (info.has_normals && shape_normals) {
+                    ConvertVec3ToFloat(normal_deltas + 3 * entry, shape->normal_offsets.data + i, 1);
+                } else if (info.has_normals) {
+                    std::fill_n(normal_deltas + 3 * entry, 3, 0.0f);
+                }
+                ++entry;
+            }
+        }
+
+        // The arrays of all shapes are contiguous, pad behind the last one
+        const BlendshapeInfo& last = storage.blendshape_infos[mesh_info.blendshape_start_index + mesh_info.blendshape_count - 1];
+        ZeroPadding(storage, last.vertex_offset + sizeof(uint32_t) * last.vertex_count);
+        ZeroPadding(storage, last.position_offset + 3 * sizeof(float) * last.vertex_count);
+        if (last.has_normals) {
+            ZeroPadding(storage, last.normal_offset + 3 * sizeof(float) * last.vertex_count);
         }
     }
 
@@ -47,10 +184,14 @@ static void ImportMesh(SceneStorage& storage, MeshInfo& mesh_info, ufbx_mesh* fb
     // Import faces first
     FaceView view = GetFaceView(storage, mesh_info);
     memcpy(view.faces.data(), fbx_mesh->faces.data, sizeof(ufbx_face) * mesh_info.face_count);
+    ZeroPadding(storage, mesh_info.face_offset + sizeof(Face) * mesh_info.face_count);
     
     // Import all the vertex attributes
     uint32_t current_uv_idx = 0;
     uint32_t current_color_idx = 0;
+    // Joints and weights are filled together once both are known
+    const AttributeInfo* joints_info = nullptr;
+    const AttributeInfo* weights_info = nullptr;
 
     uint32_t attrib_start_index = mesh_info.attrib_info_start_index;
     uint32_t attrib_end_index = attrib_start_index + mesh_info.attribute_info_count;
@@ -62,7 +203,8 @@ static void ImportMesh(SceneStorage& storage, MeshInfo& mesh_info, ufbx_mesh* fb
         switch (attrib_info.attrib_type) {
             case VertexAttribType::Position: {
                 CopyIndices(attrib_view.indices.data(), fbx_mesh->vertex_position.indices.data, fbx_mesh->vertex_position.indices.count);
-                ConvertVec3ToFloat(attrib_view.data.data(), fbx_mesh->vertex_position.values.data, fbx_mesh->vertex_position.values.count);
+                ConvertPositions(attrib_view.data.data(), &fbx_mesh->vertex_position.values.data->x,
+                    fbx_mesh->vertex_position.values.count, mesh_info);
                 break;
             }
             case VertexAttribType::Normal: {
@@ -92,22 +234,52 @@ static void ImportMesh(SceneStorage& storage, MeshInfo& mesh_info, ufbx_mesh* fb
                 current_color_idx++;
                 break;
             }
+            case VertexAttribType::Joints: {
+                // The index array is shared with the positions
+                joints_info = &attrib_info;
+                break;
+            }
+            case VertexAttribType::Weights: {
+                weights_info = &attrib_info;
+                break;
+            }
+            case VertexAttribType::Blendshape: {
+                // Never emitted, ImportBlendshapes fills the blendshape_infos
+                break;
+            }
         }
+        ZeroPadding(storage, attrib_info.index_offset + GetIndexSize(attrib_info) * attrib_info.index_count);
+        ZeroPadding(storage, attrib_info.value_offset + GetValueSize(attrib_info) * attrib_info.value_count);
+    }
+
+    if (joints_info && weights_info) {
+        ConvertSkinInfluences(fbx_mesh->skin_deformers[0], joints_info->num_value_per_index, joints_info->value_count,
+            (uint16_t*)(storage.data.data() + joints_info->value_offset),
+            (float*)(storage.data.data() + weights_info->value_offset));
     }
 
+    ImportBlendshapes(storage, mesh_info, fbx_mesh);
+
 }
 
-void ImportMeshes(FbxContext& context) {
-    SceneStorage& storage = context.storage;
+static void IndexMeshes(FbxContext& context) {
     for (uint32_t i = 0; i < context.scene->meshes.count; ++i) {
-        ufbx_mesh* fbx_mesh = context.scene->meshes[i];
-        MeshInfo& mesh_info = storage.mesh_infos[i];
-        ImportMesh(storage, mesh_info, fbx_mesh);
-            
-        context.mesh_to_index[fbx_mesh] = i;
+        context.mesh_to_index[context.scene->meshes[i]] = i;
     }
 }
 
+void ImportMeshes(FbxContext& context) {
+    SceneStorage& storage = context.storage;
+    const ufbx_scene* scene = context.scene;
+
+    // Every mesh writes only to its own region of the data laid out by AllocateSceneData
+    ParallelFor(scene->meshes.count, context.options.num_threads, [&](size_t i) {
+        ImportMesh(storage, storage.mesh_infos[i], scene->meshes[i]);
+    });
+
+    IndexMeshes(context);
+}
+
 void ImportNodes(FbxContext& context) {
     auto node_list = context.scene->nodes;
     
@@ -139,12 +311,7 @@ void ImportNodes(FbxContext& context) {
             node.parent = UINT32_MAX;
         }
         
-        // Copy transform matrix from FBX node element-wise from double to float
-        // Using local_transform as the fundamental transformation
-        const ufbx_real* src_matrix = &fbx_node->local_transform.translation.x;
-        for (uint32_t j = 0; j < 16; j++) {
-            node.transform[j] = static_cast<float>(src_matrix[j]);
-        }
+        CopyMatrix(fbx_node->node_to_parent, node.transform);
         
         // Set mesh index - find associated mesh in the mesh_to_index map
         if (fbx_node->mesh) {
@@ -162,120 +329,463 @@ void ImportNodes(FbxContext& context) {
     }
 }
 
+// Bind pose of the joints of every skinned mesh, joint i is cluster i of its skin deformer
+void ImportSkins(FbxContext& context) {
+    SceneStorage& storage = context.storage;
+    const ufbx_scene* scene = context.scene;
+    ParallelFor(scene->meshes.count, context.options.num_threads, [&](size_t mesh_idx) {
+        const MeshInfo& mesh_info = storage.mesh_infos[mesh_idx];
+        if (mesh_info.joint_info_count == 0) {
+            return;
+        }
+        const ufbx_skin_deformer* skin = scene->meshes[mesh_idx]->skin_deformers[0];
+        for (uint32_t j = 0; j < mesh_info.joint_info_count; ++j) {
+            const ufbx_skin_cluster* cluster = skin->clusters.data[j];
+            JointInfo& joint_info = storage.joint_infos[mesh_info.joint_info_start_index + j];
+            auto it = cluster->bone_node ? context.node_to_index.find(cluster->bone_node) : context.node_to_index.end();
+            joint_info.node_index = it != context.node_to_index.end() ? (uint32_t)it->second : UINT32_MAX;
+            CopyMatrix(cluster->geometry_to_bone, joint_info.inverse_bind_matrix);
+        }
+    });
+}
+
+// Offsets are computed in 64 bit and narrowed to DataOffset once the total size is known to fit
 template<typename T>
-static uint32_t AllocateAttribute(SceneStorage& storage, T& vertex_attrib_data,
-    uint32_t current_offset, uint32_t attrib_index, VertexAttribType attrib_type,
+static uint64_t AllocateAttribute(SceneStorage& storage, T& vertex_attrib_data,
+    uint64_t current_offset, uint32_t attrib_index, VertexAttribType attrib_type,
     uint32_t num_value_per_index) {
     AttributeInfo& attrib_info = storage.attrib_infos[attrib_index];
     attrib_info.attrib_type = attrib_type;
     
-    attrib_info.index_offset = align_up(current_offset, 16);
+    uint64_t index_offset = align_up(current_offset, 16);
+    attrib_info.index_offset = (DataOffset)index_offset;
     attrib_info.index_count = vertex_attrib_data.indices.count;
     attrib_info.num_value_per_index = num_value_per_index;
 
-    current_offset = attrib_info.index_offset + attrib_info.index_count * sizeof(uint32_t);
-    attrib_info.value_offset = align_up(current_offset, 16);
+    current_offset = index_offset + uint64_t(attrib_info.index_count) * sizeof(uint32_t);
+    uint64_t value_offset = align_up(current_offset, 16);
+    attrib_info.value_offset = (DataOffset)value_offset;
     attrib_info.value_count = vertex_attrib_data.values.count;
     
-    current_offset = attrib_info.value_offset + attrib_info.value_count * sizeof(float) * attrib_info.num_value_per_index;
+    current_offset = value_offset + uint64_t(attrib_info.value_count) * sizeof(float) * attrib_info.num_value_per_index;
     return current_offset;
 }
 
-void AllocateSceneData(FbxContext& context) {
+// Skin attributes hold one value per control point like the positions and share their
+// index array. `positions` is the Position record of the mesh, already laid out.
+static uint64_t AllocateSkinAttribute(SceneStorage& storage, const AttributeInfo& positions,
+    uint64_t current_offset, uint32_t attrib_index, VertexAttribType attrib_type,
+    uint32_t num_value_per_index, ValueEncoding value_encoding) {
+    AttributeInfo& attrib_info = storage.attrib_infos[attrib_index];
+    attrib_info.attrib_type = attrib_type;
+    attrib_info.index_offset = positions.index_offset;
+    attrib_info.index_count = positions.index_count;
+    attrib_info.num_value_per_index = num_value_per_index;
+    attrib_info.value_encoding = value_encoding;
+
+    uint64_t value_offset = align_up(current_offset, 16);
+    attrib_info.value_offset = (DataOffset)value_offset;
+    attrib_info.value_count = positions.value_count;
+    return value_offset + uint64_t(attrib_info.value_count) * GetValueSize(attrib_info);
+}
+
+static uint32_t CountAttributes(const ufbx_mesh* fbx_mesh, uint32_t max_joint_influences) {
+    uint32_t attrib_count = 0;
+    attrib_count += fbx_mesh->vertex_position.exists ? 1 : 0;
+    attrib_count += fbx_mesh->vertex_normal.exists ? 1 : 0;
+    attrib_count += fbx_mesh->vertex_tangent.exists ? 1 : 0;
+    attrib_count += fbx_mesh->vertex_bitangent.exists ? 1 : 0;
+    attrib_count += fbx_mesh->uv_sets.count;
+    attrib_count += fbx_mesh->color_sets.count;
+    attrib_count += GetSkin(fbx_mesh, max_joint_influences) ? 2 : 0;
+    return attrib_count;
+}
+
+// Lays out the faces and attributes of one mesh starting at offset 0 and returns the
+// size of the block. Every mesh block starts on a 16 byte boundary, so the aligned
+// offsets computed here stay aligned once the block is moved to its final base.
+static uint64_t LayoutMesh(SceneStorage& storage, MeshInfo& mesh_info, ufbx_mesh* fbx_mesh,
+    uint32_t max_joint_influences) {
+    uint64_t current_offset = 0;
+    mesh_info.face_offset = 0;
+    mesh_info.face_count = fbx_mesh->faces.count;
+    current_offset = uint64_t(mesh_info.face_count) * sizeof(ufbx_face);
+
+    // Fill up each attribute
+    uint32_t attrib_idx = mesh_info.attrib_info_start_index;
+    // Position attribute
+    if (fbx_mesh->vertex_position.exists) {
+        current_offset = AllocateAttribute(storage, fbx_mesh->vertex_position, current_offset, 
+            attrib_idx, VertexAttribType::Position, 3);
+        attrib_idx++;
+    }
+    
+    // Normal attribute
+    if (fbx_mesh->vertex_normal.exists) {
+        current_offset = AllocateAttribute(storage, fbx_mesh->vertex_normal, current_offset, 
+            attrib_idx, VertexAttribType::Normal, 3);
+        attrib_idx++;
+    }
+    
+    // Tangent attribute
+    if (fbx_mesh->vertex_tangent.exists) {
+        current_offset = AllocateAttribute(storage, fbx_mesh->vertex_tangent, current_offset, 
+            attrib_idx, VertexAttribType::Tangent, 3);
+        attrib_idx++;
+    }
+    
+    // Bitangent attribute
+    if (fbx_mesh->vertex_bitangent.exists) {
+        current_offset = AllocateAttribute(storage, fbx_mesh->vertex_bitangent, current_offset, 
+            attrib_idx, VertexAttribType::BiTangent, 3);
+        attrib_idx++;
+    }
+    
+    // UV sets
+    for (uint32_t uv_idx = 0; uv_idx < fbx_mesh->uv_sets.count; ++uv_idx) {
+        current_offset = AllocateAttribute(storage, fbx_mesh->uv_sets[uv_idx].vertex_uv, current_offset, 
+            attrib_idx, VertexAttribType::TexCoord, 2);
+        attrib_idx++;
+    }
+    
+    // Color sets
+    for (uint32_t color_idx = 0; color_idx < fbx_mesh->color_sets.count; ++color_idx) {
+        current_offset = AllocateAttribute(storage, fbx_mesh->color_sets[color_idx].vertex_color, current_offset, 
+            attrib_idx, VertexAttribType::Color, 4);
+        attrib_idx++;
+    }
+
+    // Skin influences, the positions are the first attribute of the mesh
+    if (GetSkin(fbx_mesh, max_joint_influences)) {
+        const AttributeInfo& positions = storage.attrib_infos[mesh_info.attrib_info_start_index];
+        current_offset = AllocateSkinAttribute(storage, positions, current_offset,
+            attrib_idx, VertexAttribType::Joints, max_joint_influences, ValueEncoding::Uint16);
+        attrib_idx++;
+        current_offset = AllocateSkinAttribute(storage, positions, current_offset,
+            attrib_idx, VertexAttribType::Weights, max_joint_influences, ValueEncoding::Float32);
+        attrib_idx++;
+    }
+
+    // Sparse blend shapes, a mesh stores normal deltas for all its shapes when any has them
+    if (mesh_info.blendshape_count > 0) {
+        std::vector<const ufbx_blend_channel*> channels;
+        CollectBlendChannels(fbx_mesh, channels);
+        BlendshapeInfo* shapes = &storage.blendshape_infos[mesh_info.blendshape_start_index];
+        bool has_normals = false;
+        for (uint32_t s = 0; s < mesh_info.blendshape_count; ++s) {
+            const ufbx_blend_shape* shape = channels[s]->target_shape;
+            shapes[s].vertex_count = CountBlendOffsets(shape, fbx_mesh->vertex_position.values.count);
+            shapes[s].default_weight = static_cast<float>(channels[s]->weight);
+            has_normals = has_normals || (shape->num_offsets > 0 && shape->normal_offsets.count == shape->num_offsets);
+        }
+        current_offset = LayoutBlendshapes(shapes, mesh_info.blendshape_count, has_normals, current_offset);
+    }
+    return current_offset;
+}
+
+// Moves a mesh block laid out by LayoutMesh to its final base offset
+static void RebaseMesh(SceneStorage& storage, MeshInfo& mesh_info, DataOffset base_offset) {
+    mesh_info.face_offset += base_offset;
+    uint32_t attrib_end_index = mesh_info.attrib_info_start_index + mesh_info.attribute_info_count;
+    for (uint32_t attrib_idx = mesh_info.attrib_info_start_index; attrib_idx < attrib_end_index; ++attrib_idx) {
+        storage.attrib_infos[attrib_idx].index_offset += base_offset;
+        storage.attrib_infos[attrib_idx].value_offset += base_offset;
+    }
+    uint32_t blendshape_end_index = mesh_info.blendshape_start_index + mesh_info.blendshape_count;
+    for (uint32_t shape_idx = mesh_info.blendshape_start_index; shape_idx < blendshape_end_index; ++shape_idx) {
+        BlendshapeInfo& shape = storage.blendshape_infos[shape_idx];
+        shape.vertex_offset += base_offset;
+        shape.position_offset += base_offset;
+        shape.normal_offset += shape.has_normals ? base_offset : 0;
+    }
+}
+
+bool AllocateSceneData(FbxContext& context) {
     SceneStorage& storage = context.storage;
-    uint32_t current_offset = 0;
+    const ufbx_scene* scene = context.scene;
+    uint32_t num_threads = context.options.num_threads;
     
-    storage.nodes.resize(context.scene->nodes.count);
-    storage.mesh_infos.resize(context.scene->meshes.count);
+    uint32_t max_joint_influences = context.options.max_joint_influences;
+    
+    if (max_joint_influences > UINT8_MAX) {
+        context.error = "max_joint_influences is " + std::to_string(max_joint_influences) + ", at most 255 are supported";
+        return false;
+    }
+
+    storage.nodes.resize(scene->nodes.count);
+    storage.mesh_infos.resize(scene->meshes.count);
+
+    // Attribute, joint and blend shape records are stored mesh after mesh, prefix sum their counts
+    uint32_t attrib_info_count = 0;
+    uint32_t joint_info_count = 0;
+    uint32_t blendshape_count = 0;
+    std::vector<const ufbx_blend_channel*> channels;
     for (uint32_t mesh_idx = 0; mesh_idx < storage.mesh_infos.size(); ++mesh_idx) {
         MeshInfo& mesh_info = storage.mesh_infos[mesh_idx];
-        ufbx_mesh* fbx_mesh = context.scene->meshes[mesh_idx];
-        mesh_info.face_offset = align_up(current_offset, 16);
-        mesh_info.face_count = fbx_mesh->faces.count;
-        current_offset = mesh_info.face_offset + mesh_info.face_count * sizeof(ufbx_face);
-        
-        // Fill up attributes
-        uint32_t attrib_count = 0;
-        attrib_count += fbx_mesh->vertex_position.exists ? 1 : 0;
-        attrib_count += fbx_mesh->vertex_normal.exists ? 1 : 0;
-        attrib_count += fbx_mesh->vertex_tangent.exists ? 1 : 0;
-        attrib_count += fbx_mesh->vertex_bitangent.exists ? 1 : 0;
-        attrib_count += fbx_mesh->uv_sets.count;
-        attrib_count += fbx_mesh->color_sets.count;
-        
-        mesh_info.attribute_info_count = attrib_count;
-        mesh_info.attrib_info_start_index = storage.attrib_infos.size();
-        storage.attrib_infos.resize(storage.attrib_infos.size() + attrib_count);
-        // Fill up each attribute
-        uint32_t attrib_idx = mesh_info.attrib_info_start_index;
-        // Position attribute
-        if (fbx_mesh->vertex_position.exists) {
-            current_offset = AllocateAttribute(storage, fbx_mesh->vertex_position, current_offset, 
-                attrib_idx, VertexAttribType::Position, 3);
-            attrib_idx++;
-        }
-        
-        // Normal attribute
-        if (fbx_mesh->vertex_normal.exists) {
-            current_offset = AllocateAttribute(storage, fbx_mesh->vertex_normal, current_offset, 
-                attrib_idx, VertexAttribType::Normal, 3);
-            attrib_idx++;
-        }
-        
-        // Tangent attribute
-        if (fbx_mesh->vertex_tangent.exists) {
-            current_offset = AllocateAttribute(storage, fbx_mesh->vertex_tangent, current_offset, 
-                attrib_idx, VertexAttribType::Tangent, 3);
-            attrib_idx++;
-        }
-        
-        // Bitangent attribute
-        if (fbx_mesh->vertex_bitangent.exists) {
-            current_offset = AllocateAttribute(storage, fbx_mesh->vertex_bitangent, current_offset, 
-                attrib_idx, VertexAttribType::BiTangent, 3);
-            attrib_idx++;
-        }
-        
-        // UV sets
-        for (uint32_t uv_idx = 0; uv_idx < fbx_mesh->uv_sets.count; ++uv_idx) {
-            current_offset = AllocateAttribute(storage, fbx_mesh->uv_sets[uv_idx].vertex_uv, current_offset, 
-                attrib_idx, VertexAttribType::TexCoord, 2);
-            attrib_idx++;
-        }
-        
-        // Color sets
-        for (uint32_t color_idx = 0; color_idx < fbx_mesh->color_sets.count; ++color_idx) {
-            current_offset = AllocateAttribute(storage, fbx_mesh->color_sets[color_idx].vertex_color, current_offset, 
-                attrib_idx, VertexAttribType::Color, 4);
-            attrib_idx++;
+        mesh_info.attrib_info_start_index = attrib_info_count;
+        mesh_info.attribute_info_count = CountAttributes(scene->meshes[mesh_idx], max_joint_influences);
+        attrib_info_count += mesh_info.attribute_info_count;
+
+        const ufbx_skin_deformer* skin = GetSkin(scene->meshes[mesh_idx], max_joint_influences);
+        mesh_info.joint_info_start_index = joint_info_count;
+        mesh_info.joint_info_count = skin ? (uint32_t)skin->clusters.count : 0;
+        joint_info_count += mesh_info.joint_info_count;
+        if (skin && skin->clusters.count > kMaxSkinJoints) {
+            context.error = "mesh " + std::to_string(mesh_idx) + " has " + std::to_string(skin->clusters.count) +
+                " skin joints, more than uint16 joint indices can address";
+            return false;
         }
+
+        CollectBlendChannels(scene->meshes[mesh_idx], channels);
+        mesh_info.blendshape_start_index = blendshape_count;
+        mesh_info.blendshape_count = (uint32_t)channels.size();
+        blendshape_count += mesh_info.blendshape_count;
     }
+    storage.attrib_infos.resize(attrib_info_count);
+    storage.joint_infos.resize(joint_info_count);
+    storage.blendshape_infos.resize(blendshape_count);
+
+    // Size pass: lay out every mesh relative to its own block
+    std::vector<uint64_t> mesh_sizes(storage.mesh_infos.size());
+    ParallelFor(storage.mesh_infos.size(), num_threads, [&](size_t mesh_idx) {
+        mesh_sizes[mesh_idx] = LayoutMesh(storage, storage.mesh_infos[mesh_idx], scene->meshes[mesh_idx],
+            max_joint_influences);
+    });
+
+    // Prefix sum of the block sizes gives the same offsets as laying out the meshes one after another
+    std::vector<uint64_t> mesh_offsets(storage.mesh_infos.size());
+    uint64_t current_offset = 0;
+    for (uint32_t mesh_idx = 0; mesh_idx < storage.mesh_infos.size(); ++mesh_idx) {
+        mesh_offsets[mesh_idx] = align_up(current_offset, 16);
+        current_offset = mesh_offsets[mesh_idx] + mesh_sizes[mesh_idx];
+    }
+
+    if (!CheckDataOffset(current_offset, "scene data", &context.error)) {
+        return false;
+    }
+
+    ParallelFor(storage.mesh_infos.size(), num_threads, [&](size_t mesh_idx) {
+        RebaseMesh(storage, storage.mesh_infos[mesh_idx], (DataOffset)mesh_offsets[mesh_idx]);
+    });
+
+    // Left uninitialized, ImportMeshes writes every byte
+    storage.data = DataBuffer(context.options.allocator);
     storage.data.resize(current_offset);
+    return true;
+}
+
+// Bounds ImportMesh would compute, from the ufbx positions through a small float buffer
+static void ComputeMeshBounds(const ufbx_mesh* fbx_mesh, MeshInfo& mesh_info) {
+    InitBounds(mesh_info.bounds_min, mesh_info.bounds_max);
+    if (fbx_mesh->vertex_position.exists) {
+        constexpr size_t kChunk = 256;
+        float positions[3 * kChunk];
+        const ufbx_vec3_list& values = fbx_mesh->vertex_position.values;
+        for (size_t begin = 0; begin < values.count; begin += kChunk) {
+            size_t count = std::min(kChunk, values.count - begin);
+            ConvertRealsToFloat(positions, &values.data[begin].x, 3 * count);
+            ExpandBounds(positions, count, mesh_info.bounds_min, mesh_info.bounds_max);
+        }
+    }
+    ResetEmptyBounds(mesh_info.bounds_min, mesh_info.bounds_max);
 }
 
-void ImportScene(FbxContext& context) {
-    AllocateSceneData(context);
-    ImportMeshes(context);
+// Everything ImportScene does except converting the mesh data. The mesh bounds are still
+// computed so spatial queries work before any mesh is loaded, and the blob is zeroed so the
+// ranges of meshes not loaded yet never expose uninitialized memory.
+static bool ImportSceneLayout(FbxContext& context) {
+    if (!AllocateSceneData(context)) {
+        return false;
+    }
+    constexpr size_t kChunk = size_t(1) << 20;
+    uint8_t* data = context.storage.data.data();
+    size_t data_size = context.storage.data.size();
+    ParallelFor((data_size + kChunk - 1) / kChunk, context.options.num_threads, [&](size_t chunk) {
+        size_t begin = chunk * kChunk;
+        memset(data + begin, 0, std::min(kChunk, data_size - begin));
+    });
+    IndexMeshes(context);
+    ParallelFor(context.scene->meshes.count, context.options.num_threads, [&](size_t mesh_idx) {
+        ComputeMeshBounds(context.scene->meshes[mesh_idx], context.storage.mesh_infos[mesh_idx]);
+    });
     ImportNodes(context);
+    ImportSkins(context);
+    return true;
 }
 
+bool ImportScene(FbxContext& context) {
+    {
+        PhaseTimer timer(ImportPhase::Layout);
+        if (!AllocateSceneData(context)) {
+            return false;
+        }
+    }
+    {
+        PhaseTimer timer(ImportPhase::Meshes);
+        ImportMeshes(context);
+    }
+    {
+        PhaseTimer timer(ImportPhase::Nodes);
+        ImportNodes(context);
+    }
+    {
+        PhaseTimer timer(ImportPhase::Skins);
+        ImportSkins(context);
+    }
+    return true;
 }
 
-mesh2py::common::SceneStorage ImportFbx(const char* path) {
+// Memory ufbx holds for the parsed scene, and had in use while parsing it
+static uint64_t GetParserBytes(const ufbx_scene* scene, bool parsing) {
+    return scene->metadata.result_memory_used + (parsing ? scene->metadata.temp_memory_used : 0);
+}
+
+}
+
+namespace mesh2py::fbx {
+
+// Parses the scene with `load(load_opts, fbx_error)`, then imports and post imports it
+template <class LoadFn>
+static bool ImportLoadedScene(const LoadFn& load, const ImportOptions& options, SceneStorage& storage,
+    std::string* error) {
+    ImportStatsScope stats_scope(options.stats);
     ufbx_load_opts load_opts = {};
-    ufbx_error error = {};
+    ufbx_error fbx_error = {};
     
-    ufbx_scene* scene = ufbx_load_file(path, &load_opts, &error);
+    ufbx_scene* scene = nullptr;
+    {
+        PhaseTimer timer(ImportPhase::Parse);
+        scene = load(load_opts, fbx_error);
+    }
     if (!scene) {
-        printf("Error %s/n", error.description.data);
-        return {};
+        if (error) {
+            *error = std::string(fbx_error.description.data, fbx_error.description.length);
+        }
+        return false;
     }
+    RecordAllocatedBytes(GetParserBytes(scene, true));
+    // Freed even when a stage throws, e.g. std::bad_alloc from a full arena allocator
+    std::unique_ptr<ufbx_scene, decltype(&ufbx_free_scene)> scene_guard(scene, &ufbx_free_scene);
     
-    mesh2py::fbx::FbxContext context;
+    FbxContext context;
     context.scene = scene;
-    mesh2py::fbx::ImportScene(context);
+    context.options = options;
+    bool imported = ImportScene(context);
+    RecordAllocatedBytes(GetParserBytes(scene, false) + context.storage.data.size());
+
+    scene_guard.reset();
+    if (!imported) {
+        if (error) {
+            *error = std::move(context.error);
+        }
+        return false;
+    }
+    if (options.stats) {
+        CountImportedData(context.storage, *options.stats);
+    }
+
+    return RunPostImport(context.storage, options, storage, error);
+}
+
+}
+
+bool ImportFbx(const char* path, const mesh2py::common::ImportOptions& options,
+    mesh2py::common::SceneStorage& storage, std::string* error) {
+    auto load = [path](const ufbx_load_opts& load_opts, ufbx_error& fbx_error) {
+        return ufbx_load_file(path, &load_opts, &fbx_error);
+    };
+    return mesh2py::fbx::ImportLoadedScene(load, options, storage, error);
+}
 
-    ufbx_free_scene(scene);
+bool ImportFbxFromMemory(const void* data, size_t size, const mesh2py::common::ImportOptions& options,
+    mesh2py::common::SceneStorage& storage, std::string* error) {
+    auto load = [data, size](const ufbx_load_opts& load_opts, ufbx_error& fbx_error) {
+        return ufbx_load_memory(data, size, &load_opts, &fbx_error);
+    };
+    return mesh2py::fbx::ImportLoadedScene(load, options, storage, error);
+}
+
+mesh2py::common::SceneStorage ImportFbx(const char* path, const mesh2py::common::ImportOptions& options) {
+    mesh2py::common::SceneStorage storage;
+    std::string error;
+    if (!ImportFbx(path, options, storage, &error)) {
+        printf("Error %s\n", error.c_str());
+        return {};
+    }
+    return storage;
+}
 
-    return context.storage;
-}
\ No newline at end of file
+namespace mesh2py::fbx {
+
+LazyFbxScene::~LazyFbxScene() {
+    ufbx_free_scene(m_scene);
+}
+
+std::unique_ptr<LazyFbxScene> LazyFbxScene::Open(const char* path, const ImportOptions& options, std::string* error) {
+    if (options.optimize_meshes || !options.lod_levels.empty() || options.build_meshlets ||
+        options.quantize_attributes || options.deduplicate || options.stats) {
+        if (error) {
+            *error = "lazy scenes do not run the post import stages or collect stats";
+        }
+        return nullptr;
+    }
+
+    ufbx_load_opts load_opts = {};
+    ufbx_error fbx_error = {};
+
+    ufbx_scene* scene = ufbx_load_file(path, &load_opts, &fbx_error);
+    if (!scene) {
+        if (error) {
+            *error = std::string(fbx_error.description.data, fbx_error.description.length);
+        }
+        return nullptr;
+    }
+
+    FbxContext context;
+    context.scene = scene;
+    context.options = options;
+    if (!ImportSceneLayout(context)) {
+        ufbx_free_scene(scene);
+        if (error) {
+            *error = std::move(context.error);
+        }
+        return nullptr;
+    }
+
+    std::unique_ptr<LazyFbxScene> lazy_scene(new LazyFbxScene());
+    lazy_scene->m_scene = scene;
+    lazy_scene->m_storage = std::move(context.storage);
+    lazy_scene->m_options = options;
+    lazy_scene->m_mesh_once.reset(new std::once_flag[scene->meshes.count]);
+    lazy_scene->m_mesh_loaded.reset(new std::atomic<bool>[scene->meshes.count]);
+    for (size_t i = 0; i < scene->meshes.count; ++i) {
+        lazy_scene->m_mesh_loaded[i].store(false, std::memory_order_relaxed);
+    }
+    return lazy_scene;
+}
+
+void LazyFbxScene::LoadMesh(uint32_t mesh_index) {
+    std::call_once(m_mesh_once[mesh_index], [&]() {
+        ImportMesh(m_storage, m_storage.mesh_infos[mesh_index], m_scene->meshes[mesh_index]);
+        m_mesh_loaded[mesh_index].store(true, std::memory_order_release);
+    });
+}
+
+bool LazyFbxScene::IsMeshLoaded(uint32_t mesh_index) const {
+    return m_mesh_loaded[mesh_index].load(std::memory_order_acquire);
+}
+
+void LazyFbxScene::LoadAllMeshes() {
+    ParallelFor(m_storage.mesh_infos.size(), m_options.num_threads, [&](size_t mesh_index) {
+        LoadMesh((uint32_t)mesh_index);
+    });
+}
+
+uint32_t LazyFbxScene::GetAttributeMesh(uint32_t attrib_index) const {
+    // Attribute records are stored mesh after mesh
+    auto it = std::upper_bound(m_storage.mesh_infos.begin(), m_storage.mesh_infos.end(), attrib_index,
+        [](uint32_t index, const MeshInfo& mesh_info) { return index < mesh_info.attrib_info_start_index; });
+    return uint32_t(it - m_storage.mesh_infos.begin()) - 1;
+}
+
+}
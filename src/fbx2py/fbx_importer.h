@@ -1,8 +1,90 @@
 #pragma once
 
+#include <common/import_options.h>
 #include <common/scene_data.h>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <ufbx.h>
 
-mesh2py::common::SceneStorage ImportFbx(const char* path);
\ No newline at end of file
+// Imports `path` into `storage`. On failure returns false and stores the reason in `error`
+// (when not null) instead of printing it.
+bool ImportFbx(const char* path, const mesh2py::common::ImportOptions& options,
+    mesh2py::common::SceneStorage& storage, std::string* error);
+
+// Imports an FBX file held in memory, such as an asset fetched from object storage, without
+// writing it to disk. ufbx parses `data` in place, it is only read during the call. Same
+// results and errors as the path overload.
+bool ImportFbxFromMemory(const void* data, size_t size, const mesh2py::common::ImportOptions& options,
+    mesh2py::common::SceneStorage& storage, std::string* error);
+
+// Prints errors and returns an empty storage on failure
+mesh2py::common::SceneStorage ImportFbx(const char* path, const mesh2py::common::ImportOptions& options = {});
+
+namespace mesh2py::fbx {
+
+// State of one import, shared by the stages below
+struct FbxContext {
+    const ufbx_scene* scene;
+    std::unordered_map<ufbx_node*, int> node_to_index;
+    std::unordered_map<ufbx_mesh*, int> mesh_to_index;
+    mesh2py::common::SceneStorage storage;
+    mesh2py::common::ImportOptions options;
+    // Set when an import stage fails
+    std::string error;
+};
+
+// The stages ImportScene runs in order, exposed for tests and benchmarks. AllocateSceneData
+// fills the mesh and attribute records and allocates the data blob, returning false with
+// context.error set on failure. ImportMeshes converts the mesh data, ImportNodes fills the
+// nodes and needs the mesh indices ImportMeshes records, ImportSkins fills the joints.
+bool AllocateSceneData(FbxContext& context);
+void ImportMeshes(FbxContext& context);
+void ImportNodes(FbxContext& context);
+void ImportSkins(FbxContext& context);
+
+// Imports context.scene into context.storage without the post import stages
+bool ImportScene(FbxContext& context);
+
+// Keeps the parsed ufbx scene alive and converts the faces and attributes of a mesh into the
+// storage on first access. Nodes, mesh and attribute records, including the mesh bounds, are
+// filled when the scene is opened, so a BVH can be built before any mesh is loaded. The data
+// blob is allocated and zeroed up front, so the ranges of meshes not loaded yet read as zeros.
+class LazyFbxScene {
+public:
+    ~LazyFbxScene();
+    LazyFbxScene(const LazyFbxScene&) = delete;
+    LazyFbxScene& operator=(const LazyFbxScene&) = delete;
+
+    // Returns nullptr and fills `error` (when not null) on failure. Only num_threads, allocator
+    // and max_joint_influences apply: lazy scenes never run the post import stages, so options
+    // asking for them or for stats are rejected.
+    static std::unique_ptr<LazyFbxScene> Open(const char* path, const mesh2py::common::ImportOptions& options,
+        std::string* error);
+
+    // Face and attribute data of meshes not loaded yet are zero
+    mesh2py::common::SceneStorage& storage() { return m_storage; }
+
+    // Converts the mesh on the first call. Safe to call from several threads.
+    void LoadMesh(uint32_t mesh_index);
+    bool IsMeshLoaded(uint32_t mesh_index) const;
+    // Converts every mesh not loaded yet on options.num_threads workers
+    void LoadAllMeshes();
+
+    // Index of the mesh owning an attribute record
+    uint32_t GetAttributeMesh(uint32_t attrib_index) const;
+
+private:
+    LazyFbxScene() = default;
+
+    ufbx_scene* m_scene = nullptr;
+    mesh2py::common::SceneStorage m_storage;
+    mesh2py::common::ImportOptions m_options;
+    std::unique_ptr<std::once_flag[]> m_mesh_once;
+    std::unique_ptr<std::atomic<bool>[]> m_mesh_loaded;
+};
+
+}
@@ -0,0 +1,1308 @@
+#include "gltf_importer.h"
+
+#include <common/convert.h>
+#include <common/import_stats.h>
+#include <common/mapped_file.h>
+#include <common/post_import.h>
+#include <common/thread_pool.h>
+
+// Images are not imported, keep tinygltf from decoding or even opening them
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#include <tiny_gltf.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+namespace mesh2py::gltf {
+    using namespace mesh2py::common;
+
+    // glTF primitive imported as one MeshInfo
+    struct PrimitiveRef {
+        uint32_t mesh;
+        uint32_t primitive;
+    };
+
+    // JOINTS_n and WEIGHTS_n accessors of a skinned primitive ordered by set, merged into its
+    // single Joints and Weights attributes
+    struct SkinSources {
+        std::vector<int> joints;
+        std::vector<int> weights;
+    };
+
+    // Joint indices are stored as uint16
+    constexpr size_t kMaxSkinJoints = 65536;
+
+    struct GltfContext {
+        const tinygltf::Model* model;
+        // Bytes of every glTF buffer, indexed like model->buffers
+        std::vector<std::span<const uint8_t>> buffers;
+        // mesh_infos[i] is imported from primitives[i]
+        std::vector<PrimitiveRef> primitives;
+        // MeshInfo index of the first primitive of every glTF mesh
+        std::vector<uint32_t> mesh_first_primitive;
+        // Offset of the index array shared by all attributes of a primitive
+        std::vector<DataOffset> primitive_index_offsets;
+        // Accessor read into every attrib_infos entry
+        std::vector<int> attrib_accessors;
+        // Skin of every glTF mesh, the one of the first node that draws it skinned, -1 for none
+        std::vector<int> mesh_skins;
+        // Joint records of every skin, empty for skins no mesh uses
+        std::vector<std::vector<JointInfo>> skin_joints;
+        // Skin influences of every primitive, empty when it is not skinned
+        std::vector<SkinSources> primitive_skins;
+        // GLB file mapped at the start of the data blob. Accessors already in the stored form
+        // are referenced in place, everything else is written from tail_offset on.
+        const uint8_t* mapped_file = nullptr;
+        size_t mapped_size = 0;
+        uint64_t tail_offset = 0;
+        SceneStorage storage;
+        ImportOptions options;
+        // Set when an import stage fails
+        std::string error;
+    };
+
+    // Accessor resolved to buffer memory
+    struct AccessorData {
+        // nullptr when the accessor has no buffer view, its elements are zeros
+        const uint8_t* data;
+        size_t stride;
+        size_t count;
+        int component_type;
+        uint32_t components;
+        bool normalized;
+    };
+
+    // Glues a glTF attribute semantic to its storage record
+    struct AttributeSource {
+        VertexAttribType type;
+        uint32_t set;
+        uint8_t num_value_per_index;
+        int accessor;
+    };
+
+// Points `data` at `count` elements of `element_size` bytes, `stride` apart, in a buffer view
+static bool ResolveView(const GltfContext& context, int view_index, size_t byte_offset, size_t stride,
+    size_t element_size, size_t count, const uint8_t*& data) {
+    const tinygltf::Model& model = *context.model;
+    if (view_index < 0 || (size_t)view_index >= model.bufferViews.size()) {
+        return false;
+    }
+    const tinygltf::BufferView& view = model.bufferViews[view_index];
+    if (view.buffer < 0 || (size_t)view.buffer >= context.buffers.size()) {
+        return false;
+    }
+    std::span<const uint8_t> buffer = context.buffers[view.buffer];
+    if (view.byteOffset > buffer.size() || view.byteLength > buffer.size() - view.byteOffset) {
+        return false;
+    }
+    if (count > 0) {
+        uint64_t extent = (uint64_t)byte_offset + (uint64_t)(count - 1) * stride + element_size;
+        if (extent > view.byteLength) {
+            return false;
+        }
+    }
+    data = buffer.data() + view.byteOffset + byte_offset;
+    return true;
+}
+
+static bool ResolveAccessor(const GltfContext& context, int accessor_index, AccessorData& out) {
+    const tinygltf::Model& model = *context.model;
+    if (accessor_index < 0 || (size_t)accessor_index >= model.accessors.size()) {
+        return false;
+    }
+    const tinygltf::Accessor& accessor = model.accessors[accessor_index];
+    int component_size = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+    int components = tinygltf::GetNumComponentsInType(accessor.type);
+    if (component_size <= 0 || components <= 0 || accessor.componentType == TINYGLTF_COMPONENT_TYPE_DOUBLE) {
+        return false;
+    }
+    size_t element_size = (size_t)component_size * components;
+
+    out.data = nullptr;
+    out.stride = element_size;
+    out.count = accessor.count;
+    out.component_type = accessor.componentType;
+    out.components = (uint32_t)components;
+    out.normalized = accessor.normalized;
+    if (accessor.bufferView < 0) {
+        return true;
+    }
+    if ((size_t)accessor.bufferView >= model.bufferViews.size()) {
+        return false;
+    }
+    const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+    if (view.byteStride != 0) {
+        out.stride = view.byteStride;
+    }
+    return ResolveView(context, accessor.bufferView, accessor.byteOffset, out.stride, element_size,
+        out.count, out.data);
+}
+
+// Points at the sparse index and value arrays, both tightly packed
+static bool ResolveSparse(const GltfContext& context, const tinygltf::Accessor& accessor,
+    const uint8_t*& indices, const uint8_t*& values) {
+    const auto& sparse = accessor.sparse;
+    int index_size = tinygltf::GetComponentSizeInBytes(sparse.indices.componentType);
+    int component_size = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+    int components = tinygltf::GetNumComponentsInType(accessor.type);
+    if (sparse.count < 0 || index_size <= 0 || component_size <= 0 || components <= 0 ||
+        sparse.indices.componentType == TINYGLTF_COMPONENT_TYPE_DOUBLE) {
+        return false;
+    }
+    size_t value_size = (size_t)component_size * components;
+    return ResolveView(context, sparse.indices.bufferView, sparse.indices.byteOffset, index_size, index_size,
+               sparse.count, indices) &&
+        ResolveView(context, sparse.values.bufferView, sparse.values.byteOffset, value_size, value_size,
+               sparse.count, values);
+}
+
+template <class T>
+static T ReadUnaligned(const uint8_t* ptr) {
+    T value;
+    memcpy(&value, ptr, sizeof(T));
+    return value;
+}
+
+static uint32_t ReadIndex(const uint8_t* ptr, int component_type) {
+    switch (component_type) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        return *ptr;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        return ReadUnaligned<uint16_t>(ptr);
+    default:
+        return ReadUnaligned<uint32_t>(ptr);
+    }
+}
+
+// Reads `count` elements as floats with `dst_components` floats each. Normalized integers are
+// mapped to [0, 1] or [-1, 1], missing components are 0 except the fourth which is 1.
+template <class T>
+static void ReadElements(float* dst, uint32_t dst_components, const uint8_t* src, size_t stride, size_t count,
+    uint32_t src_components, bool normalized) {
+    float scale = 1.0f;
+    if constexpr (std::is_integral_v<T>) {
+        if (normalized) {
+            scale = 1.0f / float(std::numeric_limits<T>::max());
+        }
+    }
+    uint32_t read_components = std::min(src_components, dst_components);
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* element = src + i * stride;
+        float* out = dst + i * dst_components;
+        for (uint32_t c = 0; c < read_components; ++c) {
+            float value = float(ReadUnaligned<T>(element + c * sizeof(T))) * scale;
+            if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+                value = normalized ? std::max(value, -1.0f) : value;
+            }
+            out[c] = value;
+        }
+        for (uint32_t c = read_components; c < dst_components; ++c) {
+            out[c] = c == 3 ? 1.0f : 0.0f;
+        }
+    }
+}
+
+static void ReadElements(float* dst, uint32_t dst_components, const uint8_t* src, size_t stride, size_t count,
+    uint32_t src_components, int component_type, bool normalized) {
+    switch (component_type) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+        ReadElements<int8_t>(dst, dst_components, src, stride, count, src_components, normalized);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        ReadElements<uint8_t>(dst, dst_components, src, stride, count, src_components, normalized);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+        ReadElements<int16_t>(dst, dst_components, src, stride, count, src_components, normalized);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        ReadElements<uint16_t>(dst, dst_components, src, stride, count, src_components, normalized);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_INT:
+        ReadElements<int32_t>(dst, dst_components, src, stride, count, src_components, normalized);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        ReadElements<uint32_t>(dst, dst_components, src, stride, count, src_components, normalized);
+        break;
+    default:
+        ReadElements<float>(dst, dst_components, src, stride, count, src_components, normalized);
+        break;
+    }
+}
+
+// Tightly packed float accessors of the stored width are copied straight into the storage
+static void ReadFloats(float* dst, uint32_t dst_components, const AccessorData& src) {
+    if (src.data == nullptr) {
+        static const uint8_t zeros[16] = {};
+        ReadElements(dst, dst_components, zeros, 0, src.count, src.components, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, false);
+        return;
+    }
+    if (src.component_type == TINYGLTF_COMPONENT_TYPE_FLOAT && src.components == dst_components &&
+        src.stride == sizeof(float) * dst_components) {
+        memcpy(dst, src.data, src.count * src.stride);
+        return;
+    }
+    ReadElements(dst, dst_components, src.data, src.stride, src.count, src.components, src.component_type, src.normalized);
+}
+
+static void ApplySparse(const GltfContext& context, float* dst, uint32_t dst_components, int accessor_index) {
+    const tinygltf::Accessor& accessor = context.model->accessors[accessor_index];
+    if (!accessor.sparse.isSparse) {
+        return;
+    }
+    const uint8_t* indices = nullptr;
+    const uint8_t* values = nullptr;
+    ResolveSparse(context, accessor, indices, values);
+
+    int index_size = tinygltf::GetComponentSizeInBytes(accessor.sparse.indices.componentType);
+    size_t value_size = (size_t)tinygltf::GetComponentSizeInBytes(accessor.componentType) *
+        tinygltf::GetNumComponentsInType(accessor.type);
+    uint32_t components = (uint32_t)tinygltf::GetNumComponentsInType(accessor.type);
+    for (int i = 0; i < accessor.sparse.count; ++i) {
+        uint32_t index = ReadIndex(indices + (size_t)i * index_size, accessor.sparse.indices.componentType);
+        // Validated during layout
+        ReadElements(dst + (size_t)index * dst_components, dst_components, values + i * value_size, value_size, 1,
+            components, accessor.componentType, accessor.normalized);
+    }
+}
+
+static bool ValidateSparse(const GltfContext& context, int accessor_index) {
+    const tinygltf::Accessor& accessor = context.model->accessors[accessor_index];
+    if (!accessor.sparse.isSparse) {
+        return true;
+    }
+    const uint8_t* indices = nullptr;
+    const uint8_t* values = nullptr;
+    if (!ResolveSparse(context, accessor, indices, values)) {
+        return false;
+    }
+    int index_size = tinygltf::GetComponentSizeInBytes(accessor.sparse.indices.componentType);
+    for (int i = 0; i < accessor.sparse.count; ++i) {
+        if (ReadIndex(indices + (size_t)i * index_size, accessor.sparse.indices.componentType) >= accessor.count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int GetPrimitiveMode(const tinygltf::Primitive& primitive) {
+    // tinygltf reports a missing mode as -1, glTF defaults to triangles
+    return primitive.mode < 0 ? TINYGLTF_MODE_TRIANGLES : primitive.mode;
+}
+
+// Corners per imported face, strips, fans and loops are unrolled into lists
+static uint32_t GetFaceSize(int mode) {
+    switch (mode) {
+    case TINYGLTF_MODE_POINTS:
+        return 1;
+    case TINYGLTF_MODE_LINE:
+    case TINYGLTF_MODE_LINE_LOOP:
+    case TINYGLTF_MODE_LINE_STRIP:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+static size_t GetCornerCount(int mode, size_t count) {
+    switch (mode) {
+    case TINYGLTF_MODE_POINTS:
+        return count;
+    case TINYGLTF_MODE_LINE:
+        return count - count % 2;
+    case TINYGLTF_MODE_LINE_LOOP:
+        return count >= 2 ? 2 * count : 0;
+    case TINYGLTF_MODE_LINE_STRIP:
+        return count >= 2 ? 2 * (count - 1) : 0;
+    case TINYGLTF_MODE_TRIANGLE_STRIP:
+    case TINYGLTF_MODE_TRIANGLE_FAN:
+        return count >= 3 ? 3 * (count - 2) : 0;
+    default:
+        return count - count % 3;
+    }
+}
+
+static bool IsListMode(int mode) {
+    return mode == TINYGLTF_MODE_POINTS || mode == TINYGLTF_MODE_LINE || mode == TINYGLTF_MODE_TRIANGLES;
+}
+
+// Unrolls strips, fans and loops following the glTF primitive rules
+static void UnrollCorners(uint32_t* dst, int mode, const uint32_t* src, size_t count) {
+    switch (mode) {
+    case TINYGLTF_MODE_LINE_LOOP:
+        for (size_t i = 0; i < count; ++i) {
+            *dst++ = src[i];
+            *dst++ = src[(i + 1) % count];
+        }
+        break;
+    case TINYGLTF_MODE_LINE_STRIP:
+        for (size_t i = 0; i + 1 < count; ++i) {
+            *dst++ = src[i];
+            *dst++ = src[i + 1];
+        }
+        break;
+    case TINYGLTF_MODE_TRIANGLE_STRIP:
+        for (size_t i = 0; i + 2 < count; ++i) {
+            *dst++ = src[i];
+            *dst++ = src[i + 1 + i % 2];
+            *dst++ = src[i + 2 - i % 2];
+        }
+        break;
+    case TINYGLTF_MODE_TRIANGLE_FAN:
+        for (size_t i = 0; i + 2 < count; ++i) {
+            *dst++ = src[i + 1];
+            *dst++ = src[i + 2];
+            *dst++ = src[0];
+        }
+        break;
+    }
+}
+
+// Tightly packed uint32 indices are copied straight into the storage
+static void ReadIndices(uint32_t* dst, const AccessorData& src, size_t count) {
+    if (src.data == nullptr) {
+        memset(dst, 0, count * sizeof(uint32_t));
+    } else if (src.component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT && src.stride == sizeof(uint32_t)) {
+        memcpy(dst, src.data, count * sizeof(uint32_t));
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = ReadIndex(src.data + i * src.stride, src.component_type);
+        }
+    }
+}
+
+// Writes the corners of a primitive from its indices, or from 0..count-1 when it has none
+static void WriteCorners(uint32_t* corners, int mode, const AccessorData* indices, size_t source_count,
+    size_t corner_count) {
+    if (IsListMode(mode)) {
+        if (indices) {
+            ReadIndices(corners, *indices, corner_count);
+        } else {
+            for (size_t i = 0; i < corner_count; ++i) {
+                corners[i] = (uint32_t)i;
+            }
+        }
+    } else if (corner_count > 0) {
+        std::vector<uint32_t> source(source_count);
+        if (indices) {
+            ReadIndices(source.data(), *indices, source_count);
+        } else {
+            for (size_t i = 0; i < source_count; ++i) {
+                source[i] = (uint32_t)i;
+            }
+        }
+        UnrollCorners(corners, mode, source.data(), source_count);
+    }
+}
+
+// Offset of accessor bytes in the mapped file when they are stored as they are: tightly
+// packed `components` of `component_type`, 4 byte aligned
+static bool GetMappedOffset(const GltfContext& context, const AccessorData& src, int component_type,
+    uint32_t components, uint64_t& offset) {
+    if (context.mapped_file == nullptr || src.data < context.mapped_file ||
+        src.data >= context.mapped_file + context.mapped_size || src.component_type != component_type ||
+        src.components != components || src.stride != sizeof(uint32_t) * components) {
+        return false;
+    }
+    offset = (uint64_t)(src.data - context.mapped_file);
+    return offset % sizeof(uint32_t) == 0;
+}
+
+// Maps "POSITION", "TEXCOORD_1", ... to the stored attribute, custom semantics are skipped
+static bool ParseSemantic(const std::string& name, AttributeSource& source) {
+    struct Semantic {
+        const char* prefix;
+        VertexAttribType type;
+        uint8_t num_value_per_index;
+        bool has_set;
+    };
+    static const Semantic semantics[] = {
+        { "POSITION", VertexAttribType::Position, 3, false },
+        { "NORMAL", VertexAttribType::Normal, 3, false },
+        { "TANGENT", VertexAttribType::Tangent, 4, false },
+        { "TEXCOORD_", VertexAttribType::TexCoord, 2, true },
+        { "COLOR_", VertexAttribType::Color, 4, true },
+        { "JOINTS_", VertexAttribType::Joints, 4, true },
+        { "WEIGHTS_", VertexAttribType::Weights, 4, true },
+    };
+    for (const Semantic& semantic : semantics) {
+        size_t length = strlen(semantic.prefix);
+        if (name.compare(0, length, semantic.prefix) != 0) {
+            continue;
+        }
+        if (semantic.has_set) {
+            const char* digits = name.c_str() + length;
+            char* end = nullptr;
+            unsigned long set = strtoul(digits, &end, 10);
+            if (end == digits || *end != '\0') {
+                return false;
+            }
+            source.set = (uint32_t)set;
+        } else if (name.size() != length) {
+            return false;
+        } else {
+            source.set = 0;
+        }
+        source.type = semantic.type;
+        source.num_value_per_index = semantic.num_value_per_index;
+        return true;
+    }
+    return false;
+}
+
+// Same order as the FBX importer: by attribute type, then by set. JOINTS_n and WEIGHTS_n go to
+// `skin` instead, ordered by set.
+static void CollectAttributes(const tinygltf::Primitive& primitive, std::vector<AttributeSource>& sources,
+    SkinSources& skin) {
+    sources.clear();
+    std::vector<AttributeSource> influences;
+    for (const auto& [name, accessor] : primitive.attributes) {
+        AttributeSource source = {};
+        if (ParseSemantic(name, source)) {
+            source.accessor = accessor;
+            bool influence = source.type == VertexAttribType::Joints || source.type == VertexAttribType::Weights;
+            (influence ? influences : sources).push_back(source);
+        }
+    }
+    auto by_type_and_set = [](const AttributeSource& a, const AttributeSource& b) {
+        if (a.type != b.type) {
+            return (uint32_t)a.type < (uint32_t)b.type;
+        }
+        return a.set < b.set;
+    };
+    std::sort(sources.begin(), sources.end(), by_type_and_set);
+    std::sort(influences.begin(), influences.end(), by_type_and_set);
+
+    skin = {};
+    for (const AttributeSource& source : influences) {
+        (source.type == VertexAttribType::Joints ? skin.joints : skin.weights).push_back(source.accessor);
+    }
+}
+
+// Validates one JOINTS_n or WEIGHTS_n accessor of a primitive with `vertex_count` vertices
+static bool ValidateInfluences(const GltfContext& context, int accessor_index, bool joints, size_t vertex_count) {
+    AccessorData values;
+    if (!ResolveAccessor(context, accessor_index, values) || !ValidateSparse(context, accessor_index) ||
+        values.components != 4 || values.count != vertex_count) {
+        return false;
+    }
+    if (joints) {
+        return values.component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ||
+            values.component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+    }
+    return values.component_type == TINYGLTF_COMPONENT_TYPE_FLOAT || values.normalized;
+}
+
+// Number of vertices a non indexed primitive draws
+static size_t GetVertexCount(const tinygltf::Model& model, const tinygltf::Primitive& primitive) {
+    auto position = primitive.attributes.find("POSITION");
+    int accessor = position != primitive.attributes.end() ? position->second
+        : primitive.attributes.empty() ? -1 : primitive.attributes.begin()->second;
+    if (accessor < 0 || (size_t)accessor >= model.accessors.size()) {
+        return 0;
+    }
+    return model.accessors[accessor].count;
+}
+
+static size_t GetSourceCount(const GltfContext& context, const tinygltf::Primitive& primitive) {
+    if (primitive.indices >= 0) {
+        return context.model->accessors[primitive.indices].count;
+    }
+    return GetVertexCount(*context.model, primitive);
+}
+
+// Places the faces, the shared index array and the attribute values of a primitive at
+// `current_offset`. Returns the end offset or 0 with context.error set.
+static uint64_t LayoutPrimitive(GltfContext& context, uint32_t mesh_info_index, uint64_t current_offset,
+    std::vector<AttributeSource>& sources) {
+    SceneStorage& storage = context.storage;
+    const PrimitiveRef& ref = context.primitives[mesh_info_index];
+    const tinygltf::Primitive& primitive = context.model->meshes[ref.mesh].primitives[ref.primitive];
+    MeshInfo& mesh_info = storage.mesh_infos[mesh_info_index];
+
+    AccessorData indices = {};
+    if (primitive.indices >= 0) {
+        if (!ResolveAccessor(context, primitive.indices, indices) || indices.components != 1 ||
+            indices.component_type == TINYGLTF_COMPONENT_TYPE_FLOAT ||
+            context.model->accessors[primitive.indices].sparse.isSparse) {
+            context.error = "invalid index accessor in mesh " + std::to_string(ref.mesh);
+            return 0;
+        }
+    }
+
+    int mode = GetPrimitiveMode(primitive);
+    if (mode > TINYGLTF_MODE_TRIANGLE_FAN) {
+        context.error = "unknown primitive mode in mesh " + std::to_string(ref.mesh);
+        return 0;
+    }
+    size_t source_count = GetSourceCount(context, primitive);
+    size_t corner_count = GetCornerCount(mode, source_count);
+    uint32_t face_size = GetFaceSize(mode);
+    if (corner_count > UINT32_MAX) {
+        context.error = "too many indices in mesh " + std::to_string(ref.mesh);
+        return 0;
+    }
+
+    current_offset = align_up(current_offset, 16);
+    mesh_info.face_offset = (DataOffset)current_offset;
+    mesh_info.face_count = (uint32_t)(corner_count / face_size);
+    current_offset += (uint64_t)mesh_info.face_count * sizeof(Face);
+
+    uint64_t mapped_offset = 0;
+    if (primitive.indices >= 0 && IsListMode(mode) && corner_count == source_count &&
+        GetMappedOffset(context, indices, TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, 1, mapped_offset)) {
+        context.primitive_index_offsets[mesh_info_index] = (DataOffset)mapped_offset;
+    } else {
+        current_offset = align_up(current_offset, 16);
+        context.primitive_index_offsets[mesh_info_index] = (DataOffset)current_offset;
+        current_offset += (uint64_t)corner_count * sizeof(uint32_t);
+    }
+    DataOffset index_offset = context.primitive_index_offsets[mesh_info_index];
+
+    // Skinned primitives get one Joints and one Weights attribute of max_joint_influences
+    // values, like the FBX importer, and their own copy of the joint records of the skin
+    SkinSources& skin = context.primitive_skins[mesh_info_index];
+    CollectAttributes(primitive, sources, skin);
+    int skin_index = context.mesh_skins[ref.mesh];
+    if (skin_index < 0 || skin.joints.empty()) {
+        skin = {};
+    } else {
+        size_t vertex_count = GetVertexCount(*context.model, primitive);
+        bool valid = skin.joints.size() == skin.weights.size();
+        for (size_t i = 0; valid && i < skin.joints.size(); ++i) {
+            valid = ValidateInfluences(context, skin.joints[i], true, vertex_count) &&
+                ValidateInfluences(context, skin.weights[i], false, vertex_count);
+        }
+        if (!valid) {
+            context.error = "invalid JOINTS or WEIGHTS accessors in mesh " + std::to_string(ref.mesh);
+            return 0;
+        }
+        uint8_t width = (uint8_t)context.options.max_joint_influences;
+        sources.push_back({ VertexAttribType::Joints, 0, width, skin.joints[0] });
+        sources.push_back({ VertexAttribType::Weights, 0, width, skin.weights[0] });
+
+        const std::vector<JointInfo>& joints = context.skin_joints[skin_index];
+        mesh_info.joint_info_start_index = (uint32_t)storage.joint_infos.size();
+        mesh_info.joint_info_count = (uint32_t)joints.size();
+        storage.joint_infos.insert(storage.joint_infos.end(), joints.begin(), joints.end());
+    }
+
+    mesh_info.attrib_info_start_index = (uint32_t)storage.attrib_infos.size();
+    mesh_info.attribute_info_count = (uint32_t)sources.size();
+    for (const AttributeSource& source : sources) {
+        AccessorData values;
+        if (!ResolveAccessor(context, source.accessor, values) || !ValidateSparse(context, source.accessor) ||
+            values.count > UINT32_MAX) {
+            context.error = "invalid attribute accessor in mesh " + std::to_string(ref.mesh);
+            return 0;
+        }
+        // The attributes share the index array, every one needs a value per vertex
+        if (storage.attrib_infos.size() > mesh_info.attrib_info_start_index &&
+            values.count != storage.attrib_infos[mesh_info.attrib_info_start_index].value_count) {
+            context.error = "attribute accessors of different counts in mesh " + std::to_string(ref.mesh);
+            return 0;
+        }
+
+        bool influence = source.type == VertexAttribType::Joints || source.type == VertexAttribType::Weights;
+        AttributeInfo attrib_info = {};
+        attrib_info.index_offset = index_offset;
+        attrib_info.attrib_type = source.type;
+        attrib_info.index_count = (uint32_t)corner_count;
+        attrib_info.value_count = (uint32_t)values.count;
+        attrib_info.num_value_per_index = source.num_value_per_index;
+        attrib_info.value_encoding = source.type == VertexAttribType::Joints ? ValueEncoding::Uint16 : ValueEncoding::Float32;
+        // Influences are always converted, every set is merged into the top max_joint_influences
+        if (!influence && !context.model->accessors[source.accessor].sparse.isSparse &&
+            GetMappedOffset(context, values, TINYGLTF_COMPONENT_TYPE_FLOAT, source.num_value_per_index, mapped_offset)) {
+            attrib_info.value_offset = (DataOffset)mapped_offset;
+        } else {
+            current_offset = align_up(current_offset, 16);
+            attrib_info.value_offset = (DataOffset)current_offset;
+            current_offset += (uint64_t)values.count * GetValueSize(attrib_info);
+        }
+
+        storage.attrib_infos.push_back(attrib_info);
+        context.attrib_accessors.push_back(source.accessor);
+    }
+    return current_offset;
+}
+
+// Column major matrices of the inverseBindMatrices accessor of a skin, identity without one
+static bool ReadInverseBindMatrices(const GltfContext& context, const tinygltf::Skin& skin, std::vector<float>& matrices) {
+    static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    if (skin.inverseBindMatrices < 0) {
+        matrices.resize(skin.joints.size() * 16);
+        for (size_t j = 0; j < skin.joints.size(); ++j) {
+            memcpy(matrices.data() + j * 16, identity, sizeof(identity));
+        }
+        return true;
+    }
+    AccessorData values;
+    if (!ResolveAccessor(context, skin.inverseBindMatrices, values) || !ValidateSparse(context, skin.inverseBindMatrices) ||
+        values.component_type != TINYGLTF_COMPONENT_TYPE_FLOAT || values.components != 16 ||
+        values.count < skin.joints.size()) {
+        return false;
+    }
+    matrices.resize(values.count * 16);
+    ReadFloats(matrices.data(), 16, values);
+    ApplySparse(context, matrices.data(), 16, skin.inverseBindMatrices);
+    return true;
+}
+
+// Picks the skin of every mesh and builds the joint records of the skins in use. A glTF skin
+// belongs to a node, the first node drawing a mesh with a skin decides the skin of the mesh.
+static bool LayoutSkins(GltfContext& context) {
+    const tinygltf::Model& model = *context.model;
+    uint32_t max_joint_influences = context.options.max_joint_influences;
+    context.mesh_skins.assign(model.meshes.size(), -1);
+    context.skin_joints.resize(model.skins.size());
+    if (max_joint_influences == 0) {
+        return true;
+    }
+    if (max_joint_influences > UINT8_MAX) {
+        context.error = "max_joint_influences is " + std::to_string(max_joint_influences) + ", at most 255 are supported";
+        return false;
+    }
+
+    std::vector<float> matrices;
+    for (size_t n = 0; n < model.nodes.size(); ++n) {
+        const tinygltf::Node& node = model.nodes[n];
+        if (node.skin < 0 || node.mesh < 0 || (size_t)node.mesh >= model.meshes.size() ||
+            context.mesh_skins[node.mesh] >= 0) {
+            continue;
+        }
+        if ((size_t)node.skin >= model.skins.size()) {
+            context.error = "invalid skin in node " + std::to_string(n);
+            return false;
+        }
+        context.mesh_skins[node.mesh] = node.skin;
+        std::vector<JointInfo>& joints = context.skin_joints[node.skin];
+        const tinygltf::Skin& skin = model.skins[node.skin];
+        if (!joints.empty() || skin.joints.empty()) {
+            continue;
+        }
+        if (skin.joints.size() > kMaxSkinJoints) {
+            context.error = "skin " + std::to_string(node.skin) + " has " + std::to_string(skin.joints.size()) +
+                " joints, more than uint16 joint indices can address";
+            return false;
+        }
+        if (!ReadInverseBindMatrices(context, skin, matrices)) {
+            context.error = "invalid inverseBindMatrices in skin " + std::to_string(node.skin);
+            return false;
+        }
+        joints.resize(skin.joints.size());
+        for (size_t j = 0; j < skin.joints.size(); ++j) {
+            if (skin.joints[j] < 0 || (size_t)skin.joints[j] >= model.nodes.size()) {
+                context.error = "invalid joint in skin " + std::to_string(node.skin);
+                return false;
+            }
+            // Nodes keep their glTF index
+            joints[j].node_index = (uint32_t)skin.joints[j];
+            memcpy(joints[j].inverse_bind_matrix, matrices.data() + j * 16, sizeof(joints[j].inverse_bind_matrix));
+        }
+    }
+    return true;
+}
+
+// Lays out every primitive and returns the size of the data blob in `data_size`
+static bool LayoutScene(GltfContext& context, uint64_t& data_size) {
+    SceneStorage& storage = context.storage;
+    const tinygltf::Model& model = *context.model;
+
+    context.mesh_first_primitive.resize(model.meshes.size());
+    for (size_t m = 0; m < model.meshes.size(); ++m) {
+        context.mesh_first_primitive[m] = (uint32_t)context.primitives.size();
+        for (size_t p = 0; p < model.meshes[m].primitives.size(); ++p) {
+            context.primitives.push_back({ (uint32_t)m, (uint32_t)p });
+        }
+    }
+    storage.mesh_infos.resize(context.primitives.size());
+    context.primitive_index_offsets.resize(context.primitives.size());
+    context.primitive_skins.resize(context.primitives.size());
+    if (!LayoutSkins(context)) {
+        return false;
+    }
+
+    // Accessor headers are tiny, the layout is a single serial pass
+    uint64_t current_offset = context.tail_offset;
+    std::vector<AttributeSource> sources;
+    for (uint32_t i = 0; i < (uint32_t)context.primitives.size(); ++i) {
+        current_offset = LayoutPrimitive(context, i, current_offset, sources);
+        if (!context.error.empty()) {
+            return false;
+        }
+    }
+    if (!CheckDataOffset(current_offset, "scene data", &context.error)) {
+        return false;
+    }
+    data_size = current_offset;
+    return true;
+}
+
+bool AllocateSceneData(GltfContext& context) {
+    uint64_t data_size = 0;
+    if (!LayoutScene(context, data_size)) {
+        return false;
+    }
+    context.storage.data = DataBuffer(context.options.allocator);
+    context.storage.data.resize(data_size);
+    return true;
+}
+
+// Merges every JOINTS_n and WEIGHTS_n set of a primitive into the `width` largest influences of
+// each vertex, renormalized to sum to 1 like the FBX skins. Unused slots get joint 0 with
+// weight 0, influences without weight or naming a joint outside the skin are dropped.
+static void ConvertSkinInfluences(const GltfContext& context, const SkinSources& skin, uint32_t joint_count,
+    uint32_t width, size_t vertex_count, uint16_t* joints, float* weights) {
+    struct Influence {
+        uint32_t joint;
+        float weight;
+    };
+    size_t set_count = skin.joints.size();
+    std::vector<float> set_joints(set_count * vertex_count * 4);
+    std::vector<float> set_weights(set_count * vertex_count * 4);
+    for (size_t s = 0; s < set_count; ++s) {
+        AccessorData values;
+        float* dst = set_joints.data() + s * vertex_count * 4;
+        ResolveAccessor(context, skin.joints[s], values);
+        ReadFloats(dst, 4, values);
+        ApplySparse(context, dst, 4, skin.joints[s]);
+        dst = set_weights.data() + s * vertex_count * 4;
+        ResolveAccessor(context, skin.weights[s], values);
+        ReadFloats(dst, 4, values);
+        ApplySparse(context, dst, 4, skin.weights[s]);
+    }
+
+    std::vector<Influence> influences;
+    for (size_t v = 0; v < vertex_count; ++v) {
+        uint16_t* vertex_joints = joints + v * width;
+        float* vertex_weights = weights + v * width;
+        std::fill_n(vertex_joints, width, uint16_t(0));
+        std::fill_n(vertex_weights, width, 0.0f);
+
+        influences.clear();
+        for (size_t s = 0; s < set_count; ++s) {
+            for (size_t c = 0; c < 4; ++c) {
+                size_t element = (s * vertex_count + v) * 4 + c;
+                uint32_t joint = (uint32_t)set_joints[element];
+                if (set_weights[element] > 0.0f && joint < joint_count) {
+                    influences.push_back({ joint, set_weights[element] });
+                }
+            }
+        }
+        size_t kept = std::min<size_t>(width, influences.size());
+        std::partial_sort(influences.begin(), influences.begin() + kept, influences.end(),
+            [](const Influence& a, const Influence& b) { return a.weight > b.weight; });
+
+        double total = 0.0;
+        for (size_t i = 0; i < kept; ++i) {
+            total += influences[i].weight;
+        }
+        for (size_t i = 0; i < kept; ++i) {
+            vertex_joints[i] = (uint16_t)influences[i].joint;
+            vertex_weights[i] = total > 0.0 ? float(influences[i].weight / total) : 0.0f;
+        }
+    }
+}
+
+// True when every index of a primitive addresses a value of its attributes
+static bool ValidateIndices(const SceneStorage& storage, const MeshInfo& mesh_info, DataOffset index_offset,
+    size_t corner_count) {
+    if (mesh_info.attribute_info_count == 0) {
+        return true;
+    }
+    uint32_t vertex_count = storage.attrib_infos[mesh_info.attrib_info_start_index].value_count;
+    const uint32_t* indices = (const uint32_t*)(storage.data.data() + index_offset);
+    for (size_t i = 0; i < corner_count; ++i) {
+        if (indices[i] >= vertex_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns false when an index of the primitive is out of range
+static bool ImportPrimitive(GltfContext& context, uint32_t mesh_info_index) {
+    SceneStorage& storage = context.storage;
+    const PrimitiveRef& ref = context.primitives[mesh_info_index];
+    const tinygltf::Primitive& primitive = context.model->meshes[ref.mesh].primitives[ref.primitive];
+    MeshInfo& mesh_info = storage.mesh_infos[mesh_info_index];
+
+    int mode = GetPrimitiveMode(primitive);
+    uint32_t face_size = GetFaceSize(mode);
+    size_t source_count = GetSourceCount(context, primitive);
+    size_t corner_count = GetCornerCount(mode, source_count);
+
+    FaceView view = GetFaceView(storage, mesh_info);
+    for (uint32_t i = 0; i < mesh_info.face_count; ++i) {
+        view.faces[i] = { i * face_size, face_size };
+    }
+    ZeroPadding(storage, mesh_info.face_offset + sizeof(Face) * mesh_info.face_count);
+
+    // Regions before the tail are referenced in place in the mapped file
+    DataOffset index_offset = context.primitive_index_offsets[mesh_info_index];
+    if (index_offset >= context.tail_offset) {
+        AccessorData indices = {};
+        if (primitive.indices >= 0) {
+            ResolveAccessor(context, primitive.indices, indices);
+        }
+        uint32_t* corners = (uint32_t*)(storage.data.data() + index_offset);
+        WriteCorners(corners, mode, primitive.indices >= 0 ? &indices : nullptr, source_count, corner_count);
+        ZeroPadding(storage, index_offset + sizeof(uint32_t) * corner_count);
+    }
+    // Checked before anything reads the values through them, mapped indices in place
+    if (!ValidateIndices(storage, mesh_info, index_offset, corner_count)) {
+        return false;
+    }
+
+    InitBounds(mesh_info.bounds_min, mesh_info.bounds_max);
+    const AttributeInfo* joints_info = nullptr;
+    const AttributeInfo* weights_info = nullptr;
+    for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+        uint32_t attrib_index = mesh_info.attrib_info_start_index + a;
+        AttributeInfo& attrib_info = storage.attrib_infos[attrib_index];
+        // Joints and weights are filled together once both are known
+        if (attrib_info.attrib_type == VertexAttribType::Joints) {
+            joints_info = &attrib_info;
+            continue;
+        }
+        if (attrib_info.attrib_type == VertexAttribType::Weights) {
+            weights_info = &attrib_info;
+            continue;
+        }
+        float* dst = (float*)(storage.data.data() + attrib_info.value_offset);
+        if (attrib_info.value_offset >= context.tail_offset) {
+            int accessor = context.attrib_accessors[attrib_index];
+            AccessorData values;
+            ResolveAccessor(context, accessor, values);
+            ReadFloats(dst, attrib_info.num_value_per_index, values);
+            ApplySparse(context, dst, attrib_info.num_value_per_index, accessor);
+            ZeroPadding(storage, attrib_info.value_offset +
+                sizeof(float) * attrib_info.value_count * attrib_info.num_value_per_index);
+        }
+        // Bounded right after the copy while the positions are still in cache, or in place in
+        // the mapped file
+        if (attrib_info.attrib_type == VertexAttribType::Position) {
+            ExpandBounds(dst, attrib_info.value_count, mesh_info.bounds_min, mesh_info.bounds_max);
+        }
+    }
+    ResetEmptyBounds(mesh_info.bounds_min, mesh_info.bounds_max);
+
+    if (joints_info && weights_info) {
+        uint16_t* joints = (uint16_t*)(storage.data.data() + joints_info->value_offset);
+        float* weights = (float*)(storage.data.data() + weights_info->value_offset);
+        ConvertSkinInfluences(context, context.primitive_skins[mesh_info_index], mesh_info.joint_info_count,
+            joints_info->num_value_per_index, joints_info->value_count, joints, weights);
+        ZeroPadding(storage, joints_info->value_offset + (size_t)joints_info->value_count * GetValueSize(*joints_info));
+        ZeroPadding(storage, weights_info->value_offset + (size_t)weights_info->value_count * GetValueSize(*weights_info));
+    }
+    return true;
+}
+
+// Primitives write disjoint regions of the data, they decode in parallel
+static bool ImportMeshes(GltfContext& context) {
+    std::vector<uint8_t> valid(context.primitives.size());
+    ParallelFor(context.primitives.size(), context.options.num_threads, [&](size_t i) {
+        valid[i] = ImportPrimitive(context, (uint32_t)i);
+    });
+    for (size_t i = 0; i < valid.size(); ++i) {
+        if (!valid[i]) {
+            context.error = "index out of range in mesh " + std::to_string(context.primitives[i].mesh);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Column major T * R * S
+static void ComposeTransform(const tinygltf::Node& node, float* m) {
+    double t[3] = { 0.0, 0.0, 0.0 };
+    double r[4] = { 0.0, 0.0, 0.0, 1.0 };
+    double s[3] = { 1.0, 1.0, 1.0 };
+    std::copy_n(node.translation.begin(), std::min<size_t>(node.translation.size(), 3), t);
+    std::copy_n(node.rotation.begin(), std::min<size_t>(node.rotation.size(), 4), r);
+    std::copy_n(node.scale.begin(), std::min<size_t>(node.scale.size(), 3), s);
+
+    double x = r[0], y = r[1], z = r[2], w = r[3];
+    m[0] = float((1.0 - 2.0 * (y * y + z * z)) * s[0]);
+    m[1] = float((2.0 * (x * y + z * w)) * s[0]);
+    m[2] = float((2.0 * (x * z - y * w)) * s[0]);
+    m[3] = 0.0f;
+    m[4] = float((2.0 * (x * y - z * w)) * s[1]);
+    m[5] = float((1.0 - 2.0 * (x * x + z * z)) * s[1]);
+    m[6] = float((2.0 * (y * z + x * w)) * s[1]);
+    m[7] = 0.0f;
+    m[8] = float((2.0 * (x * z + y * w)) * s[2]);
+    m[9] = float((2.0 * (y * z - x * w)) * s[2]);
+    m[10] = float((1.0 - 2.0 * (x * x + y * y)) * s[2]);
+    m[11] = 0.0f;
+    m[12] = float(t[0]);
+    m[13] = float(t[1]);
+    m[14] = float(t[2]);
+    m[15] = 1.0f;
+}
+
+// Nodes keep their glTF index. A mesh with several primitives is referenced from the first one,
+// the others hang off the node as identity children appended after the glTF nodes.
+bool ImportNodes(GltfContext& context) {
+    SceneStorage& storage = context.storage;
+    const tinygltf::Model& model = *context.model;
+    static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+    storage.nodes.resize(model.nodes.size());
+    for (Node& node : storage.nodes) {
+        node.parent = UINT32_MAX;
+    }
+    for (size_t n = 0; n < model.nodes.size(); ++n) {
+        const tinygltf::Node& gltf_node = model.nodes[n];
+        for (int child : gltf_node.children) {
+            if (child < 0 || (size_t)child >= model.nodes.size()) {
+                context.error = "invalid child of node " + std::to_string(n);
+                return false;
+            }
+            storage.nodes[child].parent = (uint32_t)n;
+        }
+    }
+
+    for (size_t n = 0; n < model.nodes.size(); ++n) {
+        const tinygltf::Node& gltf_node = model.nodes[n];
+        if (gltf_node.matrix.size() == 16) {
+            for (int i = 0; i < 16; ++i) {
+                storage.nodes[n].transform[i] = float(gltf_node.matrix[i]);
+            }
+        } else {
+            ComposeTransform(gltf_node, storage.nodes[n].transform);
+        }
+
+        storage.nodes[n].mesh_index = UINT32_MAX;
+        if (gltf_node.mesh < 0) {
+            continue;
+        }
+        if ((size_t)gltf_node.mesh >= model.meshes.size()) {
+            context.error = "invalid mesh in node " + std::to_string(n);
+            return false;
+        }
+        uint32_t first = context.mesh_first_primitive[gltf_node.mesh];
+        uint32_t count = (uint32_t)model.meshes[gltf_node.mesh].primitives.size();
+        if (count > 0) {
+            storage.nodes[n].mesh_index = first;
+        }
+        for (uint32_t p = 1; p < count; ++p) {
+            Node node = {};
+            node.parent = (uint32_t)n;
+            memcpy(node.transform, identity, sizeof(identity));
+            node.mesh_index = first + p;
+            storage.nodes.push_back(node);
+        }
+    }
+    return true;
+}
+
+bool ImportScene(GltfContext& context) {
+    {
+        PhaseTimer timer(ImportPhase::Layout);
+        if (!AllocateSceneData(context)) {
+            return false;
+        }
+    }
+    {
+        PhaseTimer timer(ImportPhase::Nodes);
+        if (!ImportNodes(context)) {
+            return false;
+        }
+    }
+    PhaseTimer timer(ImportPhase::Meshes);
+    return ImportMeshes(context);
+}
+
+// Bytes of the buffers tinygltf loaded
+static uint64_t GetParserBytes(const tinygltf::Model& model) {
+    uint64_t size = 0;
+    for (const tinygltf::Buffer& buffer : model.buffers) {
+        size += buffer.data.size();
+    }
+    return size;
+}
+
+constexpr uint32_t kGlbMagic = 0x46546C67;     // "glTF"
+constexpr uint32_t kGlbChunkJson = 0x4E4F534A; // "JSON"
+constexpr uint32_t kGlbChunkBin = 0x004E4942;  // "BIN\0"
+
+// Locates the JSON chunk and the optional BIN chunk of a GLB file
+static bool ParseGlb(const uint8_t* file, size_t size, std::string_view& json, std::span<const uint8_t>& bin) {
+    uint32_t header[3];
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(header, file, sizeof(header));
+    if (header[0] != kGlbMagic || header[1] != 2 || header[2] > size) {
+        return false;
+    }
+    size_t length = header[2];
+    size_t offset = sizeof(header);
+    bool has_json = false;
+    while (length - offset >= 8) {
+        uint32_t chunk[2];
+        memcpy(chunk, file + offset, sizeof(chunk));
+        offset += sizeof(chunk);
+        if (chunk[0] > length - offset) {
+            return false;
+        }
+        if (chunk[1] == kGlbChunkJson && !has_json) {
+            json = std::string_view((const char*)file + offset, chunk[0]);
+            has_json = true;
+        } else if (chunk[1] == kGlbChunkBin && has_json && bin.empty()) {
+            bin = std::span<const uint8_t>(file + offset, chunk[0]);
+        }
+        offset = std::min(length, offset + align_up((size_t)chunk[0], 4));
+    }
+    return has_json;
+}
+
+// tinygltf copies the BIN chunk into its model. The buffer backed by the chunk gets a one
+// byte data URI instead, the importer reads the chunk from the mapping.
+static std::string DetachBinChunk(std::string_view json_text, bool& detached) {
+    detached = false;
+    nlohmann::json json = nlohmann::json::parse(json_text.begin(), json_text.end(), nullptr, false);
+    if (json.is_discarded()) {
+        // Left for tinygltf to report
+        return std::string(json_text);
+    }
+    auto buffers = json.find("buffers");
+    if (buffers != json.end() && buffers->is_array() && !buffers->empty() && (*buffers)[0].is_object() &&
+        !(*buffers)[0].contains("uri")) {
+        (*buffers)[0]["uri"] = "data:application/octet-stream;base64,AA==";
+        (*buffers)[0]["byteLength"] = 1;
+        detached = true;
+    }
+    return json.dump();
+}
+
+// ImportScene for a GLB mapped with `file`. The file is mapped again at the start of the data
+// blob with room for the converted data behind it.
+bool ImportMappedScene(GltfContext& context, const char* path, std::shared_ptr<MappedFileAllocator> file) {
+    context.mapped_file = file->base();
+    context.mapped_size = file->length();
+    context.tail_offset = align_up((uint64_t)file->length(), kMappedTailAlignment);
+
+    uint64_t data_size = 0;
+    PhaseTimer layout_timer(ImportPhase::Layout);
+    if (!LayoutScene(context, data_size)) {
+        return false;
+    }
+    size_t tail_size = data_size - context.tail_offset;
+    std::shared_ptr<MappedFileAllocator> mapping = tail_size ? MapFile(path, tail_size) : file;
+    if (mapping) {
+        if (mapping->length() != (tail_size ? data_size : file->length())) {
+            context.error = std::string(path) + " changed while importing";
+            return false;
+        }
+        context.storage.data.adopt(mapping, mapping->base(), mapping->length());
+    } else {
+        // No tail support on this platform, copy the file into a heap blob instead
+        context.storage.data = DataBuffer(context.options.allocator);
+        context.storage.data.resize(data_size);
+        memcpy(context.storage.data.data(), file->base(), file->length());
+        memset(context.storage.data.data() + file->length(), 0, context.tail_offset - file->length());
+    }
+    layout_timer.Stop();
+
+    {
+        PhaseTimer timer(ImportPhase::Nodes);
+        if (!ImportNodes(context)) {
+            return false;
+        }
+    }
+    PhaseTimer timer(ImportPhase::Meshes);
+    return ImportMeshes(context);
+}
+
+static bool SkipImage(tinygltf::Image*, const int, std::string*, std::string*, int, int,
+    const unsigned char*, int, void*) {
+    return true;
+}
+
+// Imports a parsed model and runs the post import stages. `bin`, when not null, is the GLB
+// BIN chunk that replaces buffer 0 detached by DetachBinChunk.
+static bool ImportModel(const tinygltf::Model& model, const std::span<const uint8_t>* bin,
+    const ImportOptions& options, SceneStorage& storage, std::string* error) {
+    GltfContext context;
+    context.model = &model;
+    context.options = options;
+    for (size_t i = 0; i < model.buffers.size(); ++i) {
+        const std::vector<unsigned char>& data = model.buffers[i].data;
+        context.buffers.push_back(i == 0 && bin ? *bin : std::span<const uint8_t>(data.data(), data.size()));
+    }
+    if (!ImportScene(context)) {
+        if (error) {
+            *error = std::move(context.error);
+        }
+        return false;
+    }
+    RecordAllocatedBytes(GetParserBytes(model) + context.storage.data.size());
+    if (options.stats) {
+        CountImportedData(context.storage, *options.stats);
+    }
+    return RunPostImport(context.storage, options, storage, error);
+}
+
+static bool IsBinaryPath(const char* path) {
+    size_t length = strlen(path);
+    if (length < 4) {
+        return false;
+    }
+    const char* extension = path + length - 4;
+    return extension[0] == '.' && tolower(extension[1]) == 'g' && tolower(extension[2]) == 'l' &&
+        tolower(extension[3]) == 'b';
+}
+
+}
+
+bool ImportGltf(const char* path, const mesh2py::common::ImportOptions& options,
+    mesh2py::common::SceneStorage& storage, std::string* error) {
+    using namespace mesh2py::common;
+    ImportStatsScope stats_scope(options.stats);
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(mesh2py::gltf::SkipImage, nullptr);
+
+    std::string gltf_error;
+    std::string gltf_warning;
+    bool loaded = false;
+    {
+        PhaseTimer timer(ImportPhase::Parse);
+        loaded = mesh2py::gltf::IsBinaryPath(path)
+            ? loader.LoadBinaryFromFile(&model, &gltf_error, &gltf_warning, path)
+            : loader.LoadASCIIFromFile(&model, &gltf_error, &gltf_warning, path);
+    }
+    if (!loaded) {
+        if (error) {
+            *error = gltf_error.empty() ? "failed to load " + std::string(path) : gltf_error;
+        }
+        return false;
+    }
+
+    return mesh2py::gltf::ImportModel(model, nullptr, options, storage, error);
+}
+
+bool ImportGltfFromMemory(const void* data, size_t size, const char* base_dir,
+    const mesh2py::common::ImportOptions& options, mesh2py::common::SceneStorage& storage, std::string* error) {
+    using namespace mesh2py::common;
+    ImportStatsScope stats_scope(options.stats);
+    PhaseTimer parse_timer(ImportPhase::Parse);
+
+    // GLB files have their BIN chunk read in place like ImportGlbMapped, .gltf text is parsed
+    // straight from the buffer
+    std::string_view json((const char*)data, size);
+    std::span<const uint8_t> bin;
+    bool detached = false;
+    std::string json_text;
+    if (size >= 4 && memcmp(data, "glTF", 4) == 0) {
+        if (!mesh2py::gltf::ParseGlb((const uint8_t*)data, size, json, bin)) {
+            if (error) {
+                *error = "buffer is not a valid GLB file";
+            }
+            return false;
+        }
+        json_text = mesh2py::gltf::DetachBinChunk(json, detached);
+        json = json_text;
+    }
+    if (json.size() > UINT32_MAX) {
+        if (error) {
+            *error = "glTF JSON of " + std::to_string(json.size()) + " bytes is larger than tinygltf can parse";
+        }
+        return false;
+    }
+
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(mesh2py::gltf::SkipImage, nullptr);
+    std::string gltf_error;
+    std::string gltf_warning;
+    if (!loader.LoadASCIIFromString(&model, &gltf_error, &gltf_warning, json.data(), (unsigned int)json.size(),
+            base_dir ? base_dir : "")) {
+        if (error) {
+            *error = gltf_error.empty() ? "failed to load glTF from memory" : gltf_error;
+        }
+        return false;
+    }
+    parse_timer.Stop();
+
+    return mesh2py::gltf::ImportModel(model, detached ? &bin : nullptr, options, storage, error);
+}
+
+bool ImportGlbMapped(const char* path, const mesh2py::common::ImportOptions& options,
+    mesh2py::common::SceneStorage& storage, std::string* error) {
+    using namespace mesh2py::common;
+    ImportStatsScope stats_scope(options.stats);
+    PhaseTimer parse_timer(ImportPhase::Parse);
+    std::shared_ptr<MappedFileAllocator> file = MapFile(path);
+    std::string_view json;
+    std::span<const uint8_t> bin;
+    if (!file || !mesh2py::gltf::ParseGlb(file->base(), file->length(), json, bin)) {
+        if (error) {
+            *error = std::string(path) + (file ? " is not a GLB file" : " could not be mapped");
+        }
+        return false;
+    }
+
+    bool detached = false;
+    std::string json_text = mesh2py::gltf::DetachBinChunk(json, detached);
+    std::string base_dir = path;
+    size_t separator = base_dir.find_last_of("/\\");
+    base_dir = separator == std::string::npos ? std::string() : base_dir.substr(0, separator);
+
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(mesh2py::gltf::SkipImage, nullptr);
+    std::string gltf_error;
+    std::string gltf_warning;
+    if (!loader.LoadASCIIFromString(&model, &gltf_error, &gltf_warning, json_text.c_str(),
+            (unsigned int)json_text.size(), base_dir)) {
+        if (error) {
+            *error = gltf_error.empty() ? "failed to load " + std::string(path) : gltf_error;
+        }
+        return false;
+    }
+    parse_timer.Stop();
+
+    mesh2py::gltf::GltfContext context;
+    context.model = &model;
+    context.options = options;
+    for (size_t i = 0; i < model.buffers.size(); ++i) {
+        const std::vector<unsigned char>& data = model.buffers[i].data;
+        context.buffers.push_back(i == 0 && detached ? bin : std::span<const uint8_t>(data.data(), data.size()));
+    }
+    if (!mesh2py::gltf::ImportMappedScene(context, path, file)) {
+        if (error) {
+            *error = std::move(context.error);
+        }
+        return false;
+    }
+    // The mapped file pages are part of the data blob
+    RecordAllocatedBytes(mesh2py::gltf::GetParserBytes(model) + context.storage.data.size());
+    if (options.stats) {
+        CountImportedData(context.storage, *options.stats);
+    }
+    storage = std::move(context.storage);
+    return true;
+}
+
+mesh2py::common::SceneStorage ImportGltf(const char* path, const mesh2py::common::ImportOptions& options) {
+    mesh2py::common::SceneStorage storage;
+    std::string error;
+    if (!ImportGltf(path, options, storage, &error)) {
+        printf("Error %s\n", error.c_str());
+        return {};
+    }
+    return storage;
+}
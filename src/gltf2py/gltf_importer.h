@@ -0,0 +1,33 @@
+#pragma once
+
+#include <common/import_options.h>
+#include <common/scene_data.h>
+
+#include <string>
+
+// Imports a .gltf or .glb file into `storage` with the same layout as the FBX importer.
+// Every glTF primitive becomes one MeshInfo, all attributes of a primitive share its index
+// array. The JOINTS_n and WEIGHTS_n sets of a skinned primitive are merged into one Uint16
+// Joints and one Weights attribute of options.max_joint_influences values, and the skin of the
+// first node drawing the mesh fills its joint_infos, as for FBX skins. Returns false and stores
+// the reason in `error` (when not null) on failure.
+bool ImportGltf(const char* path, const mesh2py::common::ImportOptions& options,
+    mesh2py::common::SceneStorage& storage, std::string* error);
+
+// Imports a .glb file with the file mapped copy on write at the start of the data blob.
+// uint32 indices and float attributes already in the stored layout are referenced in place,
+// only faces and accessors that need converting are written behind the file. Processes
+// mapping the same file share its page cache. Platforms without mapped tails (Windows) fall
+// back to a copy of the file in a blob from options.allocator. options.optimize_meshes is
+// ignored, the optimized meshes could not stay in the mapping.
+bool ImportGlbMapped(const char* path, const mesh2py::common::ImportOptions& options,
+    mesh2py::common::SceneStorage& storage, std::string* error);
+
+// Imports a .gltf or .glb file held in memory without writing it to disk. The binary chunk of
+// a GLB is read in place, only the JSON is copied. External buffer URIs are resolved against
+// `base_dir`, nullptr or "" for the working directory. `data` is only read during the call.
+bool ImportGltfFromMemory(const void* data, size_t size, const char* base_dir,
+    const mesh2py::common::ImportOptions& options, mesh2py::common::SceneStorage& storage, std::string* error);
+
+// Prints errors and returns an empty storage on failure
+mesh2py::common::SceneStorage ImportGltf(const char* path, const mesh2py::common::ImportOptions& options = {});
@@ -1,11 +1,29 @@
 #include "fbx_importer.h"
+#include <common/batch_import.h>
+#include <common/blendshapes.h>
+#include <common/build_meshlets.h>
+#include <common/deduplicate.h>
+#include <common/generate_lods.h>
+#include <common/import_stats.h>
+#include <common/optimize_meshes.h>
+#include <common/quantize_attributes.h>
+#include <common/scene_bvh.h>
+#include <common/scene_cache.h>
+#include <common/thread_pool.h>
+#include <common/unify_vertices.h>
+#include <common/world_transforms.h>
 
 #include <ufbx.h>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 #include <vector>
+#include <algorithm>
+#include <array>
 #include <string>
+#include <cstdio>
 #include <cstring>
+#include <new>
 #include <unordered_map>
 #include <cmath>
 
@@ -266,6 +284,18 @@ bool VerifyAttributeIndices(const ufbx_mesh* fbx_mesh,
                 color_idx++;
                 break;
             }
+            case VertexAttribType::Joints:
+            case VertexAttribType::Weights: {
+                // Skin influences are per control point, like the positions
+                snprintf(context, sizeof(context), "Mesh %u skin indices", mesh_index);
+                if (!CompareUfbxIndexArrays(fbx_mesh->vertex_position.indices.data,
+                                            attrib_view.indices.data(),
+                                            fbx_mesh->vertex_position.indices.count,
+                                            context)) {
+                    all_passed = false;
+                }
+                break;
+            }
             default:
                 std::cerr << "Unknown attribute type: " << static_cast<uint32_t>(attrib_info.attrib_type) << std::endl;
                 all_passed = false;
@@ -395,13 +425,15 @@ bool VerifyNodeTransforms(const ufbx_scene* scene, SceneStorage& storage) {
         Node& node = storage.nodes[node_idx];
         ufbx_node* fbx_node = scene->nodes[node_idx];
         
-        const ufbx_real* src_matrix = &fbx_node->local_transform.translation.x;
+        // Column major 4x4 of the affine node_to_parent matrix
+        const ufbx_matrix& src_matrix = fbx_node->node_to_parent;
         
         for (uint32_t j = 0; j < 16; ++j) {
             char context[128];
             snprintf(context, sizeof(context), "Node %u transform[%u]", node_idx, j);
             
-            double expected_double = src_matrix[j];
+            uint32_t column = j / 4, row = j % 4;
+            double expected_double = row < 3 ? src_matrix.v[3 * column + row] : (column == 3 ? 1.0 : 0.0);
             float expected_float = static_cast<float>(expected_double);
             float actual_float = node.transform[j];
             
@@ -419,6 +451,234 @@ bool VerifyNodeTransforms(const ufbx_scene* scene, SceneStorage& storage) {
     return all_passed;
 }
 
+// Mesh bounds must match the converted positions and every node box must be found by the BVH
+bool VerifyBounds(const ufbx_scene* scene, SceneStorage& storage) {
+    std::cout << "Verifying bounds..." << std::endl;
+
+    for (uint32_t mesh_idx = 0; mesh_idx < storage.mesh_infos.size(); ++mesh_idx) {
+        const ufbx_mesh* fbx_mesh = scene->meshes[mesh_idx];
+        const MeshInfo& mesh_info = storage.mesh_infos[mesh_idx];
+        for (int axis = 0; axis < 3; ++axis) {
+            float expected_min = fbx_mesh->vertex_position.values.count ? INFINITY : 0.0f;
+            float expected_max = fbx_mesh->vertex_position.values.count ? -INFINITY : 0.0f;
+            for (size_t i = 0; i < fbx_mesh->vertex_position.values.count; ++i) {
+                float value = static_cast<float>(fbx_mesh->vertex_position.values.data[i].v[axis]);
+                expected_min = std::min(expected_min, value);
+                expected_max = std::max(expected_max, value);
+            }
+            if (mesh_info.bounds_min[axis] != expected_min || mesh_info.bounds_max[axis] != expected_max) {
+                std::cerr << "Mismatch in bounds of mesh " << mesh_idx << " axis " << axis << std::endl;
+                return false;
+            }
+        }
+    }
+
+    SceneBvh bvh;
+    std::string error;
+    if (!BuildSceneBvh(storage, 0, bvh, &error)) {
+        std::cerr << "BuildSceneBvh failed: " << error << std::endl;
+        return false;
+    }
+    for (uint32_t node_idx = 0; node_idx < storage.nodes.size(); ++node_idx) {
+        if (storage.nodes[node_idx].mesh_index >= storage.mesh_infos.size()) {
+            continue;
+        }
+        std::vector<uint32_t> hits;
+        QueryBox(bvh, bvh.node_bounds[node_idx], hits);
+        uint32_t nearest = UINT32_MAX;
+        float distance = 0.0f;
+        QueryNearest(bvh, bvh.node_bounds[node_idx].min, 1, &nearest, &distance);
+        if (std::find(hits.begin(), hits.end(), node_idx) == hits.end() || distance != 0.0f) {
+            std::cerr << "BVH misses the bounds of node " << node_idx << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "  Bounds verified successfully (" << bvh.nodes.size() << " BVH nodes)" << std::endl;
+    return true;
+}
+
+// World matrices composed from the node transforms must match ufbx's node_to_world
+bool VerifyWorldTransforms(const ufbx_scene* scene, SceneStorage& storage) {
+    std::cout << "Verifying world transforms..." << std::endl;
+
+    std::vector<float> world(16 * storage.nodes.size());
+    std::string error;
+    if (!ComputeWorldTransforms(storage, 0, world.data(), &error)) {
+        std::cerr << "ComputeWorldTransforms failed: " << error << std::endl;
+        return false;
+    }
+
+    bool all_passed = true;
+    for (uint32_t node_idx = 0; node_idx < storage.nodes.size(); ++node_idx) {
+        const ufbx_matrix& expected = scene->nodes[node_idx]->node_to_world;
+        for (uint32_t j = 0; j < 16; ++j) {
+            uint32_t column = j / 4, row = j % 4;
+            double expected_double = row < 3 ? expected.v[3 * column + row] : (column == 3 ? 1.0 : 0.0);
+            float actual = world[16 * node_idx + j];
+            if (std::fabs(actual - expected_double) > 1e-4 * (1.0 + std::fabs(expected_double))) {
+                std::cerr << "Mismatch in node " << node_idx << " world[" << j << "]: expected=" << expected_double
+                          << ", actual=" << actual << std::endl;
+                all_passed = false;
+                break;
+            }
+        }
+    }
+
+    if (all_passed) {
+        std::cout << "  World transforms verified successfully" << std::endl;
+    }
+    return all_passed;
+}
+
+// Joints must reference the cluster bones, and every control point keeps its largest weight
+// first with the kept weights summing to 1
+bool VerifySkins(const ufbx_scene* scene, SceneStorage& storage) {
+    std::cout << "Verifying skins..." << std::endl;
+
+    bool all_passed = true;
+    for (uint32_t mesh_idx = 0; mesh_idx < storage.mesh_infos.size(); ++mesh_idx) {
+        const ufbx_mesh* fbx_mesh = scene->meshes[mesh_idx];
+        const MeshInfo& mesh_info = storage.mesh_infos[mesh_idx];
+        if (fbx_mesh->skin_deformers.count == 0) {
+            continue;
+        }
+        const ufbx_skin_deformer* skin = fbx_mesh->skin_deformers[0];
+        if (!CompareUint32((uint32_t)skin->clusters.count, mesh_info.joint_info_count, "Joint count")) {
+            all_passed = false;
+            continue;
+        }
+        for (uint32_t j = 0; j < mesh_info.joint_info_count; ++j) {
+            const JointInfo& joint_info = storage.joint_infos[mesh_info.joint_info_start_index + j];
+            if (skin->clusters[j]->bone_node && scene->nodes[joint_info.node_index] != skin->clusters[j]->bone_node) {
+                std::cerr << "Mesh " << mesh_idx << " joint " << j << " references the wrong node" << std::endl;
+                all_passed = false;
+            }
+        }
+
+        const AttributeInfo* joints = nullptr;
+        const AttributeInfo* weights = nullptr;
+        for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+            const AttributeInfo& attrib_info = storage.attrib_infos[mesh_info.attrib_info_start_index + a];
+            joints = attrib_info.attrib_type == VertexAttribType::Joints ? &attrib_info : joints;
+            weights = attrib_info.attrib_type == VertexAttribType::Weights ? &attrib_info : weights;
+        }
+        if (!joints || !weights) {
+            std::cerr << "Mesh " << mesh_idx << " is skinned but has no Joints and Weights attributes" << std::endl;
+            all_passed = false;
+            continue;
+        }
+
+        uint32_t width = joints->num_value_per_index;
+        const uint16_t* joint_values = (const uint16_t*)(storage.data.data() + joints->value_offset);
+        const float* weight_values = (const float*)(storage.data.data() + weights->value_offset);
+        for (uint32_t v = 0; v < joints->value_count && v < skin->vertices.count; ++v) {
+            const ufbx_skin_vertex& skin_vertex = skin->vertices[v];
+            double largest = 0.0;
+            float total = 0.0f;
+            for (uint32_t i = 0; i < skin_vertex.num_weights; ++i) {
+                largest = std::max(largest, (double)skin->weights[skin_vertex.weight_begin + i].weight);
+            }
+            for (uint32_t i = 0; i < width; ++i) {
+                total += weight_values[v * width + i];
+                if (joint_values[v * width + i] >= mesh_info.joint_info_count) {
+                    all_passed = false;
+                }
+            }
+            bool has_weights = skin_vertex.num_weights > 0 && largest > 0.0;
+            uint16_t first_joint = joint_values[v * width];
+            bool first_is_largest = !has_weights;
+            for (uint32_t i = 0; i < skin_vertex.num_weights && has_weights; ++i) {
+                const ufbx_skin_weight& weight = skin->weights[skin_vertex.weight_begin + i];
+                first_is_largest = first_is_largest || (weight.cluster_index == first_joint && weight.weight == largest);
+            }
+            if (std::fabs(total - (has_weights ? 1.0f : 0.0f)) > 1e-4f || !first_is_largest) {
+                std::cerr << "Mesh " << mesh_idx << " vertex " << v << " has mismatching skin weights" << std::endl;
+                all_passed = false;
+                break;
+            }
+        }
+    }
+
+    if (all_passed) {
+        std::cout << "  Skins verified successfully" << std::endl;
+    }
+    return all_passed;
+}
+
+// Every blend channel target must be stored sparsely with its control points and deltas, and
+// evaluating a shape at weight 1 must move exactly those positions
+bool VerifyBlendshapes(const ufbx_scene* scene, SceneStorage& storage) {
+    std::cout << "Verifying blend shapes..." << std::endl;
+
+    bool all_passed = true;
+    for (uint32_t mesh_idx = 0; mesh_idx < storage.mesh_infos.size(); ++mesh_idx) {
+        const ufbx_mesh* fbx_mesh = scene->meshes[mesh_idx];
+        const MeshInfo& mesh_info = storage.mesh_infos[mesh_idx];
+        std::vector<const ufbx_blend_shape*> shapes;
+        for (size_t d = 0; d < fbx_mesh->blend_deformers.count; ++d) {
+            for (size_t c = 0; c < fbx_mesh->blend_deformers[d]->channels.count; ++c) {
+                if (fbx_mesh->blend_deformers[d]->channels[c]->target_shape) {
+                    shapes.push_back(fbx_mesh->blend_deformers[d]->channels[c]->target_shape);
+                }
+            }
+        }
+        if (!CompareUint32((uint32_t)shapes.size(), mesh_info.blendshape_count, "Blend shape count")) {
+            all_passed = false;
+            continue;
+        }
+
+        size_t vertex_count = fbx_mesh->vertex_position.values.count;
+        std::vector<float> weights(mesh_info.blendshape_count, 0.0f);
+        std::vector<float> moved(3 * vertex_count);
+        for (uint32_t s = 0; s < mesh_info.blendshape_count && all_passed; ++s) {
+            const BlendshapeInfo& shape_info = storage.blendshape_infos[mesh_info.blendshape_start_index + s];
+            const uint32_t* vertices = (const uint32_t*)(storage.data.data() + shape_info.vertex_offset);
+            const float* deltas = (const float*)(storage.data.data() + shape_info.position_offset);
+            char context[128];
+            snprintf(context, sizeof(context), "Mesh %u blend shape %u vertices", mesh_idx, s);
+            if (!CompareUfbxIndexArrays(shapes[s]->offset_vertices.data, vertices, shape_info.vertex_count, context) ||
+                !CompareVec3Arrays(shapes[s]->position_offsets.data, deltas, shape_info.vertex_count, context)) {
+                all_passed = false;
+                break;
+            }
+
+            std::fill(moved.begin(), moved.end(), 0.0f);
+            weights.assign(mesh_info.blendshape_count, 0.0f);
+            weights[s] = 1.0f;
+            std::string error;
+            if (!EvaluateBlendshapes(storage, mesh_info, weights.data(), moved.data(), nullptr, &error)) {
+                std::cerr << "EvaluateBlendshapes failed: " << error << std::endl;
+                all_passed = false;
+                break;
+            }
+            for (uint32_t i = 0; i < shape_info.vertex_count; ++i) {
+                for (uint32_t axis = 0; axis < 3; ++axis) {
+                    if (moved[3 * vertices[i] + axis] != deltas[3 * i + axis]) {
+                        std::cerr << "Mesh " << mesh_idx << " blend shape " << s << " evaluates wrong" << std::endl;
+                        all_passed = false;
+                        break;
+                    }
+                }
+            }
+
+            // A NaN weight must fail without touching the positions
+            weights[s] = std::nanf("");
+            std::fill(moved.begin(), moved.end(), 0.0f);
+            if (EvaluateBlendshapes(storage, mesh_info, weights.data(), moved.data(), nullptr, &error) ||
+                error.empty() || std::any_of(moved.begin(), moved.end(), [](float value) { return value != 0.0f; })) {
+                std::cerr << "Mesh " << mesh_idx << " blend shape " << s << " accepted a NaN weight" << std::endl;
+                all_passed = false;
+            }
+        }
+    }
+
+    if (all_passed) {
+        std::cout << "  Blend shapes verified successfully" << std::endl;
+    }
+    return all_passed;
+}
+
 // ============================================================================
 // Node Hierarchy Verification
 // ============================================================================
@@ -520,6 +780,22 @@ bool VerifySceneStorage(const ufbx_scene* scene, FbxContext& context) {
         all_passed = false;
     }
     
+    if (!VerifyWorldTransforms(scene, context.storage)) {
+        all_passed = false;
+    }
+    
+    if (!VerifyBounds(scene, context.storage)) {
+        all_passed = false;
+    }
+    
+    if (!VerifySkins(scene, context.storage)) {
+        all_passed = false;
+    }
+    
+    if (!VerifyBlendshapes(scene, context.storage)) {
+        all_passed = false;
+    }
+    
     if (!VerifyNodeHierarchy(scene, context.storage)) {
         all_passed = false;
     }
@@ -617,7 +893,806 @@ void ExportMeshToOBJ(const std::string& filename, SceneStorage& storage, uint32_
     std::cout << "Exported mesh " << mesh_index << " to " << filename << std::endl;
 }
 
+// Verify that a multi-threaded import produces exactly the same bytes as the serial one
+bool VerifyParallelImport(const ufbx_scene* scene, SceneStorage& serial_storage) {
+    std::cout << "Verifying parallel import..." << std::endl;
+
+    FbxContext context;
+    context.scene = scene;
+    context.options.num_threads = 0;
+    ImportScene(context);
+    SceneStorage& storage = context.storage;
+
+    bool all_passed = true;
+    if (storage.data.size() != serial_storage.data.size() ||
+        memcmp(storage.data.data(), serial_storage.data.data(), storage.data.size()) != 0) {
+        std::cerr << "Mismatch in parallel import data blob" << std::endl;
+        all_passed = false;
+    }
+    if (storage.mesh_infos.size() != serial_storage.mesh_infos.size() ||
+        memcmp(storage.mesh_infos.data(), serial_storage.mesh_infos.data(), storage.mesh_infos.size() * sizeof(MeshInfo)) != 0) {
+        std::cerr << "Mismatch in parallel import mesh infos" << std::endl;
+        all_passed = false;
+    }
+    if (storage.attrib_infos.size() != serial_storage.attrib_infos.size() ||
+        memcmp(storage.attrib_infos.data(), serial_storage.attrib_infos.data(), storage.attrib_infos.size() * sizeof(AttributeInfo)) != 0) {
+        std::cerr << "Mismatch in parallel import attribute infos" << std::endl;
+        all_passed = false;
+    }
+
+    if (all_passed) {
+        std::cout << "  Parallel import verified successfully" << std::endl;
+    }
+    return all_passed;
+}
+
+// Every corner of the unified storage must resolve to the values it had before welding
+bool VerifyUnifiedVertices(SceneStorage& storage) {
+    std::cout << "Verifying unified vertices..." << std::endl;
+
+    ImportOptions options;
+    options.num_threads = 0;
+    SceneStorage unified;
+    std::string error;
+    if (!BuildUnifiedVertices(storage, options, unified, &error)) {
+        std::cerr << "BuildUnifiedVertices failed: " << error << std::endl;
+        return false;
+    }
+
+    for (uint32_t attrib_idx = 0; attrib_idx < storage.attrib_infos.size(); ++attrib_idx) {
+        AttributeInfo& original_info = storage.attrib_infos[attrib_idx];
+        AttributeInfo& welded_info = unified.attrib_infos[attrib_idx];
+        AttributeView original = GetAttribView(storage, original_info);
+        AttributeView welded = GetAttribView(unified, welded_info);
+        if (original.indices.size() != welded.indices.size() ||
+            original.indices.size() != original_info.index_count ||
+            original_info.value_encoding != welded_info.value_encoding) {
+            std::cerr << "Mismatch in unified index count of attribute " << attrib_idx << std::endl;
+            return false;
+        }
+        // Compare raw value bytes, the Uint16 joints have no float view
+        size_t value_size = GetValueSize(original_info);
+        const uint8_t* original_values = storage.data.data() + original_info.value_offset;
+        const uint8_t* welded_values = unified.data.data() + welded_info.value_offset;
+        for (size_t corner = 0; corner < original.indices.size(); ++corner) {
+            if (memcmp(original_values + original.indices[corner] * value_size,
+                       welded_values + welded.indices[corner] * value_size, value_size) != 0) {
+                std::cerr << "Mismatch in unified values of attribute " << attrib_idx << " corner " << corner << std::endl;
+                return false;
+            }
+        }
+    }
+
+    std::cout << "  Unified vertices verified successfully" << std::endl;
+    return true;
+}
+
+// Quantized indices must decode exactly and positions to within one snorm16 step of the bounds
+// Every polygon mesh must come out fan triangulated with one shared index array holding three
+// indices per triangle of the source polygons
+bool VerifyOptimizedMeshes(SceneStorage& storage) {
+    std::cout << "Verifying optimized meshes..." << std::endl;
+
+    ImportOptions options;
+    options.num_threads = 0;
+    SceneStorage optimized;
+    std::string error;
+    if (!OptimizeMeshes(storage, options, optimized, &error)) {
+        std::cerr << "OptimizeMeshes failed: " << error << std::endl;
+        return false;
+    }
+    if (optimized.mesh_infos.size() != storage.mesh_infos.size()) {
+        std::cerr << "Optimized scene has " << optimized.mesh_infos.size() << " meshes instead of "
+                  << storage.mesh_infos.size() << std::endl;
+        return false;
+    }
+
+    for (uint32_t mesh_idx = 0; mesh_idx < storage.mesh_infos.size(); ++mesh_idx) {
+        const MeshInfo& mesh_info = storage.mesh_infos[mesh_idx];
+        FaceView faces = GetFaceView(storage, storage.mesh_infos[mesh_idx]);
+        bool polygons = mesh_info.attribute_info_count > 0;
+        uint32_t triangle_count = 0;
+        for (const Face& face : faces.faces) {
+            polygons = polygons && face.num_of_indices >= 3;
+            triangle_count += face.num_of_indices >= 3 ? face.num_of_indices - 2 : 0;
+        }
+        if (!polygons) {
+            continue;
+        }
+
+        const MeshInfo& optimized_info = optimized.mesh_infos[mesh_idx];
+        if (optimized_info.face_count != triangle_count) {
+            std::cerr << "Optimized mesh " << mesh_idx << " has " << optimized_info.face_count
+                      << " faces, expected " << triangle_count << " triangles" << std::endl;
+            return false;
+        }
+        FaceView triangles = GetFaceView(optimized, optimized.mesh_infos[mesh_idx]);
+        for (uint32_t i = 0; i < triangles.faces.size(); ++i) {
+            if (triangles.faces[i].indices_begin != 3 * i || triangles.faces[i].num_of_indices != 3) {
+                std::cerr << "Face " << i << " of optimized mesh " << mesh_idx << " is not a triangle" << std::endl;
+                return false;
+            }
+        }
+        const AttributeInfo& first = optimized.attrib_infos[optimized_info.attrib_info_start_index];
+        for (uint32_t a = 0; a < optimized_info.attribute_info_count; ++a) {
+            AttributeInfo& attrib_info = optimized.attrib_infos[optimized_info.attrib_info_start_index + a];
+            AttributeView view = GetAttribView(optimized, attrib_info);
+            if (attrib_info.index_offset != first.index_offset || attrib_info.index_count != 3 * triangle_count ||
+                std::any_of(view.indices.begin(), view.indices.end(),
+                    [&](uint32_t index) { return index >= attrib_info.value_count; })) {
+                std::cerr << "Mismatch in the indices of optimized mesh " << mesh_idx << " attribute " << a << std::endl;
+                return false;
+            }
+        }
+    }
+
+    std::cout << "  Optimized meshes verified successfully" << std::endl;
+    return true;
+}
+
+// Levels run from the most to the least detailed, each at most its index_ratio of the full
+// detail index count. The error bound is loose so the ratio is what stops simplification.
+bool VerifyLods(SceneStorage& storage) {
+    std::cout << "Verifying LODs..." << std::endl;
+
+    ImportOptions options;
+    options.num_threads = 0;
+    SceneStorage optimized;
+    std::string error;
+    if (!OptimizeMeshes(storage, options, optimized, &error)) {
+        std::cerr << "OptimizeMeshes failed: " << error << std::endl;
+        return false;
+    }
+    const std::vector<LodLevel> levels = { { 0.5f, 1.0f }, { 0.25f, 1.0f } };
+    if (!GenerateLods(optimized, levels, options.num_threads, &error)) {
+        std::cerr << "GenerateLods failed: " << error << std::endl;
+        return false;
+    }
+
+    for (uint32_t mesh_idx = 0; mesh_idx < optimized.mesh_infos.size(); ++mesh_idx) {
+        const MeshInfo& mesh_info = optimized.mesh_infos[mesh_idx];
+        const AttributeInfo* positions = GetTrianglePositions(optimized, mesh_info);
+        if (!positions) {
+            if (mesh_info.lod_info_count != 0) {
+                std::cerr << "Mesh " << mesh_idx << " without triangle positions has LODs" << std::endl;
+                return false;
+            }
+            continue;
+        }
+        if (mesh_info.lod_info_count > levels.size()) {
+            std::cerr << "Mesh " << mesh_idx << " has " << mesh_info.lod_info_count << " LODs" << std::endl;
+            return false;
+        }
+
+        uint32_t previous_count = positions->index_count;
+        float previous_error = 0.0f;
+        for (uint32_t level = 0; level < mesh_info.lod_info_count; ++level) {
+            const LodInfo& lod_info = optimized.lod_infos[mesh_info.lod_info_start_index + level];
+            size_t target_count = size_t(positions->index_count * levels[level].index_ratio) / 3 * 3;
+            const uint32_t* indices = (const uint32_t*)(optimized.data.data() + lod_info.index_offset);
+            if (lod_info.index_count == 0 || lod_info.index_count % 3 != 0 || lod_info.index_count > target_count ||
+                lod_info.index_count >= previous_count || lod_info.error < previous_error ||
+                std::any_of(indices, indices + lod_info.index_count,
+                    [&](uint32_t index) { return index >= positions->value_count; })) {
+                std::cerr << "LOD " << level << " of mesh " << mesh_idx << " has " << lod_info.index_count
+                          << " indices for a target of " << target_count << " and error " << lod_info.error
+                          << std::endl;
+                return false;
+            }
+            previous_count = lod_info.index_count;
+            previous_error = lod_info.error;
+        }
+    }
+
+    std::cout << "  LODs verified successfully (" << optimized.lod_infos.size() << " levels)" << std::endl;
+    return true;
+}
+
+// Triangle rotated so its smallest index comes first, keeping the winding
+static std::array<uint32_t, 3> CanonicalTriangle(uint32_t a, uint32_t b, uint32_t c) {
+    if (b < a && b <= c) {
+        return { b, c, a };
+    }
+    if (c < a && c < b) {
+        return { c, a, b };
+    }
+    return { a, b, c };
+}
+
+// Meshlets must respect the vertex and triangle limits and together cover every triangle of
+// their mesh exactly once
+bool VerifyMeshlets(SceneStorage& storage) {
+    std::cout << "Verifying meshlets..." << std::endl;
+
+    ImportOptions options;
+    options.num_threads = 0;
+    options.meshlet_max_vertices = 32;
+    options.meshlet_max_triangles = 64;
+    SceneStorage optimized;
+    std::string error;
+    if (!OptimizeMeshes(storage, options, optimized, &error) || !BuildMeshlets(optimized, options, &error)) {
+        std::cerr << "Building meshlets failed: " << error << std::endl;
+        return false;
+    }
+
+    for (uint32_t mesh_idx = 0; mesh_idx < optimized.mesh_infos.size(); ++mesh_idx) {
+        const MeshInfo& mesh_info = optimized.mesh_infos[mesh_idx];
+        const AttributeInfo* positions = GetTrianglePositions(optimized, mesh_info);
+        if (!positions) {
+            continue;
+        }
+
+        const uint32_t* indices = (const uint32_t*)(optimized.data.data() + positions->index_offset);
+        std::vector<std::array<uint32_t, 3>> expected;
+        for (uint32_t i = 0; i < positions->index_count; i += 3) {
+            expected.push_back(CanonicalTriangle(indices[i], indices[i + 1], indices[i + 2]));
+        }
+
+        std::vector<std::array<uint32_t, 3>> covered;
+        for (uint32_t m = 0; m < mesh_info.meshlet_count; ++m) {
+            const MeshletInfo& meshlet = optimized.meshlet_infos[mesh_info.meshlet_start_index + m];
+            if (meshlet.vertex_count > options.meshlet_max_vertices ||
+                meshlet.triangle_count > options.meshlet_max_triangles || meshlet.vertex_encoding != IndexEncoding::Uint32) {
+                std::cerr << "Meshlet " << m << " of mesh " << mesh_idx << " has " << meshlet.vertex_count
+                          << " vertices and " << meshlet.triangle_count << " triangles" << std::endl;
+                return false;
+            }
+            const uint32_t* vertices = (const uint32_t*)(optimized.data.data() + meshlet.vertex_offset);
+            const uint8_t* triangles = optimized.data.data() + meshlet.triangle_offset;
+            for (uint32_t t = 0; t < 3 * meshlet.triangle_count; t += 3) {
+                if (triangles[t] >= meshlet.vertex_count || triangles[t + 1] >= meshlet.vertex_count ||
+                    triangles[t + 2] >= meshlet.vertex_count) {
+                    std::cerr << "Meshlet " << m << " of mesh " << mesh_idx << " indexes past its vertices" << std::endl;
+                    return false;
+                }
+                covered.push_back(CanonicalTriangle(vertices[triangles[t]], vertices[triangles[t + 1]],
+                    vertices[triangles[t + 2]]));
+            }
+        }
+
+        std::sort(expected.begin(), expected.end());
+        std::sort(covered.begin(), covered.end());
+        if (covered != expected) {
+            std::cerr << "Meshlets of mesh " << mesh_idx << " cover " << covered.size() << " triangles, expected the "
+                      << expected.size() << " triangles of the mesh" << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "  Meshlets verified successfully (" << optimized.meshlet_infos.size() << " meshlets)" << std::endl;
+    return true;
+}
+
+bool VerifyQuantizedAttributes(SceneStorage& storage) {
+    std::cout << "Verifying quantized attributes..." << std::endl;
+
+    ImportOptions options;
+    options.num_threads = 0;
+    SceneStorage quantized;
+    std::string error;
+    if (!QuantizeAttributes(storage, options, quantized, &error)) {
+        std::cerr << "QuantizeAttributes failed: " << error << std::endl;
+        return false;
+    }
+    if (quantized.data.size() > storage.data.size()) {
+        std::cerr << "Quantized data is larger than the float data" << std::endl;
+        return false;
+    }
+
+    for (uint32_t mesh_idx = 0; mesh_idx < storage.mesh_infos.size(); ++mesh_idx) {
+        const MeshInfo& mesh_info = quantized.mesh_infos[mesh_idx];
+        for (uint32_t a = 0; a < mesh_info.attribute_info_count; ++a) {
+            uint32_t attrib_idx = mesh_info.attrib_info_start_index + a;
+            AttributeView original = GetAttribView(storage, storage.attrib_infos[attrib_idx]);
+            const AttributeInfo& attrib_info = quantized.attrib_infos[attrib_idx];
+
+            std::vector<uint32_t> indices(attrib_info.index_count);
+            DecodeIndices(quantized, attrib_info, indices.data());
+            if (memcmp(indices.data(), original.indices.data(), sizeof(uint32_t) * indices.size()) != 0) {
+                std::cerr << "Mismatch in quantized indices of attribute " << attrib_idx << std::endl;
+                return false;
+            }
+            if (attrib_info.attrib_type != VertexAttribType::Position || attrib_info.num_value_per_index != 3) {
+                continue;
+            }
+
+            std::vector<float> values(original.data.size());
+            DecodeValues(quantized, mesh_info, attrib_info, values.data());
+            for (size_t i = 0; i < values.size(); ++i) {
+                float extent = mesh_info.bounds_max[i % 3] - mesh_info.bounds_min[i % 3];
+                if (std::fabs(values[i] - original.data[i]) > extent / 32767.0f + 1e-6f * std::fabs(original.data[i])) {
+                    std::cerr << "Mismatch in quantized positions of attribute " << attrib_idx << " value " << i << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    std::cout << "  Quantized attributes verified successfully (" << storage.data.size() << " -> "
+              << quantized.data.size() << " bytes)" << std::endl;
+    return true;
+}
+
+// An instrumented import must produce the same scene and account for all of it in its stats
+bool VerifyImportStats(const ufbx_scene* scene, SceneStorage& serial_storage) {
+    std::cout << "Verifying import stats..." << std::endl;
+
+    ImportStats stats;
+    stats.record_trace = true;
+    FbxContext context;
+    context.scene = scene;
+    context.options.num_threads = 0;
+    {
+        ImportStatsScope scope(&stats);
+        ImportScene(context);
+    }
+    CountImportedData(context.storage, stats);
+
+    bool all_passed = true;
+    if (context.storage.data.size() != serial_storage.data.size() ||
+        memcmp(context.storage.data.data(), serial_storage.data.data(), serial_storage.data.size()) != 0) {
+        std::cerr << "Mismatch in instrumented import data blob" << std::endl;
+        all_passed = false;
+    }
+    all_passed &= CompareUint32((uint32_t)serial_storage.mesh_infos.size(), (uint32_t)stats.mesh_count, "stats mesh count");
+    all_passed &= CompareUint32((uint32_t)serial_storage.nodes.size(), (uint32_t)stats.node_count, "stats node count");
+
+    // Faces and attributes are the whole blob apart from blend shapes, skins and alignment padding
+    uint64_t written = stats.face_bytes;
+    for (uint64_t bytes : stats.attribute_bytes) {
+        written += bytes;
+    }
+    if (written > serial_storage.data.size()) {
+        std::cerr << "Stats account for " << written << " of " << serial_storage.data.size() << " data bytes" << std::endl;
+        all_passed = false;
+    }
+
+    // Every ImportScene phase timed once, no post import phase
+    for (ImportPhase phase : { ImportPhase::Layout, ImportPhase::Meshes, ImportPhase::Nodes, ImportPhase::Skins }) {
+        bool found = std::any_of(stats.trace_events.begin(), stats.trace_events.end(), [&](const TraceEvent& event) {
+            return strcmp(event.category, "phase") == 0 && strcmp(event.name, GetImportPhaseName(phase)) == 0;
+        });
+        if (!found) {
+            std::cerr << "Missing trace event for phase " << GetImportPhaseName(phase) << std::endl;
+            all_passed = false;
+        }
+    }
+    if (stats.phases[(size_t)ImportPhase::Optimize].wall_seconds != 0.0 || stats.GetThreadUtilization() > 1.0) {
+        std::cerr << "Unexpected post import timing or utilization " << stats.GetThreadUtilization() << std::endl;
+        all_passed = false;
+    }
+    if (FormatChromeTrace(stats).find("\"traceEvents\"") == std::string::npos) {
+        std::cerr << "Chrome trace has no traceEvents array" << std::endl;
+        all_passed = false;
+    }
+
+    if (all_passed) {
+        std::cout << "  Import stats verified successfully (" << stats.trace_events.size() << " trace events, "
+                  << stats.GetTotalWallSeconds() * 1e3 << " ms)" << std::endl;
+    }
+    return all_passed;
+}
+
+// Importing the file bytes from memory must match importing the file, and garbage must fail
+bool VerifyMemoryImport(const char* fbx_filename) {
+    std::cout << "Verifying memory import..." << std::endl;
+
+    std::ifstream file(fbx_filename, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    ImportOptions options;
+    SceneStorage file_storage;
+    SceneStorage memory_storage;
+    std::string error;
+    if (!ImportFbx(fbx_filename, options, file_storage, &error) ||
+        !ImportFbxFromMemory(bytes.data(), bytes.size(), options, memory_storage, &error)) {
+        std::cerr << "Import failed: " << error << std::endl;
+        return false;
+    }
+
+    bool all_passed = true;
+    if (memory_storage.data.size() != file_storage.data.size() ||
+        memcmp(memory_storage.data.data(), file_storage.data.data(), file_storage.data.size()) != 0) {
+        std::cerr << "Mismatch in memory import data blob" << std::endl;
+        all_passed = false;
+    }
+    if (memory_storage.mesh_infos.size() != file_storage.mesh_infos.size() ||
+        memcmp(memory_storage.mesh_infos.data(), file_storage.mesh_infos.data(), file_storage.mesh_infos.size() * sizeof(MeshInfo)) != 0) {
+        std::cerr << "Mismatch in memory import mesh infos" << std::endl;
+        all_passed = false;
+    }
+
+    const char garbage[] = "not an fbx file";
+    SceneStorage garbage_storage;
+    error.clear();
+    if (ImportFbxFromMemory(garbage, sizeof(garbage), options, garbage_storage, &error) || error.empty()) {
+        std::cerr << "Memory import of garbage did not fail with an error" << std::endl;
+        all_passed = false;
+    }
+
+    if (all_passed) {
+        std::cout << "  Memory import verified successfully (" << bytes.size() << " bytes)" << std::endl;
+    }
+    return all_passed;
+}
+
+template <class T>
+static bool TableEquals(const std::vector<T>& actual, const std::vector<T>& expected) {
+    return actual.size() == expected.size() &&
+        (expected.empty() || memcmp(actual.data(), expected.data(), expected.size() * sizeof(T)) == 0);
+}
+
+// Imports submitted to a ThreadPool, the way import_fbx_async runs them, must each match a
+// serial import, and a missing file must fail only its own task with an error
+bool VerifyThreadPoolImports(const char* fbx_filename) {
+    std::cout << "Verifying thread pool imports..." << std::endl;
+
+    ImportOptions options;
+    options.optimize_meshes = true;
+    SceneStorage expected;
+    std::string error;
+    if (!ImportFbx(fbx_filename, options, expected, &error)) {
+        std::cerr << "Import failed: " << error << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> paths = { fbx_filename, fbx_filename, "mesh2py_missing_file.fbx", fbx_filename };
+    std::vector<ImportResult> results(paths.size());
+    {
+        ThreadPool pool(3);
+        for (size_t i = 0; i < paths.size(); ++i) {
+            pool.Submit([&, i]() {
+                results[i].success = ImportFbx(paths[i].c_str(), options, results[i].storage, &results[i].error);
+            });
+        }
+        pool.Wait();
+    }
+
+    bool all_passed = true;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ImportResult& result = results[i];
+        if (i == 2) {
+            if (result.success || result.error.empty()) {
+                std::cerr << "Pooled import of a missing file did not fail with an error" << std::endl;
+                all_passed = false;
+            }
+        } else if (!result.success || !TableEquals(result.storage.mesh_infos, expected.mesh_infos) ||
+            result.storage.data.size() != expected.data.size() ||
+            memcmp(result.storage.data.data(), expected.data.data(), expected.data.size()) != 0) {
+            std::cerr << "Mismatch in pooled import " << i << ": " << result.error << std::endl;
+            all_passed = false;
+        }
+    }
+
+    if (all_passed) {
+        std::cout << "  Thread pool imports verified successfully" << std::endl;
+    }
+    return all_passed;
+}
+
+// Imports through the default, arena and huge page allocators must produce the same blob,
+// and the arena import must land inside the caller's memory
+bool VerifyStorageAllocators(const char* fbx_filename) {
+    std::cout << "Verifying storage allocators..." << std::endl;
+
+    ImportOptions options;
+    options.allocator = GetDefaultStorageAllocator();
+    SceneStorage expected;
+    std::string error;
+    if (!ImportFbx(fbx_filename, options, expected, &error)) {
+        std::cerr << "Import failed: " << error << std::endl;
+        return false;
+    }
+
+    // The arena needs room for the blob and the alignment of its start
+    std::vector<uint8_t> arena_memory(expected.data.size() + 64);
+    auto arena = std::make_shared<ArenaStorageAllocator>(arena_memory.data(), arena_memory.size());
+
+    bool all_passed = true;
+    const char* names[] = { "arena", "huge page" };
+    std::shared_ptr<StorageAllocator> allocators[] = { arena, GetHugePageStorageAllocator() };
+    for (size_t i = 0; i < std::size(allocators); ++i) {
+        options.allocator = allocators[i];
+        SceneStorage storage;
+        if (!ImportFbx(fbx_filename, options, storage, &error)) {
+            std::cerr << "Import through the " << names[i] << " allocator failed: " << error << std::endl;
+            all_passed = false;
+            continue;
+        }
+        if (storage.data.allocator() != allocators[i] || storage.data.size() != expected.data.size() ||
+            memcmp(storage.data.data(), expected.data.data(), expected.data.size()) != 0) {
+            std::cerr << "Blob imported through the " << names[i] << " allocator differs" << std::endl;
+            all_passed = false;
+        }
+        if (allocators[i] == arena && !expected.data.empty() &&
+            (storage.data.data() < arena_memory.data() ||
+             storage.data.data() + storage.data.size() > arena_memory.data() + arena_memory.size())) {
+            std::cerr << "Arena import is outside the arena" << std::endl;
+            all_passed = false;
+        }
+    }
+
+    // The arena is used up, a further import must fail instead of overlapping the first blob
+    options.allocator = arena;
+    SceneStorage overflow;
+    bool threw = false;
+    try {
+        ImportFbx(fbx_filename, options, overflow, &error);
+    } catch (const std::bad_alloc&) {
+        threw = true;
+    }
+    if (!expected.data.empty() && !threw) {
+        std::cerr << "Import into a full arena did not fail" << std::endl;
+        all_passed = false;
+    }
+
+    if (all_passed) {
+        std::cout << "  Storage allocators verified successfully" << std::endl;
+    }
+    return all_passed;
+}
+
+// Saves and maps a scene with every table filled: the records and the blob must round trip
+// unchanged, and truncated or corrupt caches must fail with an error
+bool VerifySceneCache(const char* fbx_filename) {
+    std::cout << "Verifying scene cache..." << std::endl;
+
+    ImportOptions options;
+    options.lod_levels = { { 0.5f, 0.01f } };
+    options.build_meshlets = true;
+    SceneStorage expected;
+    std::string error;
+    if (!ImportFbx(fbx_filename, options, expected, &error)) {
+        std::cerr << "Import failed: " << error << std::endl;
+        return false;
+    }
+
+    const char* path = "mesh2py_scene_cache_test.bin";
+    SceneStorage mapped;
+    if (!SaveSceneStorage(expected, path, &error) || !MapSceneStorage(path, mapped, &error)) {
+        std::cerr << "Scene cache round trip failed: " << error << std::endl;
+        return false;
+    }
+    bool all_passed = TableEquals(mapped.nodes, expected.nodes) &&
+        TableEquals(mapped.mesh_infos, expected.mesh_infos) &&
+        TableEquals(mapped.attrib_infos, expected.attrib_infos) &&
+        TableEquals(mapped.lod_infos, expected.lod_infos) &&
+        TableEquals(mapped.meshlet_infos, expected.meshlet_infos) &&
+        TableEquals(mapped.joint_infos, expected.joint_infos) &&
+        TableEquals(mapped.blendshape_infos, expected.blendshape_infos) &&
+        mapped.data.size() == expected.data.size() &&
+        memcmp(mapped.data.data(), expected.data.data(), expected.data.size()) == 0;
+    if (!all_passed) {
+        std::cerr << "Mapped scene cache differs from the saved scene" << std::endl;
+    }
+    mapped = SceneStorage();
+
+    std::ifstream input(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    input.close();
+    auto expect_rejected = [&](const char* name, const std::string& file_bytes) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(file_bytes.data(), file_bytes.size());
+        SceneStorage rejected;
+        error.clear();
+        if (MapSceneStorage(path, rejected, &error) || error.empty()) {
+            std::cerr << "Mapping a " << name << " scene cache did not fail" << std::endl;
+            all_passed = false;
+        }
+    };
+    expect_rejected("truncated", bytes.substr(0, bytes.size() / 2));
+    expect_rejected("header only", bytes.substr(0, 16));
+    std::string corrupt_header = bytes;
+    corrupt_header[0] ^= 0xff;
+    expect_rejected("bad magic", corrupt_header);
+
+    // A record pointing past the blob passes the header checks and must fail validation
+    if (!expected.mesh_infos.empty()) {
+        SceneStorage corrupt = expected;
+        corrupt.mesh_infos[0].face_offset = (DataOffset)corrupt.data.size();
+        corrupt.mesh_infos[0].face_count = 1;
+        if (!SaveSceneStorage(corrupt, path, &error)) {
+            std::cerr << "Saving the corrupt scene failed: " << error << std::endl;
+            all_passed = false;
+        } else {
+            std::ifstream corrupt_input(path, std::ios::binary);
+            expect_rejected("corrupt record", std::string((std::istreambuf_iterator<char>(corrupt_input)),
+                std::istreambuf_iterator<char>()));
+        }
+    }
+    std::remove(path);
+
+    if (all_passed) {
+        std::cout << "  Scene cache verified successfully" << std::endl;
+    }
+    return all_passed;
+}
+
+// A batch returns its results in input order, a missing file fails only its own entry
+bool VerifyImportMany(const char* fbx_filename) {
+    std::cout << "Verifying batch import..." << std::endl;
+
+    ImportOptions options;
+    SceneStorage expected;
+    std::string error;
+    if (!ImportFbx(fbx_filename, options, expected, &error)) {
+        std::cerr << "Import failed: " << error << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> paths = { fbx_filename, "mesh2py_missing_file.fbx", fbx_filename, fbx_filename };
+    std::vector<uint32_t> reported(paths.size(), 0);
+    ImportFunction import = [](const char* path, const ImportOptions& file_options, SceneStorage& storage,
+        std::string* file_error) {
+        return ImportFbx(path, file_options, storage, file_error);
+    };
+    std::vector<ImportResult> results = ImportMany(paths, 3, options, import, [&](size_t index, ImportResult&) {
+        ++reported[index];
+    });
+
+    bool all_passed = results.size() == paths.size();
+    for (size_t i = 0; all_passed && i < results.size(); ++i) {
+        const ImportResult& result = results[i];
+        bool missing = i == 1;
+        if (reported[i] != 1) {
+            std::cerr << "Batch result " << i << " reported " << reported[i] << " times" << std::endl;
+            all_passed = false;
+        } else if (missing && (result.success || result.error.empty() || result.storage.data.size() != 0)) {
+            std::cerr << "Batch import of a missing file did not fail with an error" << std::endl;
+            all_passed = false;
+        } else if (!missing && (!result.success || result.storage.data.size() != expected.data.size() ||
+            memcmp(result.storage.data.data(), expected.data.data(), expected.data.size()) != 0)) {
+            std::cerr << "Mismatch in batch result " << i << ": " << result.error << std::endl;
+            all_passed = false;
+        }
+    }
+
+    if (all_passed) {
+        std::cout << "  Batch import verified successfully" << std::endl;
+    }
+    return all_passed;
+}
+
+// Returns whether `size` bytes at `offset` are equal in both blobs, or zero in `actual` when
+// `expected` is null
+static bool RangeMatches(const SceneStorage& actual, const SceneStorage* expected, uint64_t offset, size_t size) {
+    const uint8_t* bytes = actual.data.data() + offset;
+    if (expected) {
+        return memcmp(bytes, expected->data.data() + offset, size) == 0;
+    }
+    return std::all_of(bytes, bytes + size, [](uint8_t byte) { return byte == 0; });
+}
+
+// Loads every other mesh of a lazy scene: the loaded meshes must match an eager import byte for
+// byte and the others must still read as zeros
+bool VerifyLazyScene(const char* fbx_filename) {
+    std::cout << "Verifying lazy scene..." << std::endl;
+
+    ImportOptions options;
+    options.num_threads = 2;
+    SceneStorage expected;
+    std::string error;
+    if (!ImportFbx(fbx_filename, options, expected, &error)) {
+        std::cerr << "Import failed: " << error << std::endl;
+        return false;
+    }
+
+    ImportOptions optimize_options = options;
+    optimize_options.optimize_meshes = true;
+    if (LazyFbxScene::Open(fbx_filename, optimize_options, &error) || error.empty()) {
+        std::cerr << "Lazy scene accepted post import options" << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<LazyFbxScene> scene = LazyFbxScene::Open(fbx_filename, options, &error);
+    if (!scene) {
+        std::cerr << "LazyFbxScene::Open failed: " << error << std::endl;
+        return false;
+    }
+    const SceneStorage& storage = scene->storage();
+    if (storage.data.size() != expected.data.size() || storage.mesh_infos.size() != expected.mesh_infos.size() ||
+        storage.attrib_infos.size() != expected.attrib_infos.size()) {
+        std::cerr << "Lazy scene layout differs from the eager import" << std::endl;
+        return false;
+    }
+
+    uint32_t mesh_count = (uint32_t)storage.mesh_infos.size();
+    for (uint32_t mesh_idx = 0; mesh_idx < mesh_count; mesh_idx += 2) {
+        scene->LoadMesh(mesh_idx);
+    }
+
+    bool all_passed = true;
+    for (uint32_t mesh_idx = 0; all_passed && mesh_idx < mesh_count; ++mesh_idx) {
+        bool loaded = mesh_idx % 2 == 0;
+        if (scene->IsMeshLoaded(mesh_idx) != loaded) {
+            std::cerr << "Mesh " << mesh_idx << " loaded state is " << !loaded << std::endl;
+            all_passed = false;
+            break;
+        }
+        const MeshInfo& mesh_info = storage.mesh_infos[mesh_idx];
+        const MeshInfo& expected_info = expected.mesh_infos[mesh_idx];
+        if (memcmp(&mesh_info, &expected_info, sizeof(MeshInfo)) != 0) {
+            std::cerr << "Mesh info " << mesh_idx << " differs from the eager import" << std::endl;
+            all_passed = false;
+            break;
+        }
+
+        const SceneStorage* reference = loaded ? &expected : nullptr;
+        all_passed = RangeMatches(storage, reference, mesh_info.face_offset, mesh_info.face_count * sizeof(Face));
+        for (uint32_t i = 0; all_passed && i < mesh_info.attribute_info_count; ++i) {
+            uint32_t attrib_idx = mesh_info.attrib_info_start_index + i;
+            const AttributeInfo& attrib_info = storage.attrib_infos[attrib_idx];
+            if (memcmp(&attrib_info, &expected.attrib_infos[attrib_idx], sizeof(AttributeInfo)) != 0 ||
+                scene->GetAttributeMesh(attrib_idx) != mesh_idx) {
+                all_passed = false;
+                break;
+            }
+            all_passed = RangeMatches(storage, reference, attrib_info.index_offset,
+                    attrib_info.index_count * GetIndexSize(attrib_info)) &&
+                RangeMatches(storage, reference, attrib_info.value_offset,
+                    attrib_info.value_count * GetValueSize(attrib_info));
+        }
+        if (!all_passed) {
+            std::cerr << "Data of " << (loaded ? "loaded" : "unloaded") << " mesh " << mesh_idx
+                      << " differs from the expected bytes" << std::endl;
+        }
+    }
+
+    if (all_passed) {
+        std::cout << "  Lazy scene verified successfully" << std::endl;
+    }
+    return all_passed;
+}
+
+// Every node must see the same faces and attribute bytes through its deduplicated mesh
+bool VerifyDeduplicatedScene(SceneStorage& storage) {
+    std::cout << "Verifying deduplicated scene..." << std::endl;
+
+    ImportOptions options;
+    options.num_threads = 0;
+    SceneStorage deduplicated;
+    std::string error;
+    if (!DeduplicateScene(storage, options, deduplicated, &error)) {
+        std::cerr << "DeduplicateScene failed: " << error << std::endl;
+        return false;
+    }
+    if (deduplicated.data.size() > storage.data.size() || deduplicated.mesh_infos.size() > storage.mesh_infos.size()) {
+        std::cerr << "Deduplicated scene is larger than the original" << std::endl;
+        return false;
+    }
+
+    for (uint32_t node_idx = 0; node_idx < storage.nodes.size(); ++node_idx) {
+        uint32_t mesh_idx = storage.nodes[node_idx].mesh_index;
+        if (mesh_idx >= storage.mesh_infos.size()) {
+            continue;
+        }
+        const MeshInfo& original = storage.mesh_infos[mesh_idx];
+        const MeshInfo& mesh_info = deduplicated.mesh_infos[deduplicated.nodes[node_idx].mesh_index];
+        if (original.face_count != mesh_info.face_count || original.attribute_info_count != mesh_info.attribute_info_count ||
+            memcmp(storage.data.data() + original.face_offset, deduplicated.data.data() + mesh_info.face_offset,
+                   sizeof(Face) * original.face_count) != 0) {
+            std::cerr << "Mismatch in deduplicated faces of node " << node_idx << std::endl;
+            return false;
+        }
+        for (uint32_t a = 0; a < original.attribute_info_count; ++a) {
+            AttributeView expected = GetAttribView(storage, storage.attrib_infos[original.attrib_info_start_index + a]);
+            AttributeView actual = GetAttribView(deduplicated, deduplicated.attrib_infos[mesh_info.attrib_info_start_index + a]);
+            if (expected.indices.size() != actual.indices.size() || expected.data.size() != actual.data.size() ||
+                memcmp(expected.indices.data(), actual.indices.data(), expected.indices.size_bytes()) != 0 ||
+                memcmp(expected.data.data(), actual.data.data(), expected.data.size_bytes()) != 0) {
+                std::cerr << "Mismatch in deduplicated attribute " << a << " of node " << node_idx << std::endl;
+                return false;
+            }
+        }
+    }
+
+    std::cout << "  Deduplicated scene verified successfully (" << storage.mesh_infos.size() << " -> "
+              << deduplicated.mesh_infos.size() << " meshes, " << storage.data.size() << " -> "
+              << deduplicated.data.size() << " bytes)" << std::endl;
+    return true;
+}
+
 // Test function to verify FBX importer functionality
+
 bool TestFbxImporter(const char* fbx_filename) {
     std::cout << "Testing FBX Importer with file: " << fbx_filename << std::endl;
     
@@ -684,6 +1759,48 @@ bool TestFbxImporter(const char* fbx_filename) {
     
     // Verify SceneStorage values against ufbx_scene
     bool verification_passed = VerifySceneStorage(scene, context);
+    if (!VerifyParallelImport(scene, context.storage)) {
+        verification_passed = false;
+    }
+    if (!VerifyUnifiedVertices(context.storage)) {
+        verification_passed = false;
+    }
+    if (!VerifyOptimizedMeshes(context.storage)) {
+        verification_passed = false;
+    }
+    if (!VerifyLods(context.storage)) {
+        verification_passed = false;
+    }
+    if (!VerifyMeshlets(context.storage)) {
+        verification_passed = false;
+    }
+    if (!VerifyQuantizedAttributes(context.storage)) {
+        verification_passed = false;
+    }
+    if (!VerifyDeduplicatedScene(context.storage)) {
+        verification_passed = false;
+    }
+    if (!VerifyImportStats(scene, context.storage)) {
+        verification_passed = false;
+    }
+    if (!VerifyMemoryImport(fbx_filename)) {
+        verification_passed = false;
+    }
+    if (!VerifyImportMany(fbx_filename)) {
+        verification_passed = false;
+    }
+    if (!VerifyThreadPoolImports(fbx_filename)) {
+        verification_passed = false;
+    }
+    if (!VerifyStorageAllocators(fbx_filename)) {
+        verification_passed = false;
+    }
+    if (!VerifyLazyScene(fbx_filename)) {
+        verification_passed = false;
+    }
+    if (!VerifySceneCache(fbx_filename)) {
+        verification_passed = false;
+    }
     
     // Clean up
     ufbx_free_scene(scene);
@@ -701,14 +1818,14 @@ bool TestFbxImporter(const char* fbx_filename) {
 
 // Main function for standalone testing
 int main(int argc, char* argv[]) {
-    // if (argc != 2) {
-    //     std::cout << "Usage: " << argv[0] << " <fbx_file>" << std::endl;
-    //     return 1;
-    // }
+    if (argc != 2) {
+        std::cout << "Usage: " << argv[0] << " <fbx_file>" << std::endl;
+        return 1;
+    }
     
     const char* fbx_filename = argv[1];
     
-    bool success = mesh2py::fbxtest::TestFbxImporter("D:/projects/mesh2usd/build/Debug/kb3d_secretsoftheluminara-native.fbx");
+    bool success = mesh2py::fbxtest::TestFbxImporter(fbx_filename);
     
     if (success) {
         std::cout << "\nTest PASSED!" << std::endl;
@@ -0,0 +1,414 @@
+#include "gltf_importer.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cmath>
+
+namespace mesh2py::gltftest {
+using namespace mesh2py::common;
+
+// ============================================================================
+// Test Scene
+// ============================================================================
+
+std::string EncodeBase64(const std::vector<uint8_t>& bytes) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < bytes.size(); i += 3) {
+        uint32_t chunk = bytes[i] << 16;
+        if (i + 1 < bytes.size()) chunk |= bytes[i + 1] << 8;
+        if (i + 2 < bytes.size()) chunk |= bytes[i + 2];
+        out += table[(chunk >> 18) & 63];
+        out += table[(chunk >> 12) & 63];
+        out += i + 1 < bytes.size() ? table[(chunk >> 6) & 63] : '=';
+        out += i + 2 < bytes.size() ? table[chunk & 63] : '=';
+    }
+    return out;
+}
+
+// A quad drawn as an indexed triangle strip with normalized uint8 texcoords in a strided view,
+// plus a second non indexed primitive whose positions use a sparse accessor
+std::vector<uint8_t> MakeTestBuffer() {
+    std::vector<uint8_t> buffer(72);
+    uint16_t indices[4] = { 0, 1, 2, 3 };
+    float positions[12] = { 0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0 };
+    uint8_t texcoords[16] = { 0, 0, 0, 0, 255, 0, 0, 0, 0, 255, 0, 0, 255, 255, 0, 0 };
+    memcpy(buffer.data(), indices, sizeof(indices));
+    memcpy(buffer.data() + 8, positions, sizeof(positions));
+    memcpy(buffer.data() + 56, texcoords, sizeof(texcoords));
+    return buffer;
+}
+
+// `buffer_uri` is empty for the GLB BIN chunk
+std::string MakeTestJson(const std::string& buffer_uri) {
+    std::string uri = buffer_uri.empty() ? std::string() : R"(, "uri": ")" + buffer_uri + "\"";
+    return R"({
+  "asset": { "version": "2.0" },
+  "scene": 0,
+  "scenes": [ { "nodes": [ 0 ] } ],
+  "nodes": [
+    { "children": [ 1 ], "translation": [ 1, 2, 3 ] },
+    { "mesh": 0, "rotation": [ 0, 0, 0.70710678, 0.70710678 ], "scale": [ 2, 2, 2 ] }
+  ],
+  "meshes": [ { "primitives": [
+    { "attributes": { "POSITION": 1, "TEXCOORD_0": 2 }, "indices": 0, "mode": 5 },
+    { "attributes": { "POSITION": 3 } }
+  ] } ],
+  "accessors": [
+    { "bufferView": 0, "componentType": 5123, "count": 4, "type": "SCALAR" },
+    { "bufferView": 1, "componentType": 5126, "count": 4, "type": "VEC3",
+      "min": [ 0, 0, 0 ], "max": [ 1, 1, 0 ] },
+    { "bufferView": 2, "componentType": 5121, "normalized": true, "count": 4, "type": "VEC2" },
+    { "bufferView": 1, "componentType": 5126, "count": 3, "type": "VEC3",
+      "min": [ 0, 0, 0 ], "max": [ 1, 1, 0 ],
+      "sparse": { "count": 1,
+        "indices": { "bufferView": 0, "byteOffset": 4, "componentType": 5123 },
+        "values": { "bufferView": 1, "byteOffset": 36 } } }
+  ],
+  "bufferViews": [
+    { "buffer": 0, "byteOffset": 0, "byteLength": 8 },
+    { "buffer": 0, "byteOffset": 8, "byteLength": 48 },
+    { "buffer": 0, "byteOffset": 56, "byteLength": 16, "byteStride": 4 }
+  ],
+  "buffers": [ { "byteLength": 72)" + uri + R"( } ]
+})";
+}
+
+bool WriteTestScene(const char* path) {
+    std::ofstream file(path);
+    file << MakeTestJson("data:application/octet-stream;base64," + EncodeBase64(MakeTestBuffer()));
+    return file.good();
+}
+
+// `json` names no uri for buffer 0, `buffer` becomes the BIN chunk
+bool WriteGlb(const char* path, std::string json, const std::vector<uint8_t>& buffer) {
+    json.resize(align_up(json.size(), 4), ' ');
+    uint32_t header[5] = { 0x46546C67, 2, uint32_t(28 + json.size() + buffer.size()), uint32_t(json.size()), 0x4E4F534A };
+    uint32_t bin_header[2] = { uint32_t(buffer.size()), 0x004E4942 };
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)header, sizeof(header));
+    file.write(json.data(), json.size());
+    file.write((const char*)bin_header, sizeof(bin_header));
+    file.write((const char*)buffer.data(), buffer.size());
+    return file.good();
+}
+
+bool WriteTestGlb(const char* path) {
+    return WriteGlb(path, MakeTestJson(""), MakeTestBuffer());
+}
+
+// ============================================================================
+// Verification
+// ============================================================================
+
+bool CompareFloats(const float* expected, const float* actual, size_t count, const char* context) {
+    for (size_t i = 0; i < count; ++i) {
+        if (std::fabs(expected[i] - actual[i]) > 1e-5f) {
+            std::cerr << "Mismatch in " << context << "[" << i << "]: expected=" << expected[i]
+                      << ", actual=" << actual[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompareUint32s(const uint32_t* expected, const uint32_t* actual, size_t count, const char* context) {
+    for (size_t i = 0; i < count; ++i) {
+        if (expected[i] != actual[i]) {
+            std::cerr << "Mismatch in " << context << "[" << i << "]: expected=" << expected[i]
+                      << ", actual=" << actual[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VerifyScene(SceneStorage& storage) {
+    if (storage.nodes.size() != 3 || storage.mesh_infos.size() != 2 || storage.attrib_infos.size() != 3) {
+        std::cerr << "Unexpected table sizes" << std::endl;
+        return false;
+    }
+
+    // Second primitive hangs off the mesh node as an identity child
+    uint32_t parents[3] = { UINT32_MAX, 0, 1 };
+    uint32_t meshes[3] = { UINT32_MAX, 0, 1 };
+    for (uint32_t i = 0; i < 3; ++i) {
+        if (storage.nodes[i].parent != parents[i] || storage.nodes[i].mesh_index != meshes[i]) {
+            std::cerr << "Unexpected hierarchy at node " << i << std::endl;
+            return false;
+        }
+    }
+    float root[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 1, 2, 3, 1 };
+    float rotated[16] = { 0, 2, 0, 0, -2, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 1 };
+    if (!CompareFloats(root, storage.nodes[0].transform, 16, "root transform") ||
+        !CompareFloats(rotated, storage.nodes[1].transform, 16, "mesh transform")) {
+        return false;
+    }
+
+    // The strip unrolls into two triangles shared by every attribute
+    MeshInfo& quad = storage.mesh_infos[0];
+    FaceView faces = GetFaceView(storage, quad);
+    if (quad.face_count != 2 || quad.attribute_info_count != 2 || faces.faces[1].indices_begin != 3) {
+        std::cerr << "Unexpected quad faces" << std::endl;
+        return false;
+    }
+    AttributeInfo& position_info = storage.attrib_infos[quad.attrib_info_start_index];
+    AttributeInfo& texcoord_info = storage.attrib_infos[quad.attrib_info_start_index + 1];
+    if (position_info.attrib_type != VertexAttribType::Position || texcoord_info.attrib_type != VertexAttribType::TexCoord ||
+        position_info.index_offset != texcoord_info.index_offset) {
+        std::cerr << "Unexpected quad attributes" << std::endl;
+        return false;
+    }
+    uint32_t corners[6] = { 0, 1, 2, 1, 3, 2 };
+    float positions[12] = { 0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0 };
+    float texcoords[8] = { 0, 0, 1, 0, 0, 1, 1, 1 };
+    AttributeView position_view = GetAttribView(storage, position_info);
+    AttributeView texcoord_view = GetAttribView(storage, texcoord_info);
+    if (!CompareUint32s(corners, position_view.indices.data(), 6, "strip corners") ||
+        !CompareFloats(positions, position_view.data.data(), 12, "quad positions") ||
+        !CompareFloats(texcoords, texcoord_view.data.data(), 8, "quad texcoords")) {
+        return false;
+    }
+
+    // The sparse accessor replaces the third position
+    MeshInfo& triangle = storage.mesh_infos[1];
+    AttributeView sparse_view = GetAttribView(storage, storage.attrib_infos[triangle.attrib_info_start_index]);
+    uint32_t triangle_corners[3] = { 0, 1, 2 };
+    float sparse_positions[9] = { 0, 0, 0, 1, 0, 0, 1, 1, 0 };
+    return CompareUint32s(triangle_corners, sparse_view.indices.data(), 3, "triangle corners") &&
+        CompareFloats(sparse_positions, sparse_view.data.data(), 9, "sparse positions");
+}
+
+// A triangle skinned by two joints with two influence sets: vertex 0 has three influences, the
+// smallest is dropped, and vertex 2 names joint 5 which is outside the skin
+std::string MakeSkinnedJson() {
+    std::vector<uint8_t> buffer(284);
+    float positions[9] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+    uint8_t joints[24] = { 0, 1, 0, 0, 1, 0, 0, 0, 5, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    float weights[24] = { 0.5f, 0.3f, 0, 0, 1, 0, 0, 0, 0.4f, 0.6f, 0, 0,
+                          0.2f, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    float inverse_bind[32] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1,
+                               1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 5, 6, 7, 1 };
+    memcpy(buffer.data(), positions, sizeof(positions));
+    memcpy(buffer.data() + 36, joints, sizeof(joints));
+    memcpy(buffer.data() + 60, weights, sizeof(weights));
+    memcpy(buffer.data() + 156, inverse_bind, sizeof(inverse_bind));
+    return R"({
+  "asset": { "version": "2.0" },
+  "nodes": [ { "children": [ 1 ] }, {}, { "mesh": 0, "skin": 0 } ],
+  "skins": [ { "joints": [ 0, 1 ], "inverseBindMatrices": 5 } ],
+  "meshes": [ { "primitives": [ { "attributes":
+    { "POSITION": 0, "JOINTS_0": 1, "JOINTS_1": 2, "WEIGHTS_0": 3, "WEIGHTS_1": 4 } } ] } ],
+  "accessors": [
+    { "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3" },
+    { "bufferView": 1, "componentType": 5121, "count": 3, "type": "VEC4" },
+    { "bufferView": 1, "byteOffset": 12, "componentType": 5121, "count": 3, "type": "VEC4" },
+    { "bufferView": 2, "componentType": 5126, "count": 3, "type": "VEC4" },
+    { "bufferView": 2, "byteOffset": 48, "componentType": 5126, "count": 3, "type": "VEC4" },
+    { "bufferView": 3, "componentType": 5126, "count": 2, "type": "MAT4" }
+  ],
+  "bufferViews": [
+    { "buffer": 0, "byteOffset": 0, "byteLength": 36 },
+    { "buffer": 0, "byteOffset": 36, "byteLength": 24 },
+    { "buffer": 0, "byteOffset": 60, "byteLength": 96 },
+    { "buffer": 0, "byteOffset": 156, "byteLength": 128 }
+  ],
+  "buffers": [ { "byteLength": 284, "uri": "data:application/octet-stream;base64,)" +
+        EncodeBase64(buffer) + R"(" } ]
+})";
+}
+
+// Skins import like the FBX ones: top-k uint16 joints, renormalized weights and joint records
+bool VerifySkinnedScene() {
+    std::string json = MakeSkinnedJson();
+    ImportOptions options;
+    options.max_joint_influences = 2;
+    SceneStorage storage;
+    std::string error;
+    if (!ImportGltfFromMemory(json.data(), json.size(), nullptr, options, storage, &error)) {
+        std::cerr << "Skinned import failed: " << error << std::endl;
+        return false;
+    }
+    if (storage.joint_infos.size() != 2 || storage.mesh_infos[0].joint_info_count != 2 ||
+        storage.joint_infos[1].node_index != 1 || storage.joint_infos[1].inverse_bind_matrix[12] != 5.0f ||
+        storage.mesh_infos[0].attribute_info_count != 3) {
+        std::cerr << "Unexpected skin records" << std::endl;
+        return false;
+    }
+    AttributeInfo& joints_info = storage.attrib_infos[1];
+    AttributeInfo& weights_info = storage.attrib_infos[2];
+    if (joints_info.attrib_type != VertexAttribType::Joints || joints_info.value_encoding != ValueEncoding::Uint16 ||
+        joints_info.num_value_per_index != 2 || weights_info.attrib_type != VertexAttribType::Weights ||
+        weights_info.num_value_per_index != 2 || joints_info.index_offset != storage.attrib_infos[0].index_offset) {
+        std::cerr << "Unexpected skin attributes" << std::endl;
+        return false;
+    }
+    const uint16_t* joints = (const uint16_t*)(storage.data.data() + joints_info.value_offset);
+    uint16_t expected_joints[6] = { 0, 1, 1, 0, 1, 0 };
+    float expected_weights[6] = { 0.625f, 0.375f, 1, 0, 1, 0 };
+    for (size_t i = 0; i < 6; ++i) {
+        if (joints[i] != expected_joints[i]) {
+            std::cerr << "Mismatch in skin joints[" << i << "]: expected=" << expected_joints[i]
+                      << ", actual=" << joints[i] << std::endl;
+            return false;
+        }
+    }
+    return CompareFloats(expected_weights, GetAttribView(storage, weights_info).data.data(), 6, "skin weights");
+}
+
+// A triangle with uint32 indices { 0, 1, `last_index` }, 3 positions and 3 texcoords
+std::vector<uint8_t> MakeTriangleBuffer(uint32_t last_index) {
+    std::vector<uint8_t> buffer(72);
+    uint32_t indices[3] = { 0, 1, last_index };
+    float positions[9] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+    float texcoords[6] = { 0, 0, 1, 0, 0, 1 };
+    memcpy(buffer.data(), indices, sizeof(indices));
+    memcpy(buffer.data() + 12, positions, sizeof(positions));
+    memcpy(buffer.data() + 48, texcoords, sizeof(texcoords));
+    return buffer;
+}
+
+// The TEXCOORD_0 accessor claims `texcoord_count` of them. `buffer_uri` is empty for the GLB
+// BIN chunk.
+std::string MakeTriangleJson(uint32_t texcoord_count, const std::string& buffer_uri) {
+    std::string uri = buffer_uri.empty() ? std::string() : R"(, "uri": ")" + buffer_uri + "\"";
+    return R"({
+  "asset": { "version": "2.0" },
+  "nodes": [ { "mesh": 0 } ],
+  "meshes": [ { "primitives": [ { "attributes": { "POSITION": 1, "TEXCOORD_0": 2 }, "indices": 0 } ] } ],
+  "accessors": [
+    { "bufferView": 0, "componentType": 5125, "count": 3, "type": "SCALAR" },
+    { "bufferView": 1, "componentType": 5126, "count": 3, "type": "VEC3",
+      "min": [ 0, 0, 0 ], "max": [ 1, 1, 0 ] },
+    { "bufferView": 2, "componentType": 5126, "count": )" + std::to_string(texcoord_count) + R"(, "type": "VEC2" }
+  ],
+  "bufferViews": [
+    { "buffer": 0, "byteOffset": 0, "byteLength": 12 },
+    { "buffer": 0, "byteOffset": 12, "byteLength": 36 },
+    { "buffer": 0, "byteOffset": 48, "byteLength": 24 }
+  ],
+  "buffers": [ { "byteLength": 72)" + uri + R"( } ]
+})";
+}
+
+// Indices past the attribute values and attributes of different counts must fail the import
+// with an error instead of producing a storage the post import stages read out of bounds, for
+// copied and for mapped indices
+bool VerifyMalformedScenes(const char* glb_path) {
+    struct Case {
+        uint32_t last_index;
+        uint32_t texcoord_count;
+        bool valid;
+    };
+    const Case cases[] = { { 2, 3, true }, { 3, 3, false }, { 0xffffffffu, 3, false }, { 2, 2, false } };
+    for (const Case& test : cases) {
+        std::vector<uint8_t> buffer = MakeTriangleBuffer(test.last_index);
+        std::string json = MakeTriangleJson(test.texcoord_count,
+            "data:application/octet-stream;base64," + EncodeBase64(buffer));
+        ImportOptions options;
+        options.optimize_meshes = true;
+        SceneStorage storage;
+        SceneStorage mapped;
+        std::string error;
+        std::string mapped_error;
+        bool imported = ImportGltfFromMemory(json.data(), json.size(), nullptr, options, storage, &error);
+        if (!WriteGlb(glb_path, MakeTriangleJson(test.texcoord_count, ""), buffer)) {
+            std::cerr << "Failed to write the malformed GLB" << std::endl;
+            return false;
+        }
+        bool mapped_imported = ImportGlbMapped(glb_path, options, mapped, &mapped_error);
+        if (imported != test.valid || mapped_imported != test.valid ||
+            (!test.valid && (error.empty() || mapped_error.empty()))) {
+            std::cerr << "Unexpected import result for index " << test.last_index << " and "
+                      << test.texcoord_count << " texcoords: " << error << " / " << mapped_error << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// The uint32 indices and float attributes of a mapped GLB are already in the stored layout, so
+// their spans must lie inside the file at the start of the blob instead of behind it
+bool VerifyMappedZeroCopy(const char* glb_path) {
+    std::vector<uint8_t> buffer = MakeTriangleBuffer(2);
+    if (!WriteGlb(glb_path, MakeTriangleJson(3, ""), buffer)) {
+        std::cerr << "Failed to write the zero copy GLB" << std::endl;
+        return false;
+    }
+    std::ifstream file(glb_path, std::ios::binary | std::ios::ate);
+    uint64_t file_size = (uint64_t)file.tellg();
+
+    ImportOptions options;
+    SceneStorage mapped;
+    std::string error;
+    if (!ImportGlbMapped(glb_path, options, mapped, &error)) {
+        std::cerr << "Mapped import failed: " << error << std::endl;
+        return false;
+    }
+    if (mapped.attrib_infos.size() != 2 || mapped.data.size() < file_size) {
+        std::cerr << "Unexpected mapped scene layout" << std::endl;
+        return false;
+    }
+
+    // Every accessor starts in the BIN chunk, which ends the file
+    const uint8_t* bin = mapped.data.data() + file_size - buffer.size();
+    const uint64_t source_offsets[2] = { 12, 48 };
+    for (uint32_t i = 0; i < 2; ++i) {
+        const AttributeInfo& attrib_info = mapped.attrib_infos[i];
+        uint64_t index_end = attrib_info.index_offset + GetIndexSize(attrib_info) * attrib_info.index_count;
+        uint64_t value_end = attrib_info.value_offset + GetValueSize(attrib_info) * attrib_info.value_count;
+        if (index_end > file_size || value_end > file_size ||
+            mapped.data.data() + attrib_info.index_offset != bin ||
+            mapped.data.data() + attrib_info.value_offset != bin + source_offsets[i]) {
+            std::cerr << "Attribute " << i << " of the mapped GLB is not viewed in place: indices at "
+                      << attrib_info.index_offset << " and values at " << attrib_info.value_offset
+                      << " in a " << file_size << " byte file" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestGltfImporter(const char* path, const char* glb_path) {
+    if (!WriteTestScene(path) || !WriteTestGlb(glb_path)) {
+        std::cerr << "Failed to write the test scenes" << std::endl;
+        return false;
+    }
+
+    for (uint32_t num_threads : { 1u, 4u }) {
+        ImportOptions options;
+        options.num_threads = num_threads;
+        SceneStorage storage;
+        SceneStorage mapped;
+        std::string error;
+        if (!ImportGltf(path, options, storage, &error) || !ImportGlbMapped(glb_path, options, mapped, &error)) {
+            std::cerr << "Import failed: " << error << std::endl;
+            return false;
+        }
+        if (!VerifyScene(storage) || !VerifyScene(mapped)) {
+            return false;
+        }
+    }
+    return VerifySkinnedScene() && VerifyMalformedScenes(glb_path) && VerifyMappedZeroCopy(glb_path);
+}
+
+} // namespace mesh2py::gltftest
+
+int main(int argc, char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : "gltf_importer_test.gltf";
+    const char* glb_path = argc > 2 ? argv[2] : "gltf_importer_test.glb";
+
+    bool success = mesh2py::gltftest::TestGltfImporter(path, glb_path);
+
+    if (success) {
+        std::cout << "\nTest PASSED!" << std::endl;
+        return 0;
+    } else {
+        std::cout << "\nTest FAILED!" << std::endl;
+        return 1;
+    }
+}